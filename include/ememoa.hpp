@@ -0,0 +1,334 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_HPP__
+# define	EMEMOA_HPP__
+
+/*
+ * @file
+ * @brief This header provide C++ typed wrappers around the memory pool handles
+ */
+
+#include	<climits>
+#include	<cstddef>
+#include	<new>
+#include	<utility>
+
+#include	"ememoa_mempool_fixed.h"
+#include	"ememoa_mempool_unknown_size.h"
+
+#if __cplusplus >= 201703L && defined(__has_include)
+# if __has_include(<memory_resource>)
+#  include	<memory_resource>
+#  define	EMEMOA_HAVE_PMR	1
+# endif
+#endif
+
+namespace ememoa
+{
+
+/**
+ * Typed owner of a fixed memory pool. Objects are built in place with perfect
+ * forwarding of the constructor arguments. Over aligned types get a pool aligned
+ * on alignof (T).
+ *
+ * @code
+ * ememoa::fixed_pool<node_s>	nodes (10);
+ * node_s			*n = nodes.construct (key, value);
+ *
+ * nodes.destroy (n);
+ * @endcode
+ */
+template <typename T>
+class fixed_pool
+{
+public:
+   explicit fixed_pool (unsigned int preallocated_item_pot = 8,
+                        unsigned int options = 0,
+                        const struct ememoa_mempool_desc_s *desc = NULL)
+     : _mempool (ememoa_fixed_init (sizeof (T), preallocated_item_pot, align_options (options), desc))
+   {
+      if (_mempool == NULL)
+        throw std::bad_alloc ();
+   }
+
+   ~fixed_pool ()
+   {
+      if (_mempool != NULL)
+        ememoa_fixed_clean (_mempool);
+   }
+
+   fixed_pool (const fixed_pool&) = delete;
+   fixed_pool& operator= (const fixed_pool&) = delete;
+
+   fixed_pool (fixed_pool &&other) noexcept
+     : _mempool (other._mempool)
+   {
+      other._mempool = NULL;
+   }
+
+   fixed_pool& operator= (fixed_pool &&other) noexcept
+   {
+      std::swap (_mempool, other._mempool);
+      return *this;
+   }
+
+   void* allocate ()
+   {
+      void *ptr = ememoa_fixed_pop_object (_mempool);
+
+      if (ptr == NULL)
+        throw std::bad_alloc ();
+      return ptr;
+   }
+
+   void deallocate (void *ptr) noexcept
+   {
+      ememoa_fixed_push_object (_mempool, ptr);
+   }
+
+   template <typename... Args>
+   T* construct (Args&&... args)
+   {
+      void *ptr = allocate ();
+
+      try
+        {
+           return new (ptr) T (std::forward<Args> (args)...);
+        }
+      catch (...)
+        {
+           deallocate (ptr);
+           throw;
+        }
+   }
+
+   void destroy (T *ptr) noexcept
+   {
+      if (ptr == NULL)
+        return ;
+
+      ptr->~T ();
+      deallocate (ptr);
+   }
+
+   int garbage_collect ()
+   {
+      return ememoa_fixed_garbage_collect (_mempool);
+   }
+
+   ememoa_fixed_t* handle () const noexcept
+   {
+      return _mempool;
+   }
+
+private:
+   static constexpr unsigned int align_pot (std::size_t align, unsigned int pot = 0)
+   {
+      return ((std::size_t) 1 << pot) >= align ? pot : align_pot (align, pot + 1);
+   }
+
+   /* Ask for alignof (T) unless options already give more. */
+   static unsigned int align_options (unsigned int options)
+   {
+      if (alignof (T) <= sizeof (void*)
+          || EMEMOA_MEMPOOL_ALIGN_POT(options) >= align_pot (alignof (T)))
+        return options;
+      return (options & ~EMEMOA_MEMPOOL_ALIGN(0xFF)) | EMEMOA_MEMPOOL_ALIGN(align_pot (alignof (T)));
+   }
+
+   ememoa_fixed_t	*_mempool;
+};
+
+/**
+ * Owner of an unknown size memory pool, shared by allocator and memory_resource.
+ */
+class unknown_size_pool
+{
+public:
+   explicit unknown_size_pool (unsigned int options = 0,
+                               const struct ememoa_mempool_desc_s *desc = NULL)
+     : _mempool (ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+                                                   default_map_size_count,
+                                                   options,
+                                                   desc))
+   {
+      if ((int) _mempool < 0)
+        throw std::bad_alloc ();
+   }
+
+   unknown_size_pool (unsigned int map_items_count,
+                      const unsigned int *map_size_count,
+                      unsigned int options = 0,
+                      const struct ememoa_mempool_desc_s *desc = NULL)
+     : _mempool (ememoa_mempool_unknown_size_init (map_items_count, map_size_count, options, desc))
+   {
+      if ((int) _mempool < 0)
+        throw std::bad_alloc ();
+   }
+
+   ~unknown_size_pool ()
+   {
+      ememoa_mempool_unknown_size_clean (_mempool);
+   }
+
+   unknown_size_pool (const unknown_size_pool&) = delete;
+   unknown_size_pool& operator= (const unknown_size_pool&) = delete;
+
+   void* allocate (std::size_t size)
+   {
+      void *ptr;
+
+      /* The C API takes an unsigned int, and refuses sizes its header would wrap. */
+      if (size > UINT_MAX)
+        throw std::bad_alloc ();
+
+      ptr = ememoa_mempool_unknown_size_pop_object (_mempool, size);
+
+      if (ptr == NULL)
+        throw std::bad_alloc ();
+      return ptr;
+   }
+
+   void deallocate (void *ptr) noexcept
+   {
+      ememoa_mempool_unknown_size_push_object (_mempool, ptr);
+   }
+
+   unsigned int handle () const noexcept
+   {
+      return _mempool;
+   }
+
+private:
+   unsigned int	_mempool;
+};
+
+/**
+ * STL allocator taking its memory from an unknown size memory pool, so node based
+ * containers get pool locality.
+ *
+ * @code
+ * ememoa::unknown_size_pool					pool;
+ * std::list<int, ememoa::allocator<int> >			lst (ememoa::allocator<int> (pool));
+ * @endcode
+ */
+template <typename T>
+class allocator
+{
+public:
+   typedef T		value_type;
+
+   static_assert (alignof (T) <= sizeof (void*),
+                  "ememoa unknown size pools only align objects on a pointer size");
+
+   explicit allocator (unknown_size_pool &pool) noexcept
+     : _mempool (pool.handle ())
+   {}
+
+   template <typename U>
+   allocator (const allocator<U> &other) noexcept
+     : _mempool (other.handle ())
+   {}
+
+   T* allocate (std::size_t n)
+   {
+      void *ptr;
+
+      /* n * sizeof (T) must neither wrap nor be truncated to an unsigned int. */
+      if (n > UINT_MAX / sizeof (T))
+        throw std::bad_array_new_length ();
+
+      ptr = ememoa_mempool_unknown_size_pop_object (_mempool, n * sizeof (T));
+
+      if (ptr == NULL)
+        throw std::bad_alloc ();
+      return static_cast<T*> (ptr);
+   }
+
+   void deallocate (T *ptr, std::size_t) noexcept
+   {
+      ememoa_mempool_unknown_size_push_object (_mempool, ptr);
+   }
+
+   unsigned int handle () const noexcept
+   {
+      return _mempool;
+   }
+
+private:
+   unsigned int	_mempool;
+};
+
+template <typename T, typename U>
+bool operator== (const allocator<T> &a, const allocator<U> &b) noexcept
+{
+   return a.handle () == b.handle ();
+}
+
+template <typename T, typename U>
+bool operator!= (const allocator<T> &a, const allocator<U> &b) noexcept
+{
+   return a.handle () != b.handle ();
+}
+
+#ifdef EMEMOA_HAVE_PMR
+/**
+ * std::pmr::memory_resource routing all allocations to an unknown size memory pool.
+ *
+ * @code
+ * ememoa::unknown_size_pool		pool;
+ * ememoa::memory_resource		resource (pool);
+ * std::pmr::map<int, int>		map (&resource);
+ * @endcode
+ */
+class memory_resource : public std::pmr::memory_resource
+{
+public:
+   explicit memory_resource (unknown_size_pool &pool) noexcept
+     : _mempool (pool.handle ())
+   {}
+
+   unsigned int handle () const noexcept
+   {
+      return _mempool;
+   }
+
+protected:
+   void* do_allocate (std::size_t bytes, std::size_t alignment) override
+   {
+      void *ptr;
+
+      if (bytes > UINT_MAX || alignment > UINT_MAX)
+        throw std::bad_alloc ();
+
+      ptr = ememoa_mempool_unknown_size_pop_object_aligned (_mempool, bytes, alignment);
+
+      if (ptr == NULL)
+        throw std::bad_alloc ();
+      return ptr;
+   }
+
+   void do_deallocate (void *ptr, std::size_t, std::size_t) override
+   {
+      ememoa_mempool_unknown_size_push_object (_mempool, ptr);
+   }
+
+   bool do_is_equal (const std::pmr::memory_resource &other) const noexcept override
+   {
+      const memory_resource *o = dynamic_cast<const memory_resource*> (&other);
+
+      return o != NULL && o->_mempool == _mempool;
+   }
+
+private:
+   unsigned int	_mempool;
+};
+#endif
+
+}
+
+#endif		/* EMEMOA_HPP__ */
@@ -9,29 +9,73 @@
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMEMOA_RESIZE_LIST_SEGMENTS             24
+
 struct ememoa_memory_base_resize_list_s
 {
 #ifdef DEBUG
    unsigned int                                 magic;
 #endif
 
-   void                                         *pool;
-   uint32_t                                     *bitmap;
+   /* Segment n holds 32 << n items followed by their bitmap, it never moves. */
+   void                                         *segments[EMEMOA_RESIZE_LIST_SEGMENTS];
+   unsigned int                                 segments_count;
 
    unsigned int                                 jump;
    unsigned int                                 count;
    unsigned int                                 actif;
    unsigned int                                 size;
+   unsigned char                                lock;
+};
+
+/* Where a memory pool takes its memory from, see ememoa_mempool_desc_s. Every
+   function receive ctx. alignment and granularity could be NULL, the memory is
+   then expected to be aligned like malloc does. */
+struct ememoa_memory_backend_s
+{
+   void*                                        (*alloc)(void *ctx, size_t size);
+   void                                         (*free)(void *ctx, void *ptr);
+   void*                                        (*realloc)(void *ctx, void *ptr, size_t size);
+   unsigned int                                 (*alignment)(void *ctx, size_t size);
+   size_t                                       (*granularity)(void *ctx, size_t size);
+   void                                         *ctx;
 };
 
+/* Opaque handle of a static buffer, see ememoa_heap_init. */
+typedef struct ememoa_memory_base_s             ememoa_heap_t;
+
 /* Direct use of this two function is most of the time a bad idea. */
 extern void*    (*ememoa_memory_base_alloc)(size_t size);
 extern void     (*ememoa_memory_base_free)(void *ptr);
 extern void*    (*ememoa_memory_base_realloc)(void* ptr, size_t size);
 
 int     ememoa_memory_base_init_64m(void* buffer, unsigned int size);
+int     ememoa_memory_base_init_shared_64m (void* buffer, unsigned int size);
+int     ememoa_memory_base_init_ext_64m (void *buffer, unsigned int size, unsigned int page_size, int shared);
+int     ememoa_memory_base_attach_shared_64m (void* buffer);
+void*   ememoa_memory_base_create_shared_64m (unsigned int size, int *fd);
+void*   ememoa_memory_base_open_shared_64m (int fd);
+unsigned int    ememoa_memory_base_offset_64m (const void *ptr);
+void*   ememoa_memory_base_pointer_64m (unsigned int offset);
+unsigned int    ememoa_memory_base_alignment (size_t size);
+size_t          ememoa_memory_base_granularity (size_t size);
+size_t          ememoa_memory_base_overhead (size_t size);
+
+ememoa_heap_t*  ememoa_heap_init (void *buffer, unsigned int size, unsigned int page_size);
+void*   ememoa_heap_alloc (ememoa_heap_t *heap, size_t size);
+void    ememoa_heap_free (ememoa_heap_t *heap, void *ptr);
+void*   ememoa_heap_realloc (ememoa_heap_t *heap, void *ptr, size_t size);
+unsigned int    ememoa_heap_alignment (const ememoa_heap_t *heap, size_t size);
+size_t          ememoa_heap_granularity (const ememoa_heap_t *heap, size_t size);
+void    ememoa_heap_backend (ememoa_heap_t *heap, struct ememoa_memory_backend_s *backend);
 
 struct ememoa_memory_base_resize_list_s*        ememoa_memory_base_resize_list_new (unsigned int size);
+struct ememoa_memory_base_resize_list_s*        ememoa_memory_base_resize_list_shared (struct ememoa_memory_base_resize_list_s **list,
+                                                                                       unsigned int size);
 void    ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*  base);
 int     ememoa_memory_base_resize_list_new_item (struct ememoa_memory_base_resize_list_s *base);
 void*   ememoa_memory_base_resize_list_get_item (struct ememoa_memory_base_resize_list_s *base, int index);
@@ -53,7 +97,11 @@ void    ememoa_memory_base_resize_list_back_many (struct ememoa_memory_base_resi
 						  int index,
 						  int count);
 
-/* Be carefull when you call this function, you will loose all index mapping after this call. */
+/* Only give back the empty segments at the end of the list, index mapping is kept. */
 int     ememoa_memory_base_resize_list_garbage_collect (struct ememoa_memory_base_resize_list_s *base);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif          /* EMEMOA_MEMORY_BASE_H__ */
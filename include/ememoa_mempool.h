@@ -14,9 +14,21 @@
 
 #include	"ememoa_mempool_error.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 const char*	ememoa_mempool_error2string (ememoa_mempool_error_t	error_code);
 
 typedef int		(*ememoa_fctl) (void*	ptr,
 					void*	data);
 
+typedef int		(*ememoa_relocate_fctl) (void*	old_ptr,
+						 void*	new_ptr,
+						 void*	data);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif		/* EMEMOA_MEMPOOL_H__ */
@@ -0,0 +1,102 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_MEMPOOL_ARENA_H__
+# define	EMEMOA_MEMPOOL_ARENA_H__
+
+/*
+ * @file
+ * @brief This routine provide bump pointer memory pool for objects sharing the same lifetime
+ */
+
+#include	"ememoa_mempool.h"
+#include	"ememoa_mempool_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* All objects are aligned on two pointers, like malloc does. */
+#define EMEMOA_ARENA_ALIGN	(2 * sizeof (void*))
+#define EMEMOA_ARENA_ROUND(Size) (((Size) + EMEMOA_ARENA_ALIGN - 1) & ~(EMEMOA_ARENA_ALIGN - 1))
+
+/* Opaque handle of an arena, it stays valid until ememoa_mempool_arena_clean. */
+typedef struct ememoa_mempool_arena_s	ememoa_arena_t;
+
+/* Free space of the current block, it is the first member of every ememoa_arena_t
+   so the fast path of pop can be inlined. Never touch it directly. */
+struct ememoa_arena_bump_s
+{
+   uint8_t		*position;
+   uint8_t		*end;
+   /* Thread protected arenas always go through the lock. */
+   unsigned int		locked;
+};
+
+struct ememoa_mempool_arena_mark_s
+{
+   void		*block;
+   void		*position;
+};
+
+int	ememoa_mempool_arena_init (unsigned int				block_size,
+				   unsigned int				options,
+				   const struct ememoa_mempool_desc_s	*desc);
+
+int	ememoa_mempool_arena_clean (int					arena);
+
+void*	ememoa_mempool_arena_pop_object (int				arena,
+					 unsigned int			size);
+
+int	ememoa_mempool_arena_reset (int					arena);
+
+int	ememoa_mempool_arena_checkpoint (int				arena,
+					 struct ememoa_mempool_arena_mark_s	*mark);
+
+int	ememoa_mempool_arena_rollback (int				arena,
+				       const struct ememoa_mempool_arena_mark_s	*mark);
+
+int	ememoa_mempool_arena_garbage_collect (int			arena);
+
+ememoa_mempool_error_t	ememoa_mempool_arena_get_last_error (int	arena);
+
+int	ememoa_mempool_arena_lock_stat (int				arena,
+					struct ememoa_mempool_lock_stat_s	*stat);
+
+ememoa_arena_t*	ememoa_arena_from_index (int				arena);
+void*	ememoa_arena_pop_object_slow (ememoa_arena_t			*memory,
+				      unsigned int			size);
+
+/**
+ * Pops a new object out of the arena. While the current block has room, this
+ * is only a pointer increment without calling into the library.
+ *
+ * @param	memory		Handle of a valid arena.
+ * @param	size		Size of the object.
+ * @return	Will return @c NULL if it was impossible to allocate any data.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+static inline void*
+ememoa_arena_pop_object (ememoa_arena_t	*memory,
+			 unsigned int	size)
+{
+   struct ememoa_arena_bump_s	*bump = (struct ememoa_arena_bump_s*) memory;
+   uint8_t			*result = bump->position;
+
+   /* The room left is a multiple of the alignment, so the rounded size fits too. */
+   if (!bump->locked && size <= (size_t) (bump->end - result))
+     {
+	bump->position = result + EMEMOA_ARENA_ROUND(size);
+	return result;
+     }
+   return ememoa_arena_pop_object_slow (memory, size);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_MEMPOOL_ARENA_H__ */
@@ -7,6 +7,10 @@
 #ifndef		EMEMOA_MEMPOOL_ERROR_H__
 # define	EMEMOA_MEMPOOL_ERROR_H__
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef enum _ememoa_mempool_error_e
   {
     EMEMOA_NO_ERROR,
@@ -20,10 +24,15 @@ typedef enum _ememoa_mempool_error_e
     EMEMOA_NO_EMPTY_POOL,
     EMEMOA_DOUBLE_PUSH,
     EMEMOA_NO_MORE_MEMORY,
-    EMEMOA_INVALID_MEMPOOL
+    EMEMOA_INVALID_MEMPOOL,
+    EMEMOA_NO_RELOCATE_CALLBACK
   } ememoa_mempool_error_t;
 
 const char*
 ememoa_mempool_error2string (ememoa_mempool_error_t error_code);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif		/* EMEMOA_MEMPOOL_ERROR_H__ */
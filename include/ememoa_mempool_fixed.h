@@ -15,7 +15,38 @@
 #include	"ememoa_mempool.h"
 #include	"ememoa_mempool_struct.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define	EMEMOA_THREAD_PROTECTION	1
+#define	EMEMOA_CACHE_COLORING		2
+/* With EMEMOA_THREAD_PROTECTION, spin a little then sleep instead of using a pthread mutex. */
+#define	EMEMOA_ADAPTIVE_LOCK		4
+/* Allocate and prefault the first pool during init instead of on the first pop. */
+#define	EMEMOA_PREALLOCATE		8
+/* Let the size of new pools grow with the number of objects in use, see ememoa_mempool_fixed_init. */
+#define	EMEMOA_ADAPTIVE_POOLS		16
+
+/* Objects alignment, as a power of two, stored in bits 8 to 15 of the options. */
+#define	EMEMOA_MEMPOOL_ALIGN(Pot)	(((Pot) & 0xFF) << 8)
+#define	EMEMOA_MEMPOOL_ALIGN_POT(Options)	(((Options) >> 8) & 0xFF)
+#define	EMEMOA_ALIGN_CACHE_LINE		EMEMOA_MEMPOOL_ALIGN(6)
+#define	EMEMOA_ALIGN_PAGE		EMEMOA_MEMPOOL_ALIGN(12)
+
+#define	EMEMOA_FIXED_CACHE_SIZE		32
+
+/* Opaque handle of a fixed memory pool, it stays valid until ememoa_fixed_clean. */
+typedef struct ememoa_mempool_fixed_s	ememoa_fixed_t;
+
+/* Small cache of pushed objects, it is the first member of every ememoa_fixed_t
+   so the fast path of pop can be inlined. Never touch it directly. */
+struct ememoa_fixed_cache_s
+{
+   unsigned int		count;
+   unsigned int		size;
+   void			*objects[EMEMOA_FIXED_CACHE_SIZE];
+};
 
 int	ememoa_mempool_fixed_init (unsigned int				object_size,
 				   unsigned int				preallocated_item,
@@ -40,10 +71,69 @@ void	ememoa_mempool_fixed_display_statistic_all (void);
 #endif
 
 int	ememoa_mempool_fixed_garbage_collect(int			mempool);
+int	ememoa_mempool_fixed_garbage_collect_all(void);
+
+int	ememoa_mempool_fixed_compact(int				mempool,
+				     void				*data);
 
 int	ememoa_mempool_fixed_walk_over(int				mempool,
 				       ememoa_fctl			fctl,
 				       void				*data);
 ememoa_mempool_error_t	ememoa_mempool_fixed_get_last_error (int	mempool);
+int	ememoa_mempool_fixed_lock_stat (int				mempool,
+					struct ememoa_mempool_lock_stat_s	*stat);
+int	ememoa_mempool_fixed_reserve (int				mempool,
+				      unsigned int			count);
+
+ememoa_fixed_t*	ememoa_fixed_init (unsigned int				object_size,
+				   unsigned int				preallocated_item,
+				   unsigned int				options,
+				   const struct ememoa_mempool_desc_s	*desc);
+
+int	ememoa_fixed_clean (ememoa_fixed_t				*memory);
+
+ememoa_fixed_t*	ememoa_fixed_from_index (int				mempool);
+int	ememoa_fixed_to_index (const ememoa_fixed_t			*memory);
+
+void*	ememoa_fixed_pop_object_slow (ememoa_fixed_t			*memory);
+int	ememoa_fixed_push_object (ememoa_fixed_t			*memory,
+				  void					*ptr);
+
+int	ememoa_fixed_flush (ememoa_fixed_t				*memory);
+int	ememoa_fixed_free_all_objects (ememoa_fixed_t			*memory);
+int	ememoa_fixed_garbage_collect (ememoa_fixed_t			*memory);
+int	ememoa_fixed_compact (ememoa_fixed_t				*memory,
+			      void					*data);
+int	ememoa_fixed_walk_over (ememoa_fixed_t				*memory,
+				ememoa_fctl				fctl,
+				void					*data);
+ememoa_mempool_error_t	ememoa_fixed_get_last_error (const ememoa_fixed_t	*memory);
+int	ememoa_fixed_lock_stat (const ememoa_fixed_t			*memory,
+				struct ememoa_mempool_lock_stat_s	*stat);
+int	ememoa_fixed_reserve (ememoa_fixed_t				*memory,
+			      unsigned int				count);
+
+/**
+ * Pops a new object out of the memory pool. Objects recently pushed back are
+ * given again without calling into the library, and so without firing the
+ * fixed_pop tracepoint.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c NULL if it was impossible to allocate any data.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+static inline void*
+ememoa_fixed_pop_object (ememoa_fixed_t	*memory)
+{
+   struct ememoa_fixed_cache_s	*cache = (struct ememoa_fixed_cache_s*) memory;
+
+   if (cache->count)
+     return cache->objects[--cache->count];
+   return ememoa_fixed_pop_object_slow (memory);
+}
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif		/* EMEMOA_MEMPOOL_FIXED_H__ */
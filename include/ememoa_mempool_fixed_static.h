@@ -0,0 +1,226 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_MEMPOOL_FIXED_STATIC_H__
+# define	EMEMOA_MEMPOOL_FIXED_STATIC_H__
+
+/*
+ * @file
+ * @brief This routine provide fixed size memory pool specialized at compile time
+ *
+ * The object size, the number of objects per pool and the thread protection are
+ * compile time constants. The compiler turns the division done on push into a
+ * multiply and shift (or a shift for power of two sizes) and inlines the pop and
+ * push fast paths in the caller. Only pool creation and destruction are out of line.
+ *
+ * @code
+ * EMEMOA_MEMPOOL_FIXED_STATIC(node, sizeof (struct node_s), 8, 0);
+ * EMEMOA_MEMPOOL_FIXED_STATIC_INSTANCE(node);
+ *
+ * struct node_s *n = node_pop_object ();
+ * node_push_object (n);
+ * node_clean ();
+ * @endcode
+ */
+
+#include	<stdint.h>
+
+#include	"ememoa_mempool_fixed.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ememoa_mempool_fixed_static_pool_s
+{
+   uint8_t					*objects_pool;
+   unsigned int					available_objects;
+   unsigned int					jump_object;
+   /* The bitmap of (1 << pot) bits follow. */
+};
+
+struct ememoa_mempool_fixed_static_s
+{
+   struct ememoa_mempool_fixed_static_pool_s	**pools;
+   unsigned int					pools_count;
+   unsigned int					pools_size;
+   unsigned int					jump_pool;
+   /* Same spin then sleep lock as EMEMOA_ADAPTIVE_LOCK, 0 when free. */
+   int						lock;
+};
+
+#define EMEMOA_MEMPOOL_FIXED_STATIC_INIT { NULL, 0, 0, 0, 0 }
+
+#define EMEMOA_MEMPOOL_FIXED_STATIC_ALIGN(Size) \
+  (((Size) + sizeof (void*) - 1) & ~(sizeof (void*) - 1))
+
+#define EMEMOA_MEMPOOL_FIXED_STATIC_BITMAP(Pool) \
+  ((uint32_t*) ((struct ememoa_mempool_fixed_static_pool_s*) (Pool) + 1))
+
+void*	ememoa_mempool_fixed_static_add_pool (struct ememoa_mempool_fixed_static_s	*memory,
+					      unsigned int				object_size,
+					      unsigned int				pot);
+int	ememoa_mempool_fixed_static_garbage_collect (struct ememoa_mempool_fixed_static_s	*memory,
+						     unsigned int			pot);
+int	ememoa_mempool_fixed_static_clean (struct ememoa_mempool_fixed_static_s		*memory);
+void	ememoa_mempool_fixed_static_lock_slow (struct ememoa_mempool_fixed_static_s	*memory);
+void	ememoa_mempool_fixed_static_unlock_slow (struct ememoa_mempool_fixed_static_s	*memory);
+
+static inline void
+ememoa_mempool_fixed_static_lock (struct ememoa_mempool_fixed_static_s	*memory,
+				  const unsigned int			options)
+{
+   int	c = 0;
+
+   if ((options & EMEMOA_THREAD_PROTECTION)
+       && !__atomic_compare_exchange_n (&memory->lock, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+     ememoa_mempool_fixed_static_lock_slow (memory);
+}
+
+static inline void
+ememoa_mempool_fixed_static_unlock (struct ememoa_mempool_fixed_static_s	*memory,
+				    const unsigned int				options)
+{
+   if ((options & EMEMOA_THREAD_PROTECTION)
+       && __atomic_exchange_n (&memory->lock, 0, __ATOMIC_RELEASE) == 2)
+     ememoa_mempool_fixed_static_unlock_slow (memory);
+}
+
+static inline __attribute__((always_inline)) void*
+ememoa_mempool_fixed_static_pop (struct ememoa_mempool_fixed_static_s	*memory,
+				 const unsigned int			object_size,
+				 const unsigned int			pot,
+				 const unsigned int			options)
+{
+   struct ememoa_mempool_fixed_static_pool_s	*pool;
+   uint32_t					*objects_use;
+   unsigned int					position;
+   unsigned int					i;
+   void						*result;
+
+   ememoa_mempool_fixed_static_lock (memory, options);
+
+   for (i = memory->jump_pool; i < memory->pools_count; ++i)
+     if (memory->pools[i]->available_objects)
+       break;
+
+   if (i == memory->pools_count)
+     {
+	result = ememoa_mempool_fixed_static_add_pool (memory, object_size, pot);
+	ememoa_mempool_fixed_static_unlock (memory, options);
+	return result;
+     }
+
+   memory->jump_pool = i;
+   pool = memory->pools[i];
+   objects_use = EMEMOA_MEMPOOL_FIXED_STATIC_BITMAP(pool);
+
+   for (i = pool->jump_object; objects_use[i] == 0; ++i)
+     ;
+   pool->jump_object = i;
+
+   position = (i << 5) + __builtin_ctz (objects_use[i]);
+   objects_use[i] &= objects_use[i] - 1;
+   pool->available_objects--;
+
+   result = pool->objects_pool + position * object_size;
+
+   ememoa_mempool_fixed_static_unlock (memory, options);
+   return result;
+}
+
+static inline __attribute__((always_inline)) int
+ememoa_mempool_fixed_static_push (struct ememoa_mempool_fixed_static_s	*memory,
+				  void					*ptr,
+				  const unsigned int			object_size,
+				  const unsigned int			pot,
+				  const unsigned int			options)
+{
+   struct ememoa_mempool_fixed_static_pool_s	*pool;
+   uint32_t					*objects_use;
+   uintptr_t					offset;
+   unsigned int					position;
+   uint32_t					mask;
+   unsigned int					i;
+
+   ememoa_mempool_fixed_static_lock (memory, options);
+
+   for (i = 0; i < memory->pools_count; ++i)
+     {
+	pool = memory->pools[i];
+	offset = (uintptr_t) ptr - (uintptr_t) pool->objects_pool;
+
+	if (offset < ((uintptr_t) object_size << pot))
+	  {
+	     position = offset / object_size;
+	     objects_use = EMEMOA_MEMPOOL_FIXED_STATIC_BITMAP(pool);
+	     mask = (uint32_t) 1 << (position & 0x1F);
+	     position >>= 5;
+
+	     if (objects_use[position] & mask)
+	       break;
+
+	     objects_use[position] |= mask;
+	     pool->available_objects++;
+
+	     if (pool->jump_object > position)
+	       pool->jump_object = position;
+	     if (memory->jump_pool > i)
+	       memory->jump_pool = i;
+
+	     ememoa_mempool_fixed_static_unlock (memory, options);
+	     return 0;
+	  }
+     }
+
+   ememoa_mempool_fixed_static_unlock (memory, options);
+   return -1;
+}
+
+/* Declare Name_pop_object, Name_push_object, Name_garbage_collect and Name_clean.
+   Pot must be at least 5 (32 objects per pool). */
+#define EMEMOA_MEMPOOL_FIXED_STATIC(Name, Size, Pot, Options)		\
+  typedef char Name##_pot_must_be_at_least_5[(Pot) >= 5 ? 1 : -1];	\
+  extern struct ememoa_mempool_fixed_static_s Name##_mempool;		\
+  static inline void*							\
+  Name##_pop_object (void)						\
+  {									\
+     return ememoa_mempool_fixed_static_pop (&Name##_mempool,		\
+					     EMEMOA_MEMPOOL_FIXED_STATIC_ALIGN(Size), \
+					     (Pot), (Options));		\
+  }									\
+  static inline int							\
+  Name##_push_object (void *ptr)					\
+  {									\
+     return ememoa_mempool_fixed_static_push (&Name##_mempool, ptr,	\
+					      EMEMOA_MEMPOOL_FIXED_STATIC_ALIGN(Size), \
+					      (Pot), (Options));	\
+  }									\
+  static inline int							\
+  Name##_garbage_collect (void)						\
+  {									\
+     int result;							\
+     ememoa_mempool_fixed_static_lock (&Name##_mempool, (Options));	\
+     result = ememoa_mempool_fixed_static_garbage_collect (&Name##_mempool, (Pot)); \
+     ememoa_mempool_fixed_static_unlock (&Name##_mempool, (Options));	\
+     return result;							\
+  }									\
+  static inline int							\
+  Name##_clean (void)							\
+  {									\
+     return ememoa_mempool_fixed_static_clean (&Name##_mempool);	\
+  }
+
+/* Define the storage of a pool declared with EMEMOA_MEMPOOL_FIXED_STATIC in one
+   translation unit. */
+#define EMEMOA_MEMPOOL_FIXED_STATIC_INSTANCE(Name)			\
+  struct ememoa_mempool_fixed_static_s Name##_mempool = EMEMOA_MEMPOOL_FIXED_STATIC_INIT
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_MEMPOOL_FIXED_STATIC_H__ */
@@ -0,0 +1,36 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_MEMPOOL_GC_H__
+# define	EMEMOA_MEMPOOL_GC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @file
+ * @brief This routine provide an incremental garbage collector for all memory pool
+ */
+
+int	ememoa_mempool_gc_step (unsigned int				max_pools,
+				unsigned int				max_ns);
+
+int	ememoa_mempool_gc_step_ext (unsigned int			max_pools,
+				    unsigned int			max_ns,
+				    unsigned int			*done);
+
+int	ememoa_mempool_gc_thread_start (unsigned int			period_ms,
+					unsigned int			max_pools,
+					unsigned int			max_ns);
+
+int	ememoa_mempool_gc_thread_stop (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_MEMPOOL_GC_H__ */
@@ -0,0 +1,43 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_MEMPOOL_PROFILE_H__
+# define	EMEMOA_MEMPOOL_PROFILE_H__
+
+/*
+ * @file
+ * @brief This routine provide a sampling heap profiler for unknown size memory pool
+ *
+ * About one allocation every sample_bytes allocated bytes records its call stack.
+ * Samples stay in a table until their object is pushed back, so a dump shows which
+ * call sites own the live memory. The dump use the folded stack format, one line
+ * per sample, that flamegraph.pl and most profile viewers read directly.
+ *
+ * @code
+ * ememoa_mempool_profile_start (512 * 1024, 4096);
+ * ...
+ * ememoa_mempool_profile_dump (stderr);
+ * @endcode
+ */
+
+#include	<stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int	ememoa_mempool_profile_start (unsigned int			sample_bytes,
+				      unsigned int			max_samples);
+
+int	ememoa_mempool_profile_stop (void);
+
+int	ememoa_mempool_profile_dump (FILE				*out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_MEMPOOL_PROFILE_H__ */
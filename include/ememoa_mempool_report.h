@@ -0,0 +1,54 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_MEMPOOL_REPORT_H__
+# define	EMEMOA_MEMPOOL_REPORT_H__
+
+/*
+ * @file
+ * @brief This routine provide a footprint report of all memory pool
+ *
+ * The report is a JSON object with one entry per fixed memory pool, one per unknown
+ * size memory pool and the state of the static buffer allocator when it is used.
+ * All sizes are in bytes.
+ *
+ * @code
+ * {
+ *   "fixed": [
+ *     { "index": 0, "name": "node", "object_size": 24, "pools": 1, "objects": 3,
+ *       "requested": 60, "handed": 72, "reserved": 1024, "free_in_partial": 912, "wasted": 0 }
+ *   ],
+ *   "unknown_size": [
+ *     { "index": 0, "name": null, "fixed_pools": [ 1, 2 ], "pools": 1, "objects": 1,
+ *       "requested": 100, "handed": 152, "reserved": 3616, "free_in_partial": 3432, "wasted": 0 }
+ *   ],
+ *   "heap_64m": { "page_size": 4096, "pages": 16382, "free_pages": 16380, "largest_free_chunk": 67092480 }
+ * }
+ * @endcode
+ *
+ * - requested: bytes asked by the users of the live objects.
+ * - handed: bytes really given to them, with the size class rounding and the headers.
+ * - reserved: bytes taken by the pools from the memory allocator.
+ * - free_in_partial: free bytes inside pools that still hold live objects.
+ * - wasted: bytes the memory allocator rounds the pools to but that hold no object.
+ *
+ * An unknown size memory pool is made of the fixed memory pools listed in fixed_pools,
+ * they also show up in "fixed".
+ */
+
+#include	<stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int	ememoa_report_footprint (FILE					*out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_MEMPOOL_REPORT_H__ */
@@ -16,19 +16,41 @@
 #include	"ememoa_mempool.h"
 #include	"ememoa_mempool_error.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
  * @file
  * @brief This structure are used by memory pool routine
  */
 
+struct ememoa_memory_backend_s;
+
 struct ememoa_mempool_desc_s
 {
-   const char	*name;
-   ememoa_fctl	data_display;
+   const char		*name;
+   ememoa_fctl		data_display;
+   ememoa_relocate_fctl	relocate;
+   /* Where the memory comes from, NULL for ememoa_memory_base_alloc. It is copied
+      at init time. */
+   const struct ememoa_memory_backend_s	*backend;
+};
+
+/* Contention statistics of the lock of a thread protected memory pool. */
+struct ememoa_mempool_lock_stat_s
+{
+   unsigned long long	acquisitions;
+   unsigned long long	contended;
+   unsigned long long	wait_ns;
 };
 
 struct ememoa_mempool_fixed_s;
 struct ememoa_mempool_alloc_item_s;
 struct ememoa_mempool_unknown_size_s;
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif		/* EMEMOA_MEMPOOL_STRUCT_H__ */
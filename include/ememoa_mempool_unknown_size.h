@@ -15,6 +15,10 @@
 #include	"ememoa_mempool.h"
 #include	"ememoa_mempool_struct.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 static const unsigned int	default_map_size_count[] =
   {
     16,		9,
@@ -41,6 +45,10 @@ int	ememoa_mempool_unknown_size_push_object (unsigned int				mempool,
 void*	ememoa_mempool_unknown_size_pop_object (unsigned int				mempool,
 						unsigned int				size);
 
+void*	ememoa_mempool_unknown_size_pop_object_aligned (unsigned int			mempool,
+							unsigned int			size,
+							unsigned int			align);
+
 void*   ememoa_mempool_unknown_size_resize_object (unsigned int                         mempool,
                                                    void                                 *ptr,
                                                    unsigned int                         size);
@@ -59,5 +67,12 @@ int	ememoa_mempool_unknown_size_walk_over (unsigned int				mempool,
 
 ememoa_mempool_error_t	ememoa_mempool_unknown_size_get_last_error (unsigned int	mempool);
 
+int	ememoa_mempool_unknown_size_lock_stat (unsigned int			mempool,
+					       struct ememoa_mempool_lock_stat_s	*stat);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif		/* EMEMOA_MEMPOOL_UNKNOWN_SIZE_H__ */
 
@@ -0,0 +1,52 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_SNAPSHOT_H__
+# define	EMEMOA_SNAPSHOT_H__
+
+/*
+ * @file
+ * @brief This routine provide persistent memory pool kept in a file
+ *
+ * ememoa_attach map a file at a fixed address and use it as the static buffer of
+ * ememoa, so every memory pool and every object live in the file. After a restart,
+ * ememoa_attach on the same file give back all memory pool with the same index and
+ * all objects at the same address. ememoa_snapshot_root_set keep one pointer, usually
+ * the root of the application data, that is found back with ememoa_snapshot_root_get.
+ *
+ * @code
+ * if (ememoa_attach ("/var/cache/service.heap", NULL, 256 * 1024 * 1024) == NULL)
+ *   exit (-1);
+ * cache = ememoa_snapshot_root_get ();
+ * if (cache == NULL)
+ *   {
+ *      cache = cache_new ();
+ *      ememoa_snapshot_root_set (cache);
+ *   }
+ * ...
+ * ememoa_snapshot_sync ();
+ * @endcode
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void*	ememoa_attach (const char				*path,
+		       void					*address,
+		       unsigned int				size);
+
+int	ememoa_snapshot_sync (void);
+
+void	ememoa_snapshot_root_set (void				*root);
+
+void*	ememoa_snapshot_root_get (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif		/* EMEMOA_SNAPSHOT_H__ */
@@ -13,9 +13,14 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "config.h"
 
 #include "mempool_struct.h"
+#include "ememoa_trace.h"
 
 #define EMEMOA_MAGIC    0xDEAD5007
 
@@ -29,8 +34,6 @@
 static int total = 0;
 
 #ifdef HAVE_PTHREAD
-static pthread_mutex_t lockit = PTHREAD_MUTEX_INITIALIZER;
-
 #define LK(Lock) pthread_mutex_lock(&Lock);
 #define ULK(Lock) pthread_mutex_unlock(&Lock);
 
@@ -51,72 +54,115 @@ void* (*ememoa_memory_base_realloc)(void* ptr, size_t size) = realloc;
  */
 
 /**
- * Global context for the static buffer allocator.
+ * Static buffer used by ememoa_memory_base_alloc, ememoa_memory_base_free and
+ * ememoa_memory_base_realloc once ememoa_memory_base_init_64m was called.
  * @ingroup Ememoa_Mempool_Base_64m
  */
 static struct ememoa_memory_base_s     *base_64m = NULL;
 
+/* Where the chunks, the pages and the data of a static buffer are mapped in this
+   process, every process could map it at a different address. */
+#define EMEMOA_CHUNKS_64M(Heap) \
+  ((struct ememoa_memory_base_chunck_s*) ((uint8_t*) (Heap) + (Heap)->chunks_offset))
+#define EMEMOA_TAGS_64M(Heap)           ((uint16_t*) ((uint8_t*) (Heap) + (Heap)->pages_offset))
+#define EMEMOA_DATA_64M(Heap)           ((uint8_t*) (Heap) + (Heap)->data_offset)
+
+#define EMEMOA_PAGE_64M(Heap)           ((size_t) 1 << (Heap)->page_shift)
+#define EMEMOA_PAGE_MASK_64M(Heap)      (EMEMOA_PAGE_64M(Heap) - 1)
+
+/* Page sizes accepted by ememoa_memory_base_init_ext_64m. */
+#define EMEMOA_PAGE_SHIFT_MIN           8
+#define EMEMOA_PAGE_SHIFT_MAX           21
+
+/* Set in the header of a static buffer shared between processes. */
+#define EMEMOA_SHARED_MAGIC     0x5AED64
+
 /**
- * Remove an item from the base_64m free block list.
+ * Remove an item from the free block list of a static buffer.
  *
+ * @param       heap    The static buffer.
  * @param       index   Item to be removed.
  * @return	Will never fail.
  * @ingroup	Ememoa_Mempool_Base_64m
  */
 static void
-ememoa_memory_base_remove_from_list (uint16_t index)
+ememoa_memory_base_remove_from_list (struct ememoa_memory_base_s *heap, uint16_t index)
 {
-   uint16_t     prev = base_64m->chunks[index].prev;
-   uint16_t     next = base_64m->chunks[index].next;
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                prev = chunks[index].prev;
+   uint16_t                                next = chunks[index].next;
 
    if (prev != 0xFFFF)
-     base_64m->chunks[prev].next = next;
+     chunks[prev].next = next;
    if (next != 0xFFFF)
-     base_64m->chunks[next].prev = prev;
-   if (base_64m->start == index)
-     base_64m->start = next;
-   if (base_64m->over == index)
-     base_64m->over = prev;
-
-   base_64m->chunks[index].prev = 0xFFFF;
-   base_64m->chunks[index].next = 0xFFFF;
+     chunks[next].prev = prev;
+   if (heap->start == index)
+     heap->start = next;
+   if (heap->over == index)
+     heap->over = prev;
+
+   chunks[index].prev = 0xFFFF;
+   chunks[index].next = 0xFFFF;
 }
 
 /**
- * Insert an item in the base_64m free block list.
+ * Insert an item in the free block list of a static buffer.
  *
+ * @param       heap    The static buffer.
  * @param       index   Item to be inserted.
  * @return	Will break completely if the item is already in the list.
  * @ingroup	Ememoa_Mempool_Base_64m
  */
 static void
-ememoa_memory_base_insert_in_list (uint16_t index)
+ememoa_memory_base_insert_in_list (struct ememoa_memory_base_s *heap, uint16_t index)
 {
-   uint16_t     length = base_64m->chunks[index].length;
-   uint16_t     prev = 0xFFFF;
-   uint16_t     next;
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                length = chunks[index].length;
+   uint16_t                                prev = 0xFFFF;
+   uint16_t                                next;
 
-   if (base_64m->chunks[index].start == 0xFFFF)
+   if (chunks[index].start == 0xFFFF)
      return ;
 
-   for (next = base_64m->start; next != 0xFFFF && base_64m->chunks[next].length > length; next = base_64m->chunks[next].next)
+   for (next = heap->start; next != 0xFFFF && chunks[next].length > length; next = chunks[next].next)
      prev = next;
 
    assert (index != next);
    assert (index != prev);
 
-   base_64m->chunks[index].next = next;
-   base_64m->chunks[index].prev = prev;
+   chunks[index].next = next;
+   chunks[index].prev = prev;
 
    if (next != 0xFFFF)
-     base_64m->chunks[next].prev = index;
+     chunks[next].prev = index;
    else
-     base_64m->over = index;
+     heap->over = index;
 
    if (prev != 0xFFFF)
-     base_64m->chunks[prev].next = index;
+     chunks[prev].next = index;
    else
-     base_64m->start = index;
+     heap->start = index;
+}
+
+/**
+ * Record a chunk in pages_64m. Only its first and its last page are set, so splitting
+ * or merging chunks costs the same whatever their size. Neighbours are always found
+ * through these boundary pages: the page after the end of a chunk is the first page
+ * of the next one, the page before its start the last page of the previous one. The
+ * entries of the inner pages are stale and must never be read.
+ *
+ * @param       heap    The static buffer.
+ * @param       index   The chunk.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static void
+ememoa_memory_base_tag_64m (struct ememoa_memory_base_s *heap, uint16_t index)
+{
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                *tags = EMEMOA_TAGS_64M(heap);
+
+   tags[chunks[index].start] = index;
+   tags[chunks[index].end] = index;
 }
 
 /**
@@ -124,43 +170,39 @@ ememoa_memory_base_insert_in_list (uint16_t index)
  * chunk as the one requiring less effort for committing the change. No
  * requirement on parameters order or any other characteristic exist.
  *
+ * @param       heap    The static buffer.
  * @param       one     First part of the chunk to be merged.
  * @param       two     Second part of the chunk to be merged.
  * @return	Index of the new chunk.
  * @ingroup	Ememoa_Mempool_Base_64m
  */
 static uint16_t
-ememoa_memory_base_merge_64m (uint16_t  one,
+ememoa_memory_base_merge_64m (struct ememoa_memory_base_s *heap,
+                              uint16_t  one,
                               uint16_t  two)
 {
-   uint16_t     index;
-   uint16_t     tmp;
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                tmp;
 
-   if (base_64m->chunks[one].length < base_64m->chunks[two].length)
+   if (chunks[one].length < chunks[two].length)
      {
         tmp = one;
         one = two;
         two = tmp;
      }
 
-   /* All page refering to 'two' now refere to 'one'. */
-   for (index = base_64m->chunks[two].start;
-        index != base_64m->chunks[two].end;
-        ++index)
-     base_64m->pages[index] = one;
-   base_64m->pages[index] = one;
-
-   if (base_64m->chunks[one].start < base_64m->chunks[two].start)
-     base_64m->chunks[one].end = base_64m->chunks[two].end;
+   if (chunks[one].start < chunks[two].start)
+     chunks[one].end = chunks[two].end;
    else
-     base_64m->chunks[one].start = base_64m->chunks[two].start;
+     chunks[one].start = chunks[two].start;
 
-   base_64m->chunks[one].length += base_64m->chunks[two].length;
+   chunks[one].length += chunks[two].length;
+   ememoa_memory_base_tag_64m (heap, one);
 
-   base_64m->chunks[two].start = 0xFFFF;
-   base_64m->chunks[two].use = 0;
-   if (base_64m->jump > two)
-     base_64m->jump = two;
+   chunks[two].start = 0xFFFF;
+   chunks[two].use = 0;
+   if (heap->jump > two)
+     heap->jump = two;
 
    return one;
 }
@@ -171,30 +213,32 @@ ememoa_memory_base_merge_64m (uint16_t  one,
  * the splitted chunk depending on the fastest strategie. You will need to guess by your
  * self what was our choice.
  *
+ * @param       heap    The static buffer.
  * @param       index   The item to split.
  * @param       length  The required size for one of the two resulting chunk.
  * @return	0xFFFF, if the chunk already has the right size otherwise the new allocated chunk.
  * @ingroup	Ememoa_Mempool_Base_64m
  */
 static uint16_t
-ememoa_memory_base_split_64m (uint16_t index, unsigned int length)
+ememoa_memory_base_split_64m (struct ememoa_memory_base_s *heap, uint16_t index, unsigned int length)
 {
-   if (base_64m->chunks[index].length != length)
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+
+   if (chunks[index].length != length)
      {
         struct ememoa_memory_base_chunck_s      a;
         struct ememoa_memory_base_chunck_s      b;
-        uint16_t                                i;
         uint16_t                                splitted;
 
-        while (!(base_64m->chunks[base_64m->jump].start == 0xFFFF
-                 && base_64m->chunks[base_64m->jump].prev == 0xFFFF
-                 && base_64m->chunks[base_64m->jump].next == 0xFFFF))
-          base_64m->jump++;
+        while (!(chunks[heap->jump].start == 0xFFFF
+                 && chunks[heap->jump].prev == 0xFFFF
+                 && chunks[heap->jump].next == 0xFFFF))
+          heap->jump++;
 
-        splitted = base_64m->jump++;
-        ememoa_memory_base_remove_from_list (index);
+        splitted = heap->jump++;
+        ememoa_memory_base_remove_from_list (heap, index);
 
-        a = base_64m->chunks[index];
+        a = chunks[index];
 
         b.length = a.length - length;
         b.end = a.end;
@@ -209,22 +253,19 @@ ememoa_memory_base_split_64m (uint16_t index, unsigned int length)
 
         if (a.length < b.length)
           {
-             base_64m->chunks[index] = b;
-             base_64m->chunks[splitted] = a;
-             ememoa_memory_base_insert_in_list (index);
+             chunks[index] = b;
+             chunks[splitted] = a;
+             ememoa_memory_base_insert_in_list (heap, index);
           }
         else
           {
-             base_64m->chunks[index] = a;
-             base_64m->chunks[splitted] = b;
-             ememoa_memory_base_insert_in_list (splitted);
+             chunks[index] = a;
+             chunks[splitted] = b;
+             ememoa_memory_base_insert_in_list (heap, splitted);
           }
 
-        for (i = base_64m->chunks[splitted].start;
-             i != base_64m->chunks[splitted].end;
-             ++i)
-          base_64m->pages[i] = splitted;
-        base_64m->pages[i] = splitted;
+        ememoa_memory_base_tag_64m (heap, index);
+        ememoa_memory_base_tag_64m (heap, splitted);
 
         return splitted;
      }
@@ -232,260 +273,1346 @@ ememoa_memory_base_split_64m (uint16_t index, unsigned int length)
 }
 
 /**
- * Just allocate like malloc a new memory chunk from the static buffer.
+ * Take real pages out of the static buffer. The caller must hold heap->lock.
  *
- * @param       size    The asked size.
- * @return	NULL if not enough memory, or a correct pointer otherwise.
+ * @param       heap    The static buffer.
+ * @param       real    Number of pages.
+ * @return	NULL if not enough memory, or a pointer to the first page otherwise.
  * @ingroup	Ememoa_Mempool_Base_64m
  */
 static void*
-ememoa_memory_base_alloc_64m (size_t size)
+ememoa_memory_base_alloc_pages_64m (struct ememoa_memory_base_s *heap, uint16_t real)
 {
-   uint16_t     real = (size >> 12) + (size & 0xFFF ? 1 : 0);
-   uint16_t     jump = base_64m->start;
-   uint16_t     prev = 0xFFFF;
-
-   LK(lockit);
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint8_t                                 *data = EMEMOA_DATA_64M(heap);
+   uint16_t                                jump = heap->start;
+   uint16_t                                prev = 0xFFFF;
 
-   while (jump != 0xFFFF && base_64m->chunks[jump].length > real)
+   while (jump != 0xFFFF && chunks[jump].length > real)
      {
         prev = jump;
-        jump = base_64m->chunks[jump].next;
+        jump = chunks[jump].next;
+     }
+
+   /* A chunk of exactly the right size doesn't need to be split. */
+   if (jump != 0xFFFF && chunks[jump].length == real)
+     {
+        ememoa_memory_base_remove_from_list (heap, jump);
+        chunks[jump].use = 1;
+
+	total += real;
+        return data + ((size_t) chunks[jump].start << heap->page_shift);
      }
 
    if (prev != 0xFFFF)
      {
-        uint16_t        splitted = ememoa_memory_base_split_64m (prev, real);
+        uint16_t        splitted = ememoa_memory_base_split_64m (heap, prev, real);
         uint16_t        allocated;
         uint16_t        empty;
 
         /* Guess who is who */
-        allocated = base_64m->chunks[prev].use == 1 ? prev : splitted;
-        empty = base_64m->chunks[prev].use == 1 ? splitted : prev;
+        allocated = chunks[prev].use == 1 ? prev : splitted;
+        empty = chunks[prev].use == 1 ? splitted : prev;
 
 	total += real;
 #ifdef ALLOC_REPORT
-	fprintf(stderr, "alloc %i(%i) [%i] => %p\n", real << 12, size, total << 12, ((uint8_t*) base_64m->base) + (base_64m->chunks[allocated].start << 12));
+	fprintf(stderr, "alloc %i [%i] => %p\n", real << heap->page_shift, total << heap->page_shift, data + ((size_t) chunks[allocated].start << heap->page_shift));
 #endif
-	ULK(lockit);
 
-        return ((uint8_t*) base_64m->base) + (base_64m->chunks[allocated].start << 12);
+        return data + ((size_t) chunks[allocated].start << heap->page_shift);
      }
 
-   ULK(lockit);
-
    return NULL;
 }
 
 /**
- * Just free like free a previously allocated by ememoa_memory_base_alloc_64m memory chunk.
+ * Give back the chunk starting at page index, merging it with its free neighbours.
+ * The caller must hold heap->lock.
+ *
+ * @param       heap    The static buffer.
+ * @param       index   First page of the chunk.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static void
+ememoa_memory_base_free_pages_64m (struct ememoa_memory_base_s *heap, uint16_t index)
+{
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                *tags = EMEMOA_TAGS_64M(heap);
+   uint16_t                                chunk_index;
+   uint16_t                                prev_chunk_index;
+   uint16_t                                next_chunk_index;
+
+   chunk_index = tags[index];
+
+   total -= chunks[chunk_index].length;
+#ifdef ALLOC_REPORT
+   fprintf(stderr, "free %i [%i] => %p\n", chunks[chunk_index].length, total << heap->page_shift, EMEMOA_DATA_64M(heap) + ((size_t) index << heap->page_shift));
+#endif
+
+   prev_chunk_index = index > 0 ? tags[index - 1] : 0xFFFF;
+   next_chunk_index = (unsigned int) chunks[chunk_index].end + 1 < heap->chunks_count
+     ? tags[chunks[chunk_index].end + 1] : 0xFFFF;
+
+   if (prev_chunk_index != 0xFFFF)
+     if (chunks[prev_chunk_index].use == 0)
+       {
+          ememoa_memory_base_remove_from_list(heap, prev_chunk_index);
+          chunk_index = ememoa_memory_base_merge_64m(heap, chunk_index, prev_chunk_index);
+       }
+
+   if (next_chunk_index != 0xFFFF)
+     if (chunks[next_chunk_index].use == 0)
+       {
+          ememoa_memory_base_remove_from_list(heap, next_chunk_index);
+          chunk_index = ememoa_memory_base_merge_64m(heap, chunk_index, next_chunk_index);
+       }
+
+   ememoa_memory_base_insert_in_list (heap, chunk_index);
+   chunks[chunk_index].use = 0;
+}
+
+/**
+ * Header at the start of a page cut in small blocks. Free blocks are chained by
+ * their offset in the page, so the chain stays valid in every process mapping
+ * the static buffer.
+ * @ingroup Ememoa_Mempool_Base_64m
+ */
+struct ememoa_memory_base_small_page_s
+{
+   uint16_t     next;
+   uint16_t     prev;
+
+   /* Offset of the first free block, 0 if none. */
+   uint32_t     free;
+   /* Offset of the first block never used. */
+   uint32_t     fresh;
+
+   uint16_t     used;
+   uint16_t     size_class;
+};
+
+/* Blocks start after the header, aligned on a cache line. */
+#define EMEMOA_SMALL_HEADER     64
+
+#define EMEMOA_SMALL_PAGE(Heap, Index) \
+  ((struct ememoa_memory_base_small_page_s*) (EMEMOA_DATA_64M(Heap) + ((size_t) (Index) << (Heap)->page_shift)))
+
+/**
+ * Give the size class of a small allocation.
+ *
+ * @param       size    The asked size, at most heap->small_max.
+ * @return	The size class, its blocks are 16 << class bytes.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static unsigned int
+ememoa_memory_base_small_class (size_t size)
+{
+   unsigned int size_class = 0;
+
+   while ((16U << size_class) < size)
+     size_class++;
+
+   return size_class;
+}
+
+/**
+ * Tell if every block of a small page is in use.
+ *
+ * @param       heap    The static buffer.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static int
+ememoa_memory_base_small_full (const struct ememoa_memory_base_s *heap, const struct ememoa_memory_base_small_page_s *page)
+{
+   return page->free == 0 && page->fresh + (16U << page->size_class) > EMEMOA_PAGE_64M(heap);
+}
+
+/**
+ * Remove a small page from the list of its size class.
+ *
+ * @param       heap    The static buffer.
+ * @param       index   Page index of the small page.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static void
+ememoa_memory_base_small_unlink (struct ememoa_memory_base_s *heap, uint16_t index)
+{
+   struct ememoa_memory_base_small_page_s       *page = EMEMOA_SMALL_PAGE(heap, index);
+
+   if (page->prev != 0xFFFF)
+     EMEMOA_SMALL_PAGE(heap, page->prev)->next = page->next;
+   else
+     heap->small[page->size_class] = page->next;
+   if (page->next != 0xFFFF)
+     EMEMOA_SMALL_PAGE(heap, page->next)->prev = page->prev;
+
+   page->next = 0xFFFF;
+   page->prev = 0xFFFF;
+}
+
+/**
+ * Carve a small block out of a page of its size class, so the metadata of the memory
+ * pools, which are mostly a few words, don't take a full page each. Pages with free
+ * blocks are kept in heap->small, full pages leave the list until one of their
+ * blocks is given back. The caller must hold heap->lock.
+ *
+ * @param       heap    The static buffer.
+ * @param       size    The asked size, at most heap->small_max.
+ * @return	NULL if not enough memory, or a correct pointer otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static void*
+ememoa_memory_base_alloc_small_64m (struct ememoa_memory_base_s *heap, size_t size)
+{
+   struct ememoa_memory_base_small_page_s       *page;
+   unsigned int                                 size_class = ememoa_memory_base_small_class (size);
+   uint16_t                                     index = heap->small[size_class];
+   uint8_t                                      *block;
+
+   if (index == 0xFFFF)
+     {
+        page = ememoa_memory_base_alloc_pages_64m (heap, 1);
+        if (page == NULL)
+          return NULL;
+
+        index = ((uint8_t*) page - (uint8_t*) EMEMOA_DATA_64M(heap)) >> heap->page_shift;
+        page->next = 0xFFFF;
+        page->prev = 0xFFFF;
+        page->free = 0;
+        page->fresh = EMEMOA_SMALL_HEADER;
+        page->used = 0;
+        page->size_class = size_class;
+        heap->small[size_class] = index;
+     }
+   else
+     page = EMEMOA_SMALL_PAGE(heap, index);
+
+   if (page->free)
+     {
+        block = (uint8_t*) page + page->free;
+        page->free = *(uint32_t*) block;
+     }
+   else
+     {
+        block = (uint8_t*) page + page->fresh;
+        page->fresh += 16 << size_class;
+     }
+   page->used++;
+
+   if (ememoa_memory_base_small_full (heap, page))
+     ememoa_memory_base_small_unlink (heap, index);
+
+   return block;
+}
+
+/**
+ * Give back a small block. An empty page goes back to the static buffer, unless it
+ * is the last page of its size class with free blocks. The caller must hold
+ * heap->lock.
+ *
+ * @param       heap    The static buffer.
+ * @param       ptr     Pointer given by ememoa_memory_base_alloc_small_64m.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static void
+ememoa_memory_base_free_small_64m (struct ememoa_memory_base_s *heap, void *ptr)
+{
+   uint16_t                                     index = ((uint8_t*) ptr - (uint8_t*) EMEMOA_DATA_64M(heap)) >> heap->page_shift;
+   struct ememoa_memory_base_small_page_s       *page = EMEMOA_SMALL_PAGE(heap, index);
+   int                                          full = ememoa_memory_base_small_full (heap, page);
+
+   *(uint32_t*) ptr = page->free;
+   page->free = (uint8_t*) ptr - (uint8_t*) page;
+   page->used--;
+
+   if (full)
+     {
+        page->next = heap->small[page->size_class];
+        page->prev = 0xFFFF;
+        if (page->next != 0xFFFF)
+          EMEMOA_SMALL_PAGE(heap, page->next)->prev = index;
+        heap->small[page->size_class] = index;
+     }
+
+   if (page->used == 0 && (page->next != 0xFFFF || page->prev != 0xFFFF))
+     {
+        ememoa_memory_base_small_unlink (heap, index);
+        ememoa_memory_base_free_pages_64m (heap, index);
+     }
+}
+
+/**
+ * Just allocate like malloc a new memory chunk from a static buffer. Allocations
+ * up to heap->small_max bytes share pages, bigger ones get whole pages.
+ *
+ * @param       heap    A static buffer created by ememoa_heap_init.
+ * @param       size    The asked size.
+ * @return	NULL if not enough memory, or a correct pointer otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void*
+ememoa_heap_alloc (ememoa_heap_t *heap, size_t size)
+{
+   size_t       real = (size >> heap->page_shift) + (size & EMEMOA_PAGE_MASK_64M(heap) ? 1 : 0);
+   void         *ptr;
+
+   if (real >= 0xFFFF)
+     return NULL;
+
+   LK(heap->lock);
+
+   if (size <= heap->small_max)
+     ptr = ememoa_memory_base_alloc_small_64m (heap, size);
+   else
+     ptr = ememoa_memory_base_alloc_pages_64m (heap, real);
+
+   ULK(heap->lock);
+
+   if (ptr)
+     {
+        EMEMOA_TRACE2(base_64m_alloc, size, ptr);
+     }
+
+   return ptr;
+}
+
+/**
+ * Just free like free a memory chunk previously allocated by ememoa_heap_alloc.
+ * Page allocations are page aligned, small blocks never are.
+ *
+ * @param       heap    The static buffer the chunk comes from.
+ * @param       ptr     Pointer to be freed.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void
+ememoa_heap_free (ememoa_heap_t *heap, void *ptr)
+{
+   uint8_t      *data = EMEMOA_DATA_64M(heap);
+   unsigned int delta = (uint8_t*) ptr - data;
+
+   if (ptr == NULL)
+     return ;
+
+   assert ((uint8_t*) ptr >= data);
+
+   LK(heap->lock);
+
+   if (delta & EMEMOA_PAGE_MASK_64M(heap))
+     {
+        EMEMOA_TRACE2(base_64m_free, 16 << EMEMOA_SMALL_PAGE(heap, delta >> heap->page_shift)->size_class, ptr);
+        ememoa_memory_base_free_small_64m (heap, ptr);
+     }
+   else
+     {
+        EMEMOA_TRACE2(base_64m_free, EMEMOA_CHUNKS_64M(heap)[EMEMOA_TAGS_64M(heap)[delta >> heap->page_shift]].length << heap->page_shift, ptr);
+        ememoa_memory_base_free_pages_64m (heap, delta >> heap->page_shift);
+     }
+
+   ULK(heap->lock);
+}
+
+/**
+ * Just resize a memory chunk like realloc. Will not resize block to a smaller size.
+ *
+ * @param       heap    The static buffer the chunk comes from.
+ * @param       ptr     Pointer to the current pointer allocated by ememoa_heap_alloc.
+ * @param       size    The new asked size.
+ * @return	NULL if not enough memory, or a correct pointer otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void*
+ememoa_heap_realloc (ememoa_heap_t *heap, void *ptr, size_t size)
+{
+   struct ememoa_memory_base_chunck_s      *chunks = EMEMOA_CHUNKS_64M(heap);
+   uint16_t                                *tags = EMEMOA_TAGS_64M(heap);
+   uint8_t                                 *data = EMEMOA_DATA_64M(heap);
+   void*                                   tmp;
+   unsigned int                            delta = (uint8_t*) ptr - data;
+   size_t                                  real = (size >> heap->page_shift) + (size & EMEMOA_PAGE_MASK_64M(heap) ? 1 : 0);
+   uint16_t                                index;
+   uint16_t                                chunk_index;
+   uint16_t                                next_chunk_index;
+
+   if (ptr == NULL)
+     return ememoa_heap_alloc (heap, size);
+
+   assert ((uint8_t*) ptr >= data);
+
+   index = delta >> heap->page_shift;
+
+   /* A small block is moved as soon as it doesn't fit in its size class anymore. */
+   if (delta & EMEMOA_PAGE_MASK_64M(heap))
+     {
+        unsigned int    block = 16 << EMEMOA_SMALL_PAGE(heap, index)->size_class;
+
+        if (size <= block)
+          return ptr;
+
+        tmp = ememoa_heap_alloc (heap, size);
+        if (!tmp)
+          return NULL;
+
+        memcpy (tmp, ptr, block);
+        ememoa_heap_free (heap, ptr);
+
+        return tmp;
+     }
+
+   chunk_index = tags[index];
+
+   /* FIXME: Not resizing when the size is big enough */
+   if (real <= chunks[chunk_index].length)
+     return ptr;
+   if (real >= 0xFFFF)
+     return NULL;
+
+   LK(heap->lock);
+
+   next_chunk_index = (unsigned int) chunks[chunk_index].end + 1 < heap->chunks_count
+     ? tags[chunks[chunk_index].end + 1] : 0xFFFF;
+
+   if (next_chunk_index != 0xFFFF && chunks[next_chunk_index].use == 0)
+     if (real <= chunks[next_chunk_index].length + chunks[chunk_index].length)
+       {
+          uint16_t      splitted;
+          uint16_t      allocated;
+	  int           tmp;
+
+	  total -= chunks[chunk_index].length;
+	  tmp = chunks[chunk_index].length;
+
+	  ememoa_memory_base_remove_from_list(heap, next_chunk_index);
+          chunk_index = ememoa_memory_base_merge_64m(heap, chunk_index, next_chunk_index);
+          chunks[chunk_index].use = 1;
+
+          /* The left part keeps the data, and split always mark it as used. */
+          splitted = ememoa_memory_base_split_64m (heap, chunk_index, real);
+          allocated = splitted != 0xFFFF && chunks[splitted].use == 1 ? splitted : chunk_index;
+
+	  total += real;
+#ifdef ALLOC_REPORT
+	  fprintf(stderr, "realloc %i(%i) [%i] => %p\n", (real - tmp) << heap->page_shift, size, total << heap->page_shift, data + ((size_t) chunks[allocated].start << heap->page_shift));
+#endif
+	  EMEMOA_TRACE3(base_64m_realloc, ptr, size, data + ((size_t) chunks[allocated].start << heap->page_shift));
+
+	  ULK(heap->lock);
+
+          return data + ((size_t) chunks[allocated].start << heap->page_shift);
+       }
+
+   ULK(heap->lock);
+
+   tmp = ememoa_heap_alloc (heap, size);
+   if (!tmp)
+     return NULL;
+
+   memcpy(tmp, ptr, (size_t) chunks[chunk_index].length << heap->page_shift);
+   ememoa_heap_free (heap, ptr);
+
+   return tmp;
+}
+
+/* Allocators used by ememoa_memory_base_alloc and friends once a static buffer is set up. */
+static void*
+ememoa_memory_base_alloc_64m (size_t size)
+{
+   return ememoa_heap_alloc (base_64m, size);
+}
+
+static void
+ememoa_memory_base_free_64m (void* ptr)
+{
+   ememoa_heap_free (base_64m, ptr);
+}
+
+static void*
+ememoa_memory_base_realloc_64m (void* ptr, size_t size)
+{
+   return ememoa_heap_realloc (base_64m, ptr, size);
+}
+
+/**
+ * Make a static buffer the one used by all malloc/realloc/free operation of ememoa.
+ *
+ * @param       heap    An initialized static buffer.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void
+ememoa_memory_base_use_64m (struct ememoa_memory_base_s *heap)
+{
+   base_64m = heap;
+
+   ememoa_memory_base_alloc = ememoa_memory_base_alloc_64m;
+   ememoa_memory_base_free = ememoa_memory_base_free_64m;
+   ememoa_memory_base_realloc = ememoa_memory_base_realloc_64m;
+}
+
+/**
+ * Give the page shift of a page size.
+ *
+ * @param       page_size       A power of two from 256 bytes to 2MB.
+ * @return	Will return the page shift, or @c 0 if the page size is not supported.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static unsigned int
+ememoa_memory_base_page_shift (unsigned int page_size)
+{
+   unsigned int page_shift;
+
+   for (page_shift = EMEMOA_PAGE_SHIFT_MIN; page_shift <= EMEMOA_PAGE_SHIFT_MAX; ++page_shift)
+     if ((1U << page_shift) == page_size)
+       return page_shift;
+
+   return 0;
+}
+
+/**
+ * Lay out the header, the chunks, the pages and the data of a static buffer.
+ * At most 65534 pages are used, the end of a bigger buffer is ignored.
+ *
+ * @param       buffer  The static buffer from which pointer will be given.
+ * @param       size    The size of the buffer.
+ * @param       page_shift      Page size of the buffer as a power of two.
+ * @param       shared  Non zero if other processes will use the buffer too.
+ * @return	Will return the new static buffer, or @c NULL if the buffer is too small.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static struct ememoa_memory_base_s*
+ememoa_memory_base_layout_64m (void* buffer, unsigned int size, unsigned int page_shift, int shared)
+{
+   struct ememoa_memory_base_s          *new_64m = buffer;
+   struct ememoa_memory_base_chunck_s   *chunks;
+   unsigned int                         temp_size;
+   uintptr_t                            base;
+#ifdef HAVE_PTHREAD
+   pthread_mutexattr_t                  attr;
+#endif
+
+   if (!new_64m)
+     return NULL;
+
+   if (size <= sizeof (struct ememoa_memory_base_s))
+     return NULL;
+   temp_size = (size - sizeof (struct ememoa_memory_base_s)) >> page_shift;
+   if (temp_size <= 1)
+     return NULL;
+   /* Chunks and pages are indexed by uint16_t, 0xFFFF meaning none. */
+   if (temp_size > 0xFFFE)
+     temp_size = 0xFFFE;
+
+   /* Pages start on a page boundary, so every allocation is page aligned. */
+   base = (uintptr_t) ((uint16_t*) ((struct ememoa_memory_base_chunck_s*) ((struct ememoa_memory_base_s*) new_64m + 1) + temp_size + 1) + temp_size + 1);
+   base = (base + ((uintptr_t) 1 << page_shift) - 1) & ~(((uintptr_t) 1 << page_shift) - 1);
+   if (base >= (uintptr_t) buffer + size
+       || (((uintptr_t) buffer + size - base) >> page_shift) <= 1)
+     return NULL;
+
+#ifdef DEBUG
+   new_64m->magic = EMEMOA_MAGIC;
+#endif
+   new_64m->chunks_offset = sizeof (struct ememoa_memory_base_s);
+   new_64m->pages_offset = new_64m->chunks_offset + sizeof (struct ememoa_memory_base_chunck_s) * (temp_size + 1);
+   new_64m->data_offset = base - (uintptr_t) buffer;
+   new_64m->size = size;
+   new_64m->page_shift = page_shift;
+   new_64m->start = 0;
+
+   /* Small pages hold at least two blocks. */
+   for (new_64m->small_max = EMEMOA_SMALL_MAX;
+        new_64m->small_max > 16
+          && 2 * new_64m->small_max > (1U << page_shift) - EMEMOA_SMALL_HEADER;
+        new_64m->small_max >>= 1)
+     ;
+
+   new_64m->chunks_count = ((uintptr_t) buffer + size - base) >> page_shift;
+   if (new_64m->chunks_count > temp_size)
+     new_64m->chunks_count = temp_size;
+
+   chunks = (struct ememoa_memory_base_chunck_s*) ((uint8_t*) new_64m + new_64m->chunks_offset);
+
+   memset (chunks, 0xFF, sizeof (struct ememoa_memory_base_chunck_s) * temp_size);
+   memset ((uint8_t*) new_64m + new_64m->pages_offset, 0, sizeof (uint16_t) * temp_size);
+
+   chunks[0].start = 0;
+   chunks[0].end = new_64m->chunks_count - 1;
+   chunks[0].length = new_64m->chunks_count;
+   chunks[0].next = 0xFFFF;
+   chunks[0].prev = 0xFFFF;
+   chunks[0].use = 0;
+   new_64m->over = 0;
+   new_64m->start = 0;
+   new_64m->jump = 1;
+   memset (new_64m->small, 0xFF, sizeof (new_64m->small));
+
+#ifdef HAVE_PTHREAD
+   pthread_mutexattr_init (&attr);
+   if (shared && pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED))
+     {
+        pthread_mutexattr_destroy (&attr);
+        return NULL;
+     }
+   pthread_mutex_init (&(new_64m->lock), &attr);
+   pthread_mutexattr_destroy (&attr);
+#endif
+
+   /* Written last, an other process must not attach to a half built buffer. */
+   __atomic_store_n (&new_64m->shared, shared ? EMEMOA_SHARED_MAGIC : 0, __ATOMIC_RELEASE);
+
+   return new_64m;
+}
+
+/**
+ * Lay out a static buffer and make it the one used by all malloc/realloc/free
+ * operation of ememoa.
+ *
+ * @param       buffer  The static buffer from which pointer will be given.
+ * @param       size    The size of the buffer.
+ * @param       page_shift      Page size of the buffer as a power of two.
+ * @param       shared  Non zero if other processes will use the buffer too.
+ * @return	Will return @c 0 on success and @c -1 if the buffer is too small.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_setup_64m (void* buffer, unsigned int size, unsigned int page_shift, int shared)
+{
+   struct ememoa_memory_base_s  *heap;
+
+   heap = ememoa_memory_base_layout_64m (buffer, size, page_shift, shared);
+   if (heap == NULL)
+     return -1;
+
+   ememoa_memory_base_use_64m (heap);
+
+   return 0;
+}
+
+/**
+ * Give the static buffer in use.
+ *
+ * @return	Will return @c NULL if ememoa doesn't use a static buffer.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+struct ememoa_memory_base_s*
+ememoa_memory_base_current_64m (void)
+{
+   if (ememoa_memory_base_alloc != ememoa_memory_base_alloc_64m)
+     return NULL;
+   return base_64m;
+}
+
+/**
+ * Switch all malloc/realloc/free operation of ememoa to static buffer allocation. You must call
+ * this function before using any other ememoa operation.
+ *
+ * @param       buffer  The static buffer from which pointer will be given.
+ * @param       size    The new asked size.
+ * @return	NULL if not enough memory, or a correct pointer otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_init_64m (void* buffer, unsigned int size)
+{
+   return ememoa_memory_base_setup_64m (buffer, size, 12, 0);
+}
+
+/**
+ * Same as ememoa_memory_base_init_64m with a chosen page size. Every allocation
+ * bigger than a small block takes whole pages, and the buffer has at most 65534
+ * pages. Big pages suit memory pools with big blocks and big buffers, small pages
+ * suit tiny buffers.
+ *
+ * @code
+ * static uint8_t	heap[64 * 1024];
+ *
+ * ememoa_memory_base_init_ext_64m (heap, sizeof (heap), 256, 0);
+ * @endcode
+ *
+ * @param       buffer          The static buffer from which pointer will be given.
+ * @param       size            The size of the buffer.
+ * @param       page_size       A power of two from 256 bytes to 2MB.
+ * @param       shared          Non zero to share the buffer with other processes, see
+ *                              ememoa_memory_base_init_shared_64m.
+ * @return	Will return @c 0 on success and @c -1 if the page size is not supported
+ *		or the buffer is too small.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_init_ext_64m (void *buffer, unsigned int size, unsigned int page_size, int shared)
+{
+   unsigned int page_shift = ememoa_memory_base_page_shift (page_size);
+
+   if (page_shift == 0)
+     return -1;
+
+   return ememoa_memory_base_setup_64m (buffer, size, page_shift, shared);
+}
+
+/**
+ * Create a static buffer independent of the one ememoa_memory_base_alloc uses. It
+ * has its own lock and its own pages, so a subsystem could keep its memory pools
+ * in it without sharing anything with the others. Memory pools use it when the
+ * backend filled by ememoa_heap_backend is given in their description.
+ *
+ * @code
+ * struct ememoa_memory_backend_s	backend;
+ * struct ememoa_mempool_desc_s		desc = { "worker", NULL, NULL, &backend };
+ * ememoa_heap_t			*heap;
+ *
+ * heap = ememoa_heap_init (buffer, size, 4096);
+ * ememoa_heap_backend (heap, &backend);
+ * pool = ememoa_mempool_fixed_init (sizeof (struct job_s), 5, 0, &desc);
+ * @endcode
+ *
+ * @param       buffer          The static buffer from which pointer will be given.
+ * @param       size            The size of the buffer.
+ * @param       page_size       A power of two from 256 bytes to 2MB.
+ * @return	Will return the heap, it starts at buffer, or @c NULL if the page size
+ *		is not supported or the buffer is too small.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+ememoa_heap_t*
+ememoa_heap_init (void *buffer, unsigned int size, unsigned int page_size)
+{
+   unsigned int page_shift = ememoa_memory_base_page_shift (page_size);
+
+   if (page_shift == 0)
+     return NULL;
+
+   return ememoa_memory_base_layout_64m (buffer, size, page_shift, 0);
+}
+
+static void*
+ememoa_heap_backend_alloc (void *ctx, size_t size)
+{
+   return ememoa_heap_alloc (ctx, size);
+}
+
+static void
+ememoa_heap_backend_free (void *ctx, void *ptr)
+{
+   ememoa_heap_free (ctx, ptr);
+}
+
+static void*
+ememoa_heap_backend_realloc (void *ctx, void *ptr, size_t size)
+{
+   return ememoa_heap_realloc (ctx, ptr, size);
+}
+
+static unsigned int
+ememoa_heap_backend_alignment (void *ctx, size_t size)
+{
+   return ememoa_heap_alignment (ctx, size);
+}
+
+static size_t
+ememoa_heap_backend_granularity (void *ctx, size_t size)
+{
+   return ememoa_heap_granularity (ctx, size);
+}
+
+/**
+ * Fill a backend that gives memory from a static buffer, to be given to memory
+ * pools in their description. Memory pools copy it, it could be a local variable.
+ *
+ * @param       heap            A static buffer created by ememoa_heap_init.
+ * @param       backend         The backend to fill.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void
+ememoa_heap_backend (ememoa_heap_t *heap, struct ememoa_memory_backend_s *backend)
+{
+   backend->alloc = ememoa_heap_backend_alloc;
+   backend->free = ememoa_heap_backend_free;
+   backend->realloc = ememoa_heap_backend_realloc;
+   backend->alignment = ememoa_heap_backend_alignment;
+   backend->granularity = ememoa_heap_backend_granularity;
+   backend->ctx = heap;
+}
+
+/**
+ * Same as ememoa_memory_base_init_64m, but other processes could then use the same
+ * buffer with ememoa_memory_base_attach_shared_64m. The buffer must come from a
+ * MAP_SHARED mapping. All its metadata are offsets and it is protected by a process
+ * shared lock, so each process could map it at a different address. Pointers are
+ * exchanged between processes with ememoa_memory_base_offset_64m and
+ * ememoa_memory_base_pointer_64m.
+ *
+ * Only the static buffer is shared: fixed and unknown size memory pools keep their
+ * own metadata in each process, an object must be given back by the process that
+ * took it from them.
+ *
+ * @param       buffer  The shared buffer from which pointer will be given.
+ * @param       size    Size of the buffer.
+ * @return	Will return @c 0 on success, @c -1 if the buffer is too small or if
+ *		ememoa was built without thread support.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_init_shared_64m (void* buffer, unsigned int size)
+{
+#ifdef HAVE_PTHREAD
+   return ememoa_memory_base_setup_64m (buffer, size, 12, 1);
+#else
+   (void) buffer;
+   (void) size;
+   return -1;
+#endif
+}
+
+/**
+ * Check that a buffer was initialized by ememoa_memory_base_init_shared_64m.
+ *
+ * @param       buffer  This process mapping of the shared buffer.
+ * @return	Will return the static buffer header, or @c NULL if it is not one.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+static struct ememoa_memory_base_s*
+ememoa_memory_base_shared_heap_64m (void* buffer)
+{
+   struct ememoa_memory_base_s  *heap = buffer;
+
+   if (heap == NULL
+       || __atomic_load_n (&heap->shared, __ATOMIC_ACQUIRE) != EMEMOA_SHARED_MAGIC)
+     return NULL;
+
+   EMEMOA_CHECK_MAGIC(heap);
+
+   return heap;
+}
+
+/**
+ * Switch all malloc/realloc/free operation of ememoa to a static buffer already
+ * initialized by an other process with ememoa_memory_base_init_shared_64m.
+ *
+ * @param       buffer  This process mapping of the shared buffer.
+ * @return	Will return @c 0 on success, @c -1 if the buffer was not initialized
+ *		as a shared buffer.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_attach_shared_64m (void* buffer)
+{
+   struct ememoa_memory_base_s  *heap = ememoa_memory_base_shared_heap_64m (buffer);
+
+   if (heap == NULL)
+     return -1;
+
+   ememoa_memory_base_use_64m (heap);
+
+   return 0;
+}
+
+/**
+ * Create an anonymous shared memory file of size bytes, map it and initialize it
+ * with ememoa_memory_base_init_shared_64m. The file descriptor could be inherited
+ * or sent to other processes, that call ememoa_memory_base_open_shared_64m on it.
+ *
+ * @param       size    Size of the shared buffer.
+ * @param       fd      Where to store the file descriptor of the shared memory.
+ * @return	Will return this process mapping of the buffer, or @c NULL on failure.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void*
+ememoa_memory_base_create_shared_64m (unsigned int size, int *fd)
+{
+   void         *buffer;
+   int          shm;
+
+#ifdef HAVE_MEMFD_CREATE
+   shm = memfd_create ("ememoa", MFD_CLOEXEC);
+#else
+   {
+      char      name[64];
+
+      snprintf (name, sizeof (name), "/ememoa-%i-%p", (int) getpid (), (void*) &name);
+      shm = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (shm >= 0)
+        shm_unlink (name);
+   }
+#endif
+   if (shm < 0)
+     return NULL;
+
+   if (ftruncate (shm, size))
+     goto on_error;
+
+   buffer = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+   if (buffer == MAP_FAILED)
+     goto on_error;
+
+   if (ememoa_memory_base_init_shared_64m (buffer, size))
+     {
+        munmap (buffer, size);
+        goto on_error;
+     }
+
+   *fd = shm;
+   return buffer;
+
+ on_error:
+   close (shm);
+   return NULL;
+}
+
+/**
+ * Map a shared buffer created by ememoa_memory_base_create_shared_64m in an other
+ * process and attach to it.
+ *
+ * @param       fd      File descriptor of the shared memory.
+ * @return	Will return this process mapping of the buffer, or @c NULL on failure.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void*
+ememoa_memory_base_open_shared_64m (int fd)
+{
+   struct ememoa_memory_base_s  *heap;
+   struct stat                  st;
+   void                         *buffer;
+
+   if (fstat (fd, &st) || st.st_size <= (off_t) sizeof (struct ememoa_memory_base_s))
+     return NULL;
+
+   buffer = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (buffer == MAP_FAILED)
+     return NULL;
+
+   /* Only switch to the buffer once it is known to be the right one. */
+   heap = ememoa_memory_base_shared_heap_64m (buffer);
+   if (heap == NULL || heap->size != (unsigned int) st.st_size)
+     {
+        munmap (buffer, st.st_size);
+        return NULL;
+     }
+
+   ememoa_memory_base_use_64m (heap);
+
+   return buffer;
+}
+
+/**
+ * Give the offset of a pointer inside the static buffer, it is the same in every
+ * process sharing the buffer.
+ *
+ * @param       ptr     A pointer inside the static buffer, or @c NULL.
+ * @return	Will return the offset, @c 0 for @c NULL.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+unsigned int
+ememoa_memory_base_offset_64m (const void *ptr)
+{
+   if (ptr == NULL)
+     return 0;
+
+   assert (base_64m != NULL);
+   assert ((const uint8_t*) ptr > (const uint8_t*) base_64m
+           && (const uint8_t*) ptr < (const uint8_t*) base_64m + base_64m->size);
+
+   return (const uint8_t*) ptr - (const uint8_t*) base_64m;
+}
+
+/**
+ * Give this process pointer for an offset returned by ememoa_memory_base_offset_64m.
+ *
+ * @param       offset  The offset, @c 0 for @c NULL.
+ * @return	Will return the pointer.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+void*
+ememoa_memory_base_pointer_64m (unsigned int offset)
+{
+   if (offset == 0)
+     return NULL;
+
+   assert (base_64m != NULL && offset < base_64m->size);
+
+   return (uint8_t*) base_64m + offset;
+}
+
+/**
+ * Give the number of pages of the static buffer allocator, how many are free and
+ * the length of the biggest free chunk. The free chunk list is sorted from the
+ * biggest chunk to the smallest.
+ *
+ * @param       page_size       Where to store the page size in bytes.
+ * @param       pages           Where to store the number of pages.
+ * @param       free_pages      Where to store the number of free pages.
+ * @param       largest_free    Where to store the number of pages of the biggest free chunk.
+ * @return	Will return @c -1 if the static buffer allocator is not in use, @c 0 otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+int
+ememoa_memory_base_footprint_64m (unsigned int *page_size,
+                                  unsigned int *pages,
+                                  unsigned int *free_pages,
+                                  unsigned int *largest_free)
+{
+   struct ememoa_memory_base_chunck_s   *chunks;
+   uint16_t                             index;
+
+   if (base_64m == NULL || ememoa_memory_base_alloc != ememoa_memory_base_alloc_64m)
+     return -1;
+
+   chunks = EMEMOA_CHUNKS_64M(base_64m);
+
+   LK(base_64m->lock);
+
+   *page_size = EMEMOA_PAGE_64M(base_64m);
+   *pages = base_64m->chunks_count;
+   *free_pages = 0;
+   *largest_free = base_64m->start != 0xFFFF ? chunks[base_64m->start].length : 0;
+
+   for (index = base_64m->start; index != 0xFFFF; index = chunks[index].next)
+     *free_pages += chunks[index].length;
+
+   ULK(base_64m->lock);
+
+   return 0;
+}
+
+/**
+ * Give the alignment a pointer returned by ememoa_heap_alloc for size bytes is
+ * guaranteed to have.
+ *
+ * @param       heap    A static buffer.
+ * @param	size	Size of the allocation.
+ * @return	Will return the page alignment for whole pages, the alignment of the
+ *		small blocks when they share a page.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+unsigned int
+ememoa_heap_alignment (const ememoa_heap_t *heap, size_t size)
+{
+   size_t       align;
+   size_t       block;
+
+   /* An other process may map a shared buffer at an address less aligned than its pages. */
+   for (align = EMEMOA_PAGE_64M(heap); (uintptr_t) EMEMOA_DATA_64M(heap) & (align - 1); align >>= 1)
+     ;
+
+   if (size > heap->small_max)
+     return align;
+   block = 16 << ememoa_memory_base_small_class (size);
+   if (block > EMEMOA_SMALL_HEADER)
+     block = EMEMOA_SMALL_HEADER;
+   return block < align ? block : align;
+}
+
+/**
+ * Give the alignment a pointer returned by ememoa_memory_base_alloc for size bytes is
+ * guaranteed to have.
+ *
+ * @param	size	Size of the allocation.
+ * @return	Will return the static buffer alignment when it is in use, see
+ *		ememoa_heap_alignment, the malloc guarantee otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+unsigned int
+ememoa_memory_base_alignment (size_t size)
+{
+   if (base_64m != NULL && ememoa_memory_base_alloc == ememoa_memory_base_alloc_64m)
+     return ememoa_heap_alignment (base_64m, size);
+   return 2 * sizeof (void*);
+}
+
+/* Above this size malloc use mmap, and transparent huge pages back the biggest mappings. */
+#define EMEMOA_MMAP_THRESHOLD	(128 * 1024)
+#define EMEMOA_HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+
+/**
+ * Give the size a static buffer really reserves for an allocation of size bytes is
+ * rounded to.
+ *
+ * @param       heap    A static buffer.
+ * @param	size	Size of the allocation.
+ * @return	Will return the page size, or the small block size when size bytes share
+ *		a page.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+size_t
+ememoa_heap_granularity (const ememoa_heap_t *heap, size_t size)
+{
+   return size > heap->small_max ? EMEMOA_PAGE_64M(heap) : 16U << ememoa_memory_base_small_class (size);
+}
+
+/**
+ * Give the size the memory allocator really reserves for an allocation of size bytes
+ * is rounded to. Asking for a multiple of it wastes nothing.
+ *
+ * @param	size	Size of the allocation.
+ * @return	Will return a power of two: the page size or the small block size for the
+ *		static buffer allocator, for malloc the page size or the huge page size once size is big enough for
+ *		malloc to use mmap, and its chunk alignment otherwise.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+size_t
+ememoa_memory_base_granularity (size_t size)
+{
+   if (base_64m != NULL && ememoa_memory_base_alloc == ememoa_memory_base_alloc_64m)
+     return ememoa_heap_granularity (base_64m, size);
+   if (size >= EMEMOA_HUGE_PAGE_SIZE)
+     return EMEMOA_HUGE_PAGE_SIZE;
+   if (size >= EMEMOA_MMAP_THRESHOLD)
+     return 4096;
+   return 2 * sizeof (void*);
+}
+
+/**
+ * Give the bytes the memory allocator adds in front of a block of size bytes inside
+ * its granularity. Asking for a multiple of the granularity minus this overhead
+ * wastes nothing.
+ *
+ * @param	size	Size of the allocation.
+ * @return	Will return the chunk header malloc puts in the pages it maps, @c 0 for the
+ *		static buffer allocator and when malloc granularity is its chunk alignment.
+ * @ingroup	Ememoa_Mempool_Base_64m
+ */
+size_t
+ememoa_memory_base_overhead (size_t size)
+{
+   if (base_64m != NULL && ememoa_memory_base_alloc == ememoa_memory_base_alloc_64m)
+     return 0;
+   if (size >= EMEMOA_MMAP_THRESHOLD)
+     return 2 * sizeof (size_t);
+   return 0;
+}
+
+/**
+ * @defgroup Ememoa_Mempool_Base_Map Large objects in their own pages.
+ *
+ */
+
+/**
+ * Tell if an object of size bytes should get its own pages instead of coming from
+ * ememoa_memory_base_alloc. Only malloc hands over to mmap, and it raises its own
+ * mmap threshold after each free of a mapped chunk, so big objects could later land
+ * in its heap where growing them copies everything.
+ *
+ * @param	size	Size of the object.
+ * @return	Will return @c 1 if the object should be mapped.
+ * @ingroup	Ememoa_Mempool_Base_Map
+ */
+int
+ememoa_memory_base_mappable (size_t size)
+{
+   return size >= EMEMOA_MMAP_THRESHOLD && ememoa_memory_base_alloc == malloc;
+}
+
+/**
+ * Give the length of the mapping of an object of size bytes.
  *
- * @param       ptr     Pointer to be freed.
- * @ingroup	Ememoa_Mempool_Base_64m
+ * @param	size	Size of the object.
+ * @return	Will return size rounded to the system page size.
+ * @ingroup	Ememoa_Mempool_Base_Map
  */
-static void
-ememoa_memory_base_free_64m (void* ptr)
+size_t
+ememoa_memory_base_map_length (size_t size)
 {
-   unsigned int delta = ptr - base_64m->base;
-   uint16_t     index;
-   uint16_t     chunk_index;
-   uint16_t     prev_chunk_index;
-   uint16_t     next_chunk_index;
-
-   if (ptr == NULL)
-     return ;
-
-   assert (ptr > base_64m->base);
-
-   LK(lockit);
-
-   index = delta >> 12;
-   chunk_index = base_64m->pages[index];
-
-   total -= base_64m->chunks[chunk_index].length;
-#ifdef ALLOC_REPORT
-   fprintf(stderr, "free %i [%i] => %p\n", base_64m->chunks[chunk_index].length, total << 12, ptr);
-#endif
+   static size_t        page = 0;
 
-   prev_chunk_index = base_64m->pages[index - 1];
-   next_chunk_index = base_64m->pages[base_64m->chunks[chunk_index].end + 1];
+   if (page == 0)
+     page = sysconf (_SC_PAGESIZE);
 
-   if (index > 0 && prev_chunk_index < base_64m->chunks_count)
-     if (base_64m->chunks[prev_chunk_index].use == 0)
-       {
-          ememoa_memory_base_remove_from_list(prev_chunk_index);
-          chunk_index = ememoa_memory_base_merge_64m(chunk_index, prev_chunk_index);
-       }
+   return (size + page - 1) & ~(page - 1);
+}
 
-   if (base_64m->chunks[chunk_index].end < base_64m->chunks_count
-       && next_chunk_index < base_64m->chunks_count)
-     if (base_64m->chunks[next_chunk_index].use == 0)
-       {
-          ememoa_memory_base_remove_from_list(next_chunk_index);
-          chunk_index = ememoa_memory_base_merge_64m(chunk_index, next_chunk_index);
-       }
+/**
+ * Map new anonymous pages.
+ *
+ * @param	length	Length given by ememoa_memory_base_map_length.
+ * @return	Will return @c NULL if the system is out of memory.
+ * @ingroup	Ememoa_Mempool_Base_Map
+ */
+void*
+ememoa_memory_base_map (size_t length)
+{
+   void         *ptr;
 
-   ememoa_memory_base_insert_in_list (chunk_index);
-   base_64m->chunks[chunk_index].use = 0;
+   ptr = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-   ULK(lockit);
+   return ptr == MAP_FAILED ? NULL : ptr;
 }
 
 /**
- * Just resize a memory chunk like realloc. Will not resize block to a smaller size.
+ * Resize a mapping. The kernel moves the pages to a new address when it can't grow
+ * them where they are, their content is never copied.
  *
- * @param       ptr     Pointer to the current pointer allocated by ememoa_memory_base_alloc_64m.
- * @param       size    The new asked size.
- * @return	NULL if not enough memory, or a correct pointer otherwise.
- * @ingroup	Ememoa_Mempool_Base_64m
+ * @param	ptr		Mapping given by ememoa_memory_base_map.
+ * @param	old_length	Its current length.
+ * @param	length		Its new length, given by ememoa_memory_base_map_length.
+ * @return	Will return the mapping, or @c NULL if the system is out of memory.
+ *		The old mapping is then left untouched.
+ * @ingroup	Ememoa_Mempool_Base_Map
  */
-static void*
-ememoa_memory_base_realloc_64m (void* ptr, size_t size)
+void*
+ememoa_memory_base_remap (void *ptr, size_t old_length, size_t length)
 {
-   void*        tmp;
-   unsigned int delta = ptr - base_64m->base;
-   uint16_t     real = (size >> 12) + (size & 0xFFF ? 1 : 0);
-   uint16_t     index;
-   uint16_t     chunk_index;
-   uint16_t     next_chunk_index;
+#ifdef HAVE_MREMAP
+   ptr = mremap (ptr, old_length, length, MREMAP_MAYMOVE);
 
-   if (ptr == NULL)
-     return ememoa_memory_base_alloc_64m(size);
+   return ptr == MAP_FAILED ? NULL : ptr;
+#else
+   void         *tmp;
 
-   assert (ptr > base_64m->base);
+   if (length <= old_length)
+     {
+        munmap ((uint8_t*) ptr + length, old_length - length);
+        return ptr;
+     }
 
-   index = delta >> 12;
-   chunk_index = base_64m->pages[index];
+   tmp = ememoa_memory_base_map (length);
+   if (tmp == NULL)
+     return NULL;
 
-   /* FIXME: Not resizing when the size is big enough */
-   if (real <= base_64m->chunks[chunk_index].length)
-     return ptr;
+   memcpy (tmp, ptr, old_length);
+   munmap (ptr, old_length);
 
-   LK(lockit);
+   return tmp;
+#endif
+}
 
-   next_chunk_index = base_64m->pages[base_64m->chunks[chunk_index].end + 1];
+/**
+ * Give back a mapping.
+ *
+ * @param	ptr	Mapping given by ememoa_memory_base_map.
+ * @param	length	Its length.
+ * @ingroup	Ememoa_Mempool_Base_Map
+ */
+void
+ememoa_memory_base_unmap (void *ptr, size_t length)
+{
+   munmap (ptr, length);
+}
 
-   if (base_64m->chunks[next_chunk_index].use == 0)
-     if (real <= base_64m->chunks[next_chunk_index].length + base_64m->chunks[chunk_index].length)
-       {
-          uint16_t      splitted;
-          uint16_t      allocated;
-	  int           tmp;
+/**
+ * @defgroup Ememoa_Mempool_Base_Resize_List Function enabling manipulation of array with linked list properties.
+ *
+ */
+#define RESIZE_POOL_SIZE 128
+struct ememoa_memory_base_resize_list_pool_s
+{
+   struct ememoa_memory_base_resize_list_pool_s *next;
 
-	  total -= base_64m->chunks[chunk_index].length;
-	  tmp = base_64m->chunks[chunk_index].length;
+   unsigned int					 count;
+#ifdef USE64
+   uint64_t					 map[2];
+#else
+   uint32_t					 map[4];
+#endif
+   struct ememoa_memory_base_resize_list_s	 array[RESIZE_POOL_SIZE];
+};
 
-	  ememoa_memory_base_remove_from_list(next_chunk_index);
-          chunk_index = ememoa_memory_base_merge_64m(chunk_index, next_chunk_index);
-          splitted = ememoa_memory_base_split_64m (chunk_index, real);
+static struct ememoa_memory_base_resize_list_pool_s *resize_pool = NULL;
 
-          allocated = base_64m->chunks[chunk_index].use == 1 ? chunk_index : splitted;
+/**
+ * Protect the resize_pool chain of list descriptors.
+ * @ingroup Ememoa_Mempool_Base_Resize_List
+ */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t resize_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
-          ememoa_memory_base_remove_from_list (allocated);
+/* Each list take this spinlock when it change its bitmaps or grow, readers never take it.
+   Segments are never freed under a reader, except by resize_list_garbage_collect whose
+   callers must keep the readers out. */
+#define RESIZE_LIST_LOCK(Base) \
+  while (__atomic_exchange_n (&(Base)->lock, 1, __ATOMIC_ACQUIRE)) \
+    while (__atomic_load_n (&(Base)->lock, __ATOMIC_RELAXED)) ;
 
-	  total += real;
-#ifdef ALLOC_REPORT
-	  fprintf(stderr, "realloc %i(%i) [%i] => %p\n", (real - tmp) << 12, size, total << 12, ((uint8_t*) base_64m->base) + (base_64m->chunks[allocated].start << 12));
-#endif
+#define RESIZE_LIST_UNLOCK(Base) \
+  __atomic_store_n (&(Base)->lock, 0, __ATOMIC_RELEASE);
 
-	  ULK(lockit);
+/* Segment n holds 32 << n items, so it starts at item 32 * (2^n - 1) and at bitmap word 2^n - 1. */
+#define RESIZE_LIST_SEGMENT_OF_WORD(Word) (31 - __builtin_clz ((Word) + 1))
+#define RESIZE_LIST_SEGMENT_FIRST_WORD(Segment) ((1U << (Segment)) - 1)
+#define RESIZE_LIST_SEGMENT_ITEMS(Segment) (32U << (Segment))
 
-          return ((uint8_t*) base_64m->base) + (base_64m->chunks[allocated].start << 12);
-       }
+/**
+ * Give the items of a segment, they are followed by the segment bitmap.
+ *
+ * @param       base    Pointer to a valid and activ list.
+ * @param       segment Segment index.
+ * @return	Will return a pointer to the first item of the segment.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+static inline uint8_t*
+ememoa_memory_base_resize_list_segment (struct ememoa_memory_base_resize_list_s *base, unsigned int segment)
+{
+   return __atomic_load_n (&base->segments[segment], __ATOMIC_ACQUIRE);
+}
 
-   ULK(lockit);
+/**
+ * Give a bitmap word of the list.
+ *
+ * @param       base    Pointer to a valid and activ list.
+ * @param       word    Index of the word (item index >> 5).
+ * @return	Will return a pointer to the word.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+static inline uint32_t*
+ememoa_memory_base_resize_list_word (struct ememoa_memory_base_resize_list_s *base, unsigned int word)
+{
+   unsigned int segment = RESIZE_LIST_SEGMENT_OF_WORD(word);
 
-   tmp = ememoa_memory_base_alloc_64m(size);
-   if (!tmp)
-     return NULL;
+   return (uint32_t*) (ememoa_memory_base_resize_list_segment (base, segment)
+                       + (size_t) base->size * RESIZE_LIST_SEGMENT_ITEMS(segment))
+     + (word - RESIZE_LIST_SEGMENT_FIRST_WORD(segment));
+}
 
-   memcpy(tmp, ptr, base_64m->chunks[chunk_index].length << 12);
-   ememoa_memory_base_free_64m(ptr);
+/**
+ * Give the pointer of an item without any check.
+ *
+ * @param       base    Pointer to a valid and activ list.
+ * @param       index   Item index.
+ * @return	Will return a pointer to the item.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+static inline void*
+ememoa_memory_base_resize_list_item (struct ememoa_memory_base_resize_list_s *base, unsigned int index)
+{
+   unsigned int segment = RESIZE_LIST_SEGMENT_OF_WORD(index >> 5);
 
-   return tmp;
+   return ememoa_memory_base_resize_list_segment (base, segment)
+     + (size_t) base->size * (index - (RESIZE_LIST_SEGMENT_FIRST_WORD(segment) << 5));
 }
 
 /**
- * Switch all malloc/realloc/free operation of ememoa to static buffer allocation. You must call
- * this function before using any other ememoa operation.
+ * Add one more segment at the end of the list. Must be called with the list lock held.
+ * Items already given never move, readers see the new segment only once it is ready.
  *
- * @param       buffer  The static buffer from which pointer will be given.
- * @param       size    The new asked size.
- * @return	NULL if not enough memory, or a correct pointer otherwise.
- * @ingroup	Ememoa_Mempool_Base_64m
+ * @param       base    Pointer to a valid and activ list.
+ * @return	Will return @c 0 if the list grew.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
  */
-int
-ememoa_memory_base_init_64m (void* buffer, unsigned int size)
+static int
+ememoa_memory_base_resize_list_grow (struct ememoa_memory_base_resize_list_s *base)
 {
-   struct ememoa_memory_base_s  *new_64m = buffer;
-   unsigned int                 temp_size;
+   unsigned int segment = base->segments_count;
+   size_t       items = RESIZE_LIST_SEGMENT_ITEMS(segment);
+   uint8_t      *tmp;
 
-   if (!new_64m)
+   if (segment >= EMEMOA_RESIZE_LIST_SEGMENTS)
      return -1;
 
-   temp_size = (size - sizeof (struct ememoa_memory_base_s)) >> 12;
-   if (temp_size <= 1)
+   tmp = ememoa_memory_base_alloc ((size_t) base->size * items + (items >> 5) * sizeof (uint32_t));
+   if (!tmp)
      return -1;
 
 #ifdef DEBUG
-   new_64m->magic = EMEMOA_MAGIC;
+   memset (tmp, 43, (size_t) base->size * items);
 #endif
-   new_64m->chunks = (struct ememoa_memory_base_chunck_s*) ((struct ememoa_memory_base_s*) new_64m + 1);
-   new_64m->pages = (uint16_t*)((struct ememoa_memory_base_chunck_s*) new_64m->chunks + temp_size + 1);
-   new_64m->base = ((uint16_t*) new_64m->pages + temp_size + 1);
-   new_64m->start = 0;
-
-   new_64m->chunks_count = (size
-                            - sizeof (struct ememoa_memory_base_s)
-                            - temp_size * (sizeof (struct ememoa_memory_base_chunck_s) + sizeof (uint16_t)))
-     / 4096;
-
-
-   memset (new_64m->chunks, 0xFF, sizeof (struct ememoa_memory_base_chunck_s) * temp_size);
-   memset (new_64m->pages, 0, sizeof (uint16_t) * temp_size);
+   memset (tmp + (size_t) base->size * items, 0xFF, (items >> 5) * sizeof (uint32_t));
 
-   new_64m->chunks[0].start = 0;
-   new_64m->chunks[0].end = new_64m->chunks_count - 1;
-   new_64m->chunks[0].length = new_64m->chunks_count;
-   new_64m->chunks[0].next = 0xFFFF;
-   new_64m->chunks[0].prev = 0xFFFF;
-   new_64m->chunks[0].use = 0;
-   new_64m->over = 0;
-   new_64m->start = 0;
-   new_64m->jump = 1;
-
-   base_64m = new_64m;
-
-   ememoa_memory_base_alloc = ememoa_memory_base_alloc_64m;
-   ememoa_memory_base_free = ememoa_memory_base_free_64m;
-   ememoa_memory_base_realloc = ememoa_memory_base_realloc_64m;
+   __atomic_store_n (&base->segments[segment], tmp, __ATOMIC_RELEASE);
+   base->segments_count = segment + 1;
+   __atomic_store_n (&base->count, base->count + items, __ATOMIC_RELEASE);
 
    return 0;
 }
 
 /**
- * @defgroup Ememoa_Mempool_Base_Resize_List Function enabling manipulation of array with linked list properties.
- *
- */
-#define RESIZE_POOL_SIZE 128
-struct ememoa_memory_base_resize_list_pool_s
-{
-   struct ememoa_memory_base_resize_list_pool_s *next;
-
-   unsigned int					 count;
-#ifdef USE64
-   uint64_t					 map[2];
-#else
-   uint32_t					 map[4];
-#endif
-   struct ememoa_memory_base_resize_list_s	 array[RESIZE_POOL_SIZE];
-};
-
-static struct ememoa_memory_base_resize_list_pool_s *resize_pool = NULL;
-
-/**
- * Allocate a new resizable list (it's an array now). It currently use to much memory
- * when using the base_64m allocator, it could be fixed if really usefull (Not high priority at this time).
+ * Allocate a new resizable list. Its items never move once given, so pointers to them
+ * stay valid until they are given back.
  *
  * @param       size    items size inside the list.
  * @return	Will return a pointer to the base array.
@@ -507,13 +1634,19 @@ ememoa_memory_base_resize_list_new (unsigned int size)
    if (size == 0)
      return NULL;
 
+   LK(resize_pool_lock);
+
    for (over = resize_pool; over && over->count == RESIZE_POOL_SIZE; over = over->next)
      ;
 
    if (!over)
      {
 	over = ememoa_memory_base_alloc (sizeof (struct ememoa_memory_base_resize_list_pool_s));
-	if (!over) return NULL;
+	if (!over)
+          {
+             ULK(resize_pool_lock);
+             return NULL;
+          }
 
 	over->next = resize_pool;
 	over->count = 0;
@@ -556,6 +1689,8 @@ ememoa_memory_base_resize_list_new (unsigned int size)
    mask <<= pos;
    over->map[i] &= ~mask;
 
+   ULK(resize_pool_lock);
+
    bzero (tmp, sizeof (struct ememoa_memory_base_resize_list_s));
    tmp->size = size;
 
@@ -566,6 +1701,76 @@ ememoa_memory_base_resize_list_new (unsigned int size)
    return tmp;
 }
 
+/**
+ * Give the chain of list descriptors, so a persistent buffer could save it.
+ *
+ * @return	Will return the first block of list descriptors.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+void*
+ememoa_memory_base_resize_list_pools (void)
+{
+   return resize_pool;
+}
+
+/**
+ * Use again a chain of list descriptors saved by a previous process. The spinlock
+ * of each list is released, the process that held it is gone.
+ *
+ * @param       pools   The saved chain.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+void
+ememoa_memory_base_resize_list_restore (void *pools)
+{
+   struct ememoa_memory_base_resize_list_pool_s *over;
+   unsigned int                                 i;
+
+   LK(resize_pool_lock);
+
+   resize_pool = pools;
+   for (over = resize_pool; over; over = over->next)
+     for (i = 0; i < RESIZE_POOL_SIZE; ++i)
+       over->array[i].lock = 0;
+
+   ULK(resize_pool_lock);
+}
+
+/**
+ * Give the shared list stored in *list, creating it on first use. Safe to call from
+ * many threads at the same time, only one list will ever be created.
+ *
+ * @param       list    Where the shared list is stored.
+ * @param       size    items size inside the list.
+ * @return	Will return the shared list or NULL if it could not be created.
+ * @ingroup	Ememoa_Mempool_Base_Resize_List
+ */
+struct ememoa_memory_base_resize_list_s*
+ememoa_memory_base_resize_list_shared (struct ememoa_memory_base_resize_list_s **list, unsigned int size)
+{
+   struct ememoa_memory_base_resize_list_s      *tmp;
+#ifdef HAVE_PTHREAD
+   static pthread_mutex_t                       shared_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+   tmp = __atomic_load_n (list, __ATOMIC_ACQUIRE);
+   if (tmp)
+     return tmp;
+
+   LK(shared_lock);
+
+   tmp = __atomic_load_n (list, __ATOMIC_ACQUIRE);
+   if (!tmp)
+     {
+        tmp = ememoa_memory_base_resize_list_new (size);
+        __atomic_store_n (list, tmp, __ATOMIC_RELEASE);
+     }
+
+   ULK(shared_lock);
+
+   return tmp;
+}
+
 /**
  * Clean a list and all it's item.
  *
@@ -576,6 +1781,7 @@ void
 ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*  base)
 {
    struct ememoa_memory_base_resize_list_pool_s *over;
+   unsigned int i;
    int index;
 
    if (!base)
@@ -583,8 +1789,8 @@ ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*
 
    EMEMOA_CHECK_MAGIC(base);
 
-   ememoa_memory_base_free (base->pool);
-   ememoa_memory_base_free (base->bitmap);
+   for (i = 0; i < base->segments_count; ++i)
+     ememoa_memory_base_free (base->segments[i]);
 
 #ifdef DEBUG
    if (base->actif != 0)
@@ -595,6 +1801,8 @@ ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*
    base->magic = 0;
 #endif
 
+   LK(resize_pool_lock);
+
    for (over = resize_pool;
 	over && !(over->array <= base && base < over->array + RESIZE_POOL_SIZE);
 	over = over->next)
@@ -605,10 +1813,13 @@ ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*
    index = base - over->array;
 
 #ifdef USE64
-   over->map[index / 64] |= (1 << (index % 64));
+   over->map[index / 64] |= ((uint64_t) 1 << (index % 64));
 #else
    over->map[index / 32] |= (1 << (index % 32));
 #endif
+   over->count--;
+
+   ULK(resize_pool_lock);
 }
 
 /**
@@ -621,6 +1832,7 @@ ememoa_memory_base_resize_list_clean (struct ememoa_memory_base_resize_list_s*
 int
 ememoa_memory_base_resize_list_new_item (struct ememoa_memory_base_resize_list_s *base)
 {
+   uint32_t             *word;
    int                  i;
 
    if (base == NULL)
@@ -628,50 +1840,37 @@ ememoa_memory_base_resize_list_new_item (struct ememoa_memory_base_resize_list_s
 
    EMEMOA_CHECK_MAGIC(base);
 
-   if (base->count < base->actif + 1)
-     {
-        unsigned int    count;
-        uint32_t        *tmp_bitmap;
-        void            *tmp_pool;
-
-        count = base->count + 32;
-
-        tmp_pool = ememoa_memory_base_realloc (base->pool, count * base->size);
-        if (!tmp_pool)
-          return -1;
-        base->pool = tmp_pool;
+   RESIZE_LIST_LOCK(base);
 
-        tmp_bitmap = ememoa_memory_base_realloc (base->bitmap, (count >> 5) * sizeof (uint32_t));
-        if (!tmp_bitmap)
+   if (base->count < base->actif + 1)
+     if (ememoa_memory_base_resize_list_grow (base))
+       {
+          RESIZE_LIST_UNLOCK(base);
           return -1;
-        base->bitmap = tmp_bitmap;
-
-        base->bitmap[base->count >> 5] = 0xFFFFFFFF;
-
-#ifdef DEBUG
-        memset ((uint8_t*) tmp_pool + base->count * base->size, 43, base->size * 32);
-#endif
-        base->count = count;
-
-     }
+       }
 
-   for (; base->jump < (base->count >> 5) && base->bitmap[base->jump] == 0; ++base->jump)
+   for (; base->jump < (base->count >> 5) && *ememoa_memory_base_resize_list_word (base, base->jump) == 0; ++base->jump)
      ;
 
    assert (base->jump < (base->count >> 5));
 
-   i = ffs(base->bitmap[base->jump]) - 1;
+   word = ememoa_memory_base_resize_list_word (base, base->jump);
+   i = ffs(*word) - 1;
 
    assert (i >= 0 && i < 32);
 
-   base->bitmap[base->jump] &= ~(1 << i);
+   __atomic_and_fetch (word, ~(1U << i), __ATOMIC_RELEASE);
    base->actif++;
+   i += base->jump << 5;
+
+   RESIZE_LIST_UNLOCK(base);
 
-   return (base->jump << 5) + i;
+   return i;
 }
 
 /**
- * Allocate a set of new items in the list "base".
+ * Allocate a set of new items in the list "base". The items are contiguous in memory,
+ * so they are always taken inside one segment.
  *
  * @param       base    Pointer to a valid and activ list.
  * @param       count   Number of item to return.
@@ -681,125 +1880,58 @@ ememoa_memory_base_resize_list_new_item (struct ememoa_memory_base_resize_list_s
 int
 ememoa_memory_base_resize_list_new_items (struct ememoa_memory_base_resize_list_s *base, int count)
 {
-   uint32_t	map;
-   uint32_t	mask;
-   int		first;
-   int		index;
+   unsigned int	segment;
+   unsigned int	first;
+   unsigned int	last;
+   unsigned int	run;
    unsigned int	i;
 
-   if (base == NULL)
+   if (base == NULL || count <= 0)
      return -1;
 
    EMEMOA_CHECK_MAGIC(base);
 
-   if (base->count < base->actif + count)
+   RESIZE_LIST_LOCK(base);
+
+   for (segment = 0; ; ++segment)
      {
-	unsigned int	total;
-        uint32_t        *tmp_bitmap;
-        void            *tmp_pool;
+        if (segment == base->segments_count
+            && ememoa_memory_base_resize_list_grow (base))
+          break;
 
-	total = base->count + (((count >> 5) + 1) << 5);
+        if (RESIZE_LIST_SEGMENT_ITEMS(segment) < (unsigned int) count)
+          continue;
 
-	tmp_pool = ememoa_memory_base_realloc (base->pool, total * base->size);
-	if (!tmp_pool)
-	  return -1;
-	base->pool = tmp_pool;
+        first = RESIZE_LIST_SEGMENT_FIRST_WORD(segment) << 5;
+        last = first + RESIZE_LIST_SEGMENT_ITEMS(segment);
 
-	tmp_bitmap = ememoa_memory_base_realloc (base->bitmap, (total >> 5) * sizeof (uint32_t));
-	if (!tmp_bitmap)
-	  return -1;
-	base->bitmap = tmp_bitmap;
+        /* FIXME: Later improve this, but it will ok for the time being. */
+        for (run = 0, i = first; i < last; ++i)
+          {
+             if (*ememoa_memory_base_resize_list_word (base, i >> 5) & (1U << (i & 0x1F)))
+               run++;
+             else
+               run = 0;
 
-	for (i = base->count >> 5; i < total >> 5; ++i)
-	  tmp_bitmap[i] = 0xFFFFFFFF;
+             if (run == (unsigned int) count)
+               {
+                  for (i = i + 1 - count; run; --run, ++i)
+                    __atomic_and_fetch (ememoa_memory_base_resize_list_word (base, i >> 5), ~(1U << (i & 0x1F)), __ATOMIC_RELEASE);
 
-#ifdef DEBUG
-        memset ((uint8_t*) tmp_pool + base->count * base->size, 43, base->size * (total - base->count));
-#endif
+                  base->actif += count;
+                  RESIZE_LIST_UNLOCK(base);
 
-	base->count = total;
+                  return i - count;
+               }
+          }
      }
 
-   /* First lookup for the first chunk with empty slot. */
-   for (i = base->jump; i < (base->count >> 5) && base->bitmap[i] == 0; ++i)
-     ;
-
-   /* Check if we are at the end. */
-   assert (i < (base->count >> 5));
-
-   /* Lookup start on first empty chunk. */
-   map = base->bitmap[i];
-   index = i << 5;
-
-   first = 0;
-   do {
-      int pos;
-
-      /* Look in the current map for available chunk. */
-      pos = ffs(map);
-      if (pos > 0)
-	{
-	   uint32_t inv;
-	   int jump;
-	   int nbits;
-
-	   /* nbits = count bit set in map starting from pos */
-	   if (pos == 32) inv = 0;
-	   else inv = ~map & ~((1 << pos) - 1);
-
-	   jump = ffs(inv);
-	   pos = pos - 1;
-	   nbits = jump - pos;
-	   while (jump == 0 && i < (base->count >> 5))
-	     {
-		map = base->bitmap[++i];
-		inv = ~map;
-		jump = ffs(inv);
-		nbits += 32;
-	     }
-
-	   if (nbits >= count)
-	     {
-		base->actif += count;
-		/* FIXME: Later improve this, but it will ok for the time being. */
-		while (count)
-		  {
-		     int over;
-
-		     count--;
-		     over = index + pos + count;
-		     base->bitmap[over >> 5] &= ~(1 << (over & 0x1F));
-		  }
-
-		if (!first)
-		  base->jump = (index + pos + count) >> 5;
-
-		return index + pos;
-	     }
-
-	   /* Remove all the tested bit from bitmap. */
-	   mask = ~((1 << jump) - 1);
-	   map &= mask;
-	   index = i << 5;
-
-	   /* Only move jump only on first loop iteration. */
-	   first = 1;
-	}
-      else
-	{
-	   while (i < (base->count >> 5) && base->bitmap[i] == 0)
-	     ++i;
-	}
-   } while (i < (base->count >> 5));
-
-   /* We should always find a solution as we always put at least
-      count + 1 items at the end of the pool. */
-   abort();
+   RESIZE_LIST_UNLOCK(base);
    return -1;
 }
 
 /**
- * Give the pointer corresponding to an item index.
+ * Give the pointer corresponding to an item index. It never take any lock.
  *
  * @param       base    Pointer to a valid and activ list.
  * @param       index   Item index given by ememoa_memory_base_resize_list_new_item.
@@ -811,10 +1943,10 @@ ememoa_memory_base_resize_list_get_item (struct ememoa_memory_base_resize_list_s
 {
    EMEMOA_CHECK_MAGIC(base);
 
-   if (index < 0)
+   if (index < 0 || (unsigned int) index >= __atomic_load_n (&base->count, __ATOMIC_ACQUIRE))
      return NULL;
 
-   return (void*) ((uint8_t*) base->pool + index * base->size);
+   return ememoa_memory_base_resize_list_item (base, index);
 }
 
 /**
@@ -827,26 +1959,7 @@ ememoa_memory_base_resize_list_get_item (struct ememoa_memory_base_resize_list_s
 void
 ememoa_memory_base_resize_list_back (struct ememoa_memory_base_resize_list_s *base, int index)
 {
-   unsigned int                 shift;
-   unsigned int                 i;
-
-   EMEMOA_CHECK_MAGIC(base);
-
-   if (index < 0)
-     return ;
-
-   shift = index >> 5;
-   i = index & 0x1F;
-
-   base->bitmap[shift] |= (1 << i);
-   base->actif--;
-
-   if (shift < base->jump)
-     base->jump = shift;
-
-#ifdef DEBUG
-   memset ((uint8_t*) base->pool + base->size * index, 44, base->size);
-#endif
+   ememoa_memory_base_resize_list_back_many (base, index, 1);
 }
 
 /**
@@ -868,58 +1981,79 @@ ememoa_memory_base_resize_list_back_many (struct ememoa_memory_base_resize_list_
    if (index < 0)
      return ;
 
+   RESIZE_LIST_LOCK(base);
+
    /* FIXME: Later improve this, but it will ok for the time being. */
    while (count)
      {
 	shift = index >> 5;
 	i = index & 0x1F;
 
-	base->bitmap[shift] |= (1 << i);
+#ifdef DEBUG
+	memset (ememoa_memory_base_resize_list_item (base, index), 44, base->size);
+#endif
+
+	__atomic_or_fetch (ememoa_memory_base_resize_list_word (base, shift), 1U << i, __ATOMIC_RELEASE);
 	base->actif--;
 
 	if (shift < base->jump)
 	  base->jump = shift;
 
-#ifdef DEBUG
-	memset ((uint8_t*) base->pool + base->size * index, 44, base->size);
-#endif
-
 	index++;
 	count--;
      }
+
+   RESIZE_LIST_UNLOCK(base);
 }
 
 /**
- * Make some attempt to resize the size of the list.
+ * Give back the last segments of the list if they are empty. Items in use never move.
+ *
+ * Unlike the other functions, it frees memory a reader could still be walking over,
+ * so the readers of a list shrunk by this function (get_item, walk_over, search_over)
+ * must hold the same lock as its caller. A list shared by lockless readers must never
+ * be given to this function.
  *
  * @param       base    Pointer to a valid and activ list.
- * @return      Will 0 is nothing where freed, -1 if not enought memory
- *              is available for the operation and anything else if successfull.
+ * @return      Will 0 is nothing where freed and anything else if successfull.
  * @ingroup     Ememoa_Mempool_Base_Resize_List
  */
 int
 ememoa_memory_base_resize_list_garbage_collect (struct ememoa_memory_base_resize_list_s *base)
 {
-   uint32_t     *tmp_bitmap;
-   void         *tmp_pool;
    unsigned int count;
+   unsigned int segment;
+   unsigned int i;
 
    EMEMOA_CHECK_MAGIC(base);
 
+   RESIZE_LIST_LOCK(base);
+
    count = base->count;
 
-   for (; base->count > 0 && base->bitmap[(base->count >> 5)] == 0xFFFFFFFF; base->count -= 32)
-     ;
+   while (base->segments_count > 0)
+     {
+        segment = base->segments_count - 1;
 
-   tmp_pool = ememoa_memory_base_realloc (base->pool, base->count * base->size);
-   if (!tmp_pool)
-     return -1;
-   base->pool = tmp_pool;
+        for (i = RESIZE_LIST_SEGMENT_FIRST_WORD(segment); i < (base->count >> 5); ++i)
+          if (*ememoa_memory_base_resize_list_word (base, i) != 0xFFFFFFFF)
+            break;
 
-   tmp_bitmap = ememoa_memory_base_realloc (base->bitmap, (base->count >> 5) * sizeof (uint32_t));
-   if (!tmp_bitmap)
-     return -1;
-   base->bitmap = tmp_bitmap;
+        if (i != (base->count >> 5))
+          break;
+
+        void	*unused = base->segments[segment];
+
+        __atomic_store_n (&base->count, base->count - RESIZE_LIST_SEGMENT_ITEMS(segment), __ATOMIC_RELEASE);
+        __atomic_store_n (&base->segments[segment], NULL, __ATOMIC_RELEASE);
+        base->segments_count = segment;
+        ememoa_memory_base_free (unused);
+     }
+
+   if (base->jump > (base->count >> 5))
+     base->jump = base->count >> 5;
+
+   RESIZE_LIST_UNLOCK(base);
 
    return count != base->count;
 }
@@ -943,20 +2077,23 @@ ememoa_memory_base_resize_list_walk_over (struct ememoa_memory_base_resize_list_
                                           int (*fct)(void *ctx, int index, void *data),
                                           void *ctx)
 {
-   int          bitmap;
-   int          first;
+   uint32_t     bitmap;
    int          end_shift;
    int          end_i;
+   int          last;
    int          shift;
+   int          count;
    int          i;
    int          result = 0;
 
    EMEMOA_CHECK_MAGIC(base);
 
+   count = __atomic_load_n (&base->count, __ATOMIC_ACQUIRE);
+
    i = start & 0x1F;
 
-   if (end < 0)
-     end = base->count - 1;
+   if (end < 0 || end >= count)
+     end = count - 1;
 
    if (end == -1)
      return 0;
@@ -964,23 +2101,19 @@ ememoa_memory_base_resize_list_walk_over (struct ememoa_memory_base_resize_list_
    end_shift = end >> 5;
    end_i = end & 0x1F;
 
-   for (shift = start >> 5; shift < end_shift; ++shift)
+   for (shift = start >> 5; shift <= end_shift; ++shift, i = 0)
      {
-        bitmap = ~base->bitmap[shift];
-        first = ffs(bitmap) - 1;
+        bitmap = ~__atomic_load_n (ememoa_memory_base_resize_list_word (base, shift), __ATOMIC_ACQUIRE) >> i;
+        last = shift == end_shift ? end_i : 31;
 
-        i = i > first ? i : first;
-        for (bitmap >>= i; i < 32; ++i, bitmap >>= 1, ++start)
+        for (; bitmap && i <= last; ++i, bitmap >>= 1)
           if (bitmap & 0x1)
-            result += fct (ctx, start, base->pool + start * base->size);
-        i = 0;
+            {
+               start = (shift << 5) + i;
+               result += fct (ctx, start, ememoa_memory_base_resize_list_item (base, start));
+            }
      }
 
-   bitmap = ~base->bitmap[shift];
-   for (bitmap >>= i; i < end_i; ++i, bitmap >>= 1, ++start)
-     if (bitmap & 0x1)
-       result += fct (ctx, start, base->pool + start * base->size);
-
    return result;
 }
 
@@ -1005,19 +2138,22 @@ ememoa_memory_base_resize_list_search_over (struct ememoa_memory_base_resize_lis
                                             void *ctx,
                                             int *index)
 {
-   int          bitmap;
-   int          first;
+   uint32_t     bitmap;
    int          end_shift;
    int          end_i;
+   int          last;
    int          shift;
+   int          count;
    int          i;
 
    EMEMOA_CHECK_MAGIC(base);
 
+   count = __atomic_load_n (&base->count, __ATOMIC_ACQUIRE);
+
    i = start & 0x1F;
 
-   if (end < 0)
-     end = base->count - 1;
+   if (end < 0 || end >= count)
+     end = count - 1;
 
    if (end == -1)
      return NULL;
@@ -1025,25 +2161,20 @@ ememoa_memory_base_resize_list_search_over (struct ememoa_memory_base_resize_lis
    end_shift = end >> 5;
    end_i = end & 0x1F;
 
-   for (shift = start >> 5; shift < end_shift; ++shift)
+   for (shift = start >> 5; shift <= end_shift; ++shift, i = 0)
      {
-        bitmap = ~base->bitmap[shift];
-        first = ffs(bitmap) - 1;
+        bitmap = ~__atomic_load_n (ememoa_memory_base_resize_list_word (base, shift), __ATOMIC_ACQUIRE) >> i;
+        last = shift == end_shift ? end_i : 31;
 
-        i = i > first ? i : first;
-        for (bitmap >>= i; i < 32; ++i, bitmap >>= 1, ++start)
+        for (; bitmap && i <= last; ++i, bitmap >>= 1)
           if (bitmap & 0x1)
-            if (fct (ctx, start, base->pool + start * base->size))
-              goto found;
-        i = 0;
+            {
+               start = (shift << 5) + i;
+               if (fct (ctx, start, ememoa_memory_base_resize_list_item (base, start)))
+                 goto found;
+            }
      }
 
-   bitmap = ~base->bitmap[shift];
-   for (bitmap >>= i; i < end_i; ++i, bitmap >>= 1, ++start)
-     if (bitmap & 0x1)
-       if (fct (ctx, start, base->pool + start * base->size))
-         goto found;
-
    if (index)
      *index = 0;
    return NULL;
@@ -1051,6 +2182,5 @@ ememoa_memory_base_resize_list_search_over (struct ememoa_memory_base_resize_lis
   found:
    if (index)
      *index = start;
-   return base->pool + start * base->size;
+   return ememoa_memory_base_resize_list_item (base, start);
 }
-
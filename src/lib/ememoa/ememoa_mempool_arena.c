@@ -0,0 +1,467 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide a bump pointer allocator for objects that all die
+** at the same time, like request scoped data.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+#define	EMEMOA_LOCK(Memory) \
+	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
+		ememoa_mempool_lock_take(&(Memory->lock));
+
+#define	EMEMOA_UNLOCK(Memory) \
+	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
+		ememoa_mempool_lock_release(&(Memory->lock));
+
+#else
+
+#define EMEMOA_LOCK(Memory)	;
+#define EMEMOA_UNLOCK(Memory)	;
+
+#endif
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_arena.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+
+#define	EMEMOA_MAGIC	0x4224009
+
+#ifdef DEBUG
+#define	EMEMOA_CHECK_MAGIC(Memory) \
+	assert(Memory->magic == EMEMOA_MAGIC);
+#else
+#define	EMEMOA_CHECK_MAGIC(Memory) ;
+#endif
+
+#define EMEMOA_ARENA_HEADER	EMEMOA_ARENA_ROUND(sizeof (struct ememoa_mempool_arena_block_s))
+#define EMEMOA_ARENA_DATA(Block) ((uint8_t*) (Block) + EMEMOA_ARENA_HEADER)
+/* Biggest object, its rounded size plus the block header still fit in an unsigned int. */
+#define EMEMOA_ARENA_MAX_SIZE	((UINT_MAX - EMEMOA_ARENA_HEADER) & ~(EMEMOA_ARENA_ALIGN - 1))
+
+#define EMEMOA_ARENA_DEFAULT_BLOCK_SIZE	16384
+
+struct ememoa_memory_base_resize_list_s *arena_pool_list = NULL;
+
+/**
+ * @defgroup Ememoa_Mempool_Arena Bump pointer memory pool manipulation functions
+ *
+ */
+
+/**
+ * Search the arena structur matching the specified index.
+ *
+ * @param       index   The arena index you want to retrieve.
+ * @return              Will return a pointer to the arena if succeeded and NULL otherwise.
+ * @ingroup     Ememoa_Mempool_Arena
+ */
+struct ememoa_mempool_arena_s*
+ememoa_mempool_arena_get_index (int index)
+{
+   if (arena_pool_list == NULL)
+     return NULL;
+
+   return ememoa_memory_base_resize_list_get_item (arena_pool_list, index);
+}
+
+/**
+ * Gives the handle of an arena, to pop objects without calling into the library
+ * with ememoa_arena_pop_object.
+ *
+ * @param	arena		Index of a valid arena.
+ * @return	Will return the handle or @c NULL if there is no such arena.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+ememoa_arena_t*
+ememoa_arena_from_index (int	arena)
+{
+   if (arena < 0)
+     return NULL;
+   return ememoa_mempool_arena_get_index (arena);
+}
+
+/**
+ * Allocate a new block able to hold at least size bytes.
+ *
+ * @param	memory		Pointer to a valid arena.
+ * @param	size		Minimal usable size of the block.
+ * @return	Will return @c NULL if the backend is out of memory.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+static struct ememoa_mempool_arena_block_s*
+ememoa_mempool_arena_block_new (struct ememoa_mempool_arena_s	*memory,
+				unsigned int			size)
+{
+   struct ememoa_mempool_arena_block_s  *block;
+   unsigned int                         length;
+
+   length = size > memory->block_size ? size : memory->block_size;
+
+   block = ememoa_mempool_backend_alloc (&memory->backend, EMEMOA_ARENA_HEADER + length);
+   if (block == NULL)
+     {
+        memory->last_error_code = EMEMOA_ERROR_MALLOC_NEW_POOL;
+        return NULL;
+     }
+
+   block->next = NULL;
+   block->end = EMEMOA_ARENA_DATA(block) + length;
+
+   return block;
+}
+
+/**
+ * Initializes an arena for later use. Objects are taken from blocks of block_size bytes
+ * allocated from the backend, they can not be given back one by one, only
+ * all at once with ememoa_mempool_arena_reset or up to a mark with
+ * ememoa_mempool_arena_rollback.
+ *
+ * @code
+ * int	arena = ememoa_mempool_arena_init (65536, 0, NULL);
+ * if (arena < 0)
+ * {
+ *    fprintf (stderr, "ERROR: Arena initialization failed\n");
+ *    exit (-1);
+ * }
+ * @endcode
+ *
+ * @param	block_size	Size of each block. If @c 0 is passed, a default of 16KB
+ *				will be used.
+ * @param	options		Right now, only EMEMOA_THREAD_PROTECTION is supported.
+ * @param	desc		Pointer to a valid description for this new arena.
+ * @return	Will return @c -1 if the initialization of the arena failed, and the index
+ *		of the arena if it succeed.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_init (unsigned int				block_size,
+			   unsigned int				options,
+			   const struct ememoa_mempool_desc_s	*desc)
+{
+   struct ememoa_mempool_arena_s        *memory;
+   int                                  index;
+
+   if (block_size > EMEMOA_ARENA_MAX_SIZE)
+     return -1;
+
+   if (ememoa_memory_base_resize_list_shared (&arena_pool_list, sizeof (struct ememoa_mempool_arena_s)) == NULL)
+     return -1;
+
+   index = ememoa_memory_base_resize_list_new_item (arena_pool_list);
+   memory = ememoa_mempool_arena_get_index (index);
+   if (memory == NULL)
+     return -1;
+
+   bzero (memory, sizeof (struct ememoa_mempool_arena_s));
+
+#ifdef DEBUG
+   memory->magic = EMEMOA_MAGIC;
+#endif
+
+   memory->block_size = EMEMOA_ARENA_ROUND(block_size ? block_size : EMEMOA_ARENA_DEFAULT_BLOCK_SIZE);
+   memory->options = options;
+   memory->desc = desc;
+   ememoa_mempool_backend_init (&memory->backend, desc);
+   memory->last_error_code = EMEMOA_NO_ERROR;
+
+   memory->first = ememoa_mempool_arena_block_new (memory, memory->block_size);
+   if (memory->first == NULL)
+     {
+        ememoa_memory_base_resize_list_back (arena_pool_list, index);
+        return -1;
+     }
+
+   memory->current = memory->first;
+   memory->bump.position = EMEMOA_ARENA_DATA(memory->first);
+   memory->bump.end = memory->first->end;
+   memory->bump.locked = (options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION;
+
+#ifdef HAVE_PTHREAD
+   ememoa_mempool_lock_init (&(memory->lock), options);
+#endif
+
+   return index;
+}
+
+/**
+ * Gives back all blocks of an arena to the system. The arena is unusable after
+ * the call of this function.
+ *
+ * @param	arena		Index of a valid arena.
+ * @return	Will return @c 0 if successfully cleaned.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_clean (int arena)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+   struct ememoa_mempool_arena_block_s  *block;
+
+   if (memory == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   while (memory->first)
+     {
+        block = memory->first;
+        memory->first = block->next;
+        ememoa_mempool_backend_free (&memory->backend, block);
+     }
+
+#ifdef HAVE_PTHREAD
+   ememoa_mempool_lock_destroy (&(memory->lock));
+#endif
+
+   bzero (memory, sizeof (struct ememoa_mempool_arena_s));
+   ememoa_memory_base_resize_list_back (arena_pool_list, arena);
+
+   return 0;
+}
+
+/**
+ * Slow path of ememoa_mempool_arena_pop_object, move to the next block able
+ * to hold size bytes. Blocks kept by a previous reset or rollback are reused
+ * first, too small ones are kept for later.
+ *
+ * @param	memory		Pointer to a valid arena.
+ * @param	size		Rounded size of the object.
+ * @return	Will return @c NULL if the backend is out of memory.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+static void*
+ememoa_mempool_arena_pop_slow (struct ememoa_mempool_arena_s	*memory,
+			       unsigned int			size)
+{
+   struct ememoa_mempool_arena_block_s  *block = memory->current->next;
+
+   if (block == NULL
+       || (unsigned int) (block->end - EMEMOA_ARENA_DATA(block)) < size)
+     {
+        block = ememoa_mempool_arena_block_new (memory, size);
+        if (block == NULL)
+          return NULL;
+
+        block->next = memory->current->next;
+        memory->current->next = block;
+     }
+
+   memory->current = block;
+   memory->bump.position = EMEMOA_ARENA_DATA(block) + size;
+   memory->bump.end = block->end;
+
+   return EMEMOA_ARENA_DATA(block);
+}
+
+/**
+ * Slow path of ememoa_arena_pop_object, used when the current block is full and
+ * for every object of a thread protected arena.
+ *
+ * @param	memory		Handle of a valid arena.
+ * @param	size		Size of the object.
+ * @return	Will return @c NULL if it was impossible to allocate any data, or if
+ *		size is too big.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+void*
+ememoa_arena_pop_object_slow (ememoa_arena_t	*memory,
+			      unsigned int	size)
+{
+   uint8_t                              *result;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   /* Rounding it up would wrap around to a tiny object. */
+   if (size > EMEMOA_ARENA_MAX_SIZE)
+     {
+        memory->last_error_code = EMEMOA_NO_MORE_MEMORY;
+        return NULL;
+     }
+
+   EMEMOA_LOCK(memory);
+
+   size = EMEMOA_ARENA_ROUND(size);
+
+   result = memory->bump.position;
+   if ((unsigned int) (memory->bump.end - result) >= size)
+     memory->bump.position = result + size;
+   else
+     result = ememoa_mempool_arena_pop_slow (memory, size);
+
+   EMEMOA_UNLOCK(memory);
+
+   return result;
+}
+
+/**
+ * Pops a new object out of the arena. This is only a pointer increment in the
+ * current block, unless the block is full.
+ *
+ * @param	arena		Index of a valid arena.
+ * @param	size		Size of the object.
+ * @return	Will return @c NULL if it was impossible to allocate any data.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+void*
+ememoa_mempool_arena_pop_object (int		arena,
+				 unsigned int	size)
+{
+   return ememoa_arena_pop_object (ememoa_mempool_arena_get_index (arena), size);
+}
+
+/**
+ * Forgets all objects allocated from the arena in O(1). All blocks are kept and
+ * will be reused by the next allocations.
+ *
+ * @param	arena		Index of a valid arena.
+ * @return	Will return @c 0 if successfull.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_reset (int arena)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+
+   if (memory == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+   EMEMOA_LOCK(memory);
+
+   memory->current = memory->first;
+   memory->bump.position = EMEMOA_ARENA_DATA(memory->first);
+   memory->bump.end = memory->first->end;
+
+   EMEMOA_UNLOCK(memory);
+
+   return 0;
+}
+
+/**
+ * Remembers the current allocation position of the arena.
+ *
+ * @param	arena		Index of a valid arena.
+ * @param	mark		Where to store the position.
+ * @return	Will return @c 0 if successfull.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_checkpoint (int					arena,
+				 struct ememoa_mempool_arena_mark_s	*mark)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+
+   if (memory == NULL || mark == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+   EMEMOA_LOCK(memory);
+
+   mark->block = memory->current;
+   mark->position = memory->bump.position;
+
+   EMEMOA_UNLOCK(memory);
+
+   return 0;
+}
+
+/**
+ * Forgets all objects allocated since mark was taken, in O(1). The mark must
+ * have been taken after the last reset and no rollback to an older mark must
+ * have been done in between.
+ *
+ * @param	arena		Index of a valid arena.
+ * @param	mark		Position given by ememoa_mempool_arena_checkpoint.
+ * @return	Will return @c 0 if successfull.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_rollback (int					arena,
+			       const struct ememoa_mempool_arena_mark_s	*mark)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+
+   if (memory == NULL || mark == NULL || mark->block == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+   EMEMOA_LOCK(memory);
+
+   memory->current = mark->block;
+   memory->bump.position = mark->position;
+   memory->bump.end = memory->current->end;
+
+   EMEMOA_UNLOCK(memory);
+
+   return 0;
+}
+
+/**
+ * Gives back to the system all the blocks that are not used right now, they
+ * were kept by a previous reset or rollback.
+ *
+ * @param	arena		Index of a valid arena.
+ * @return	Will return the number of blocks freed.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_garbage_collect (int arena)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+   struct ememoa_mempool_arena_block_s  *block;
+   int                                  count = 0;
+
+   if (memory == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+   EMEMOA_LOCK(memory);
+
+   while (memory->current->next)
+     {
+        block = memory->current->next;
+        memory->current->next = block->next;
+        ememoa_mempool_backend_free (&memory->backend, block);
+        count++;
+     }
+
+   EMEMOA_UNLOCK(memory);
+
+   return count;
+}
+
+/**
+ * Gives the contention statistics of the lock of a thread protected arena.
+ *
+ * @param	arena		Index of a valid arena.
+ * @param	stat		Where to store the statistics.
+ * @return	Will return @c 0 on success.
+ * @ingroup	Ememoa_Mempool_Arena
+ */
+int
+ememoa_mempool_arena_lock_stat (int					arena,
+				struct ememoa_mempool_lock_stat_s	*stat)
+{
+   struct ememoa_mempool_arena_s        *memory = ememoa_mempool_arena_get_index (arena);
+
+   if (memory == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   ememoa_mempool_lock_stat (&(memory->lock), stat);
+   return 0;
+}
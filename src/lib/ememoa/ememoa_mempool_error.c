@@ -27,6 +27,8 @@ ememoa_mempool_error2string (ememoa_mempool_error_t error_code)
       return "All pool still have some allocated objects. Impossible to give back any pool to the system.";
     case EMEMOA_INVALID_MEMPOOL:
        return "Invalid memory pool index.";
+    case EMEMOA_NO_RELOCATE_CALLBACK:
+       return "No relocate callback given in the memory pool description.";
     default:
       return "Unknown error code !!";
     }
@@ -34,15 +36,28 @@ ememoa_mempool_error2string (ememoa_mempool_error_t error_code)
 }
 
 ememoa_mempool_error_t
-ememoa_mempool_fixed_get_last_error (unsigned int	mempool)
+ememoa_mempool_fixed_get_last_error (int		mempool)
 {
    struct ememoa_mempool_fixed_s	*memory = ememoa_mempool_fixed_get_index(mempool);
    return memory->last_error_code;
 }
 
+ememoa_mempool_error_t
+ememoa_fixed_get_last_error (const ememoa_fixed_t	*memory)
+{
+   return (memory) ? memory->last_error_code : EMEMOA_INVALID_MEMPOOL;
+}
+
 
 extern struct ememoa_mempool_unknown_size_s	*all_unknown_size_pool;
 
+ememoa_mempool_error_t
+ememoa_mempool_arena_get_last_error (int	arena)
+{
+   struct ememoa_mempool_arena_s	*memory = ememoa_mempool_arena_get_index (arena);
+   return (memory) ? memory->last_error_code : EMEMOA_INVALID_MEMPOOL;
+}
+
 ememoa_mempool_error_t
 ememoa_mempool_unknown_size_get_last_error (unsigned int	mempool)
 {
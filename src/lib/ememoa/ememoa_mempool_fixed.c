@@ -14,16 +14,18 @@
 #include <assert.h>
 #include <alloca.h>
 
+#include "config.h"
+
 #ifdef	HAVE_PTHREAD
 #include <pthread.h>
 
 #define	EMEMOA_LOCK(Memory) \
 	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
-		pthread_mutex_lock(&(Memory->lock));
+		ememoa_mempool_lock_take(&(Memory->lock));
 
 #define	EMEMOA_UNLOCK(Memory) \
 	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
-		pthread_mutex_unlock(&(Memory->lock));
+		ememoa_mempool_lock_release(&(Memory->lock));
 
 #else
 
@@ -35,6 +37,7 @@
 #include "ememoa_mempool_fixed.h"
 #include "ememoa_memory_base.h"
 #include "mempool_struct.h"
+#include "ememoa_trace.h"
 
 #define	EMEMOA_MAGIC	0x4224007
 
@@ -66,12 +69,39 @@ typedef uint32_t	bitmask_t;
 
 /* WARNING: THIS CAST MUST BE VALIDATED ON ALL ARCHITECTURE */
 #define EMEMOA_EVAL_BOUND_LOW(Pointer) ((unsigned long) Pointer)
-#define EMEMOA_EVAL_BOUND_HIGH(Pointer, Memory) (((unsigned long) Pointer) + Memory.object_size * Memory.max_objects)
+#define EMEMOA_EVAL_BOUND_HIGH(Pointer, Memory, Pool) (((unsigned long) Pointer) + Memory.object_size * Pool->max_objects)
 
 #define	EMEMOA_INDEX_LOW(Index) (Index & ((1 << BITMASK_POWER) - 1))
 #define EMEMOA_INDEX_HIGH(Index) (Index >> BITMASK_POWER)
 
-#define EMEMOA_SIZEOF_POOL(Memory) (sizeof (uint8_t) * Memory->object_size * Memory->max_objects)
+#define EMEMOA_SIZEOF_POOL(Memory, Objects) (sizeof (uint8_t) * Memory->object_size * (Objects))
+
+/* The pool header and its bitmap sit at the start of the pool allocation, rounded so the
+   first object keeps the memory pool alignment. Above a cache line, that rounding would
+   cost a whole aligned block, so the header goes after the last object instead. */
+#define EMEMOA_POOL_HEADER_TAIL(Memory) (Memory->align > EMEMOA_CACHE_LINE)
+#define EMEMOA_SIZEOF_POOL_HEADER(Memory, Poi) \
+  ((sizeof (struct ememoa_mempool_fixed_pool_s) + sizeof (bitmask_t) * (Poi) \
+    + (EMEMOA_POOL_HEADER_TAIL(Memory) ? sizeof (void*) : Memory->align) - 1) \
+   & ~((size_t) (EMEMOA_POOL_HEADER_TAIL(Memory) ? sizeof (void*) : Memory->align) - 1))
+
+/* Number of bitmask_t needed to track Objects objects. */
+#define EMEMOA_POOL_POI(Objects) (((Objects) + (1 << BITMASK_POWER) - 1) >> BITMASK_POWER)
+
+/* With EMEMOA_ADAPTIVE_POOLS, a pool is at most 2^EMEMOA_POOL_GROWTH_POT times bigger than
+   the smallest one, and stop growing once it holds EMEMOA_POOL_MAX_SIZE bytes. */
+#define EMEMOA_POOL_GROWTH_POT	4
+#define EMEMOA_POOL_MAX_SIZE	(1024 * 1024)
+
+/* memory->base only store a pointer to each pool. */
+#define EMEMOA_POOL(Data) (*(struct ememoa_mempool_fixed_pool_s**) (Data))
+
+/* What the backend gave for a pool. */
+#define EMEMOA_POOL_BLOCK(Pool) ((void*) ((uint8_t*) (Pool) - (Pool)->offset))
+
+#define EMEMOA_CACHE_LINE	64
+/* Room for cache coloring when the memory allocator doesn't round pools to pages. */
+#define EMEMOA_PAGE_SIZE	4096
 
 #ifdef	ememoa_mempool_fixed_display_statistic
 #undef	ememoa_mempool_fixed_display_statistic
@@ -86,12 +116,31 @@ struct ememoa_mempool_fixed_pool_s
    unsigned int         jump_object;
    unsigned int         available_objects;
    unsigned int		objects;
-   int			objects_use;
+   unsigned int		max_objects;
+   unsigned int		wasted;
+   /* Distance from the start of the allocation, 0 unless the header is after the objects. */
+   unsigned int		offset;
    void                 *objects_pool;
+   bitmask_t		objects_use[];
 };
 
 struct ememoa_memory_base_resize_list_s *fixed_pool_list = NULL;
-struct ememoa_memory_base_resize_list_s *fixed_bitmap_list = NULL;
+
+/* Only taken to add or remove a memory pool from fixed_pool_list and while walking over
+   all memory pools, so a memory pool is never freed while a walk is looking at it. */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t                  fixed_pool_list_lock = PTHREAD_MUTEX_INITIALIZER;
+# define EMEMOA_LIST_LOCK()             pthread_mutex_lock (&fixed_pool_list_lock);
+# define EMEMOA_LIST_UNLOCK()           pthread_mutex_unlock (&fixed_pool_list_lock);
+
+/* Memory pool the garbage collector is working on without the list lock, see
+   ememoa_mempool_fixed_registry_pin. */
+static struct ememoa_mempool_fixed_s    *fixed_pool_pinned = NULL;
+static pthread_cond_t                   fixed_pool_pinned_cond = PTHREAD_COND_INITIALIZER;
+#else
+# define EMEMOA_LIST_LOCK()             ;
+# define EMEMOA_LIST_UNLOCK()           ;
+#endif
 
 /**
  * @defgroup Ememoa_Mempool_Fixed Memory pool manipulation functions for fixed size object
@@ -99,25 +148,68 @@ struct ememoa_memory_base_resize_list_s *fixed_bitmap_list = NULL;
  */
 
 /**
- * Allocate a new mempool structur.
+ * Allocate a new mempool structur. The structur is allocated on its own, so its address
+ * never change, and only a pointer to it is stored in fixed_pool_list. This pointer stays
+ * NULL until ememoa_mempool_fixed_publish is called.
  *
- * @return	Will return the index of the mempool or -1 if it failed.
+ * @return	Will return a pointer to the mempool or NULL if it failed.
  * @ingroup	Ememoa_Search_Mempool
  */
-static int
+static struct ememoa_mempool_fixed_s*
 ememoa_fixed_pool_new ()
 {
-   if (!fixed_pool_list)
-     fixed_pool_list = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_s));
+   struct ememoa_memory_base_resize_list_s      *list;
+   struct ememoa_mempool_fixed_s                **slot;
+   struct ememoa_mempool_fixed_s                *memory;
+   int                                          index;
 
-   if (fixed_pool_list == NULL)
-     return -1;
+   list = ememoa_memory_base_resize_list_shared (&fixed_pool_list, sizeof (struct ememoa_mempool_fixed_s*));
+   if (list == NULL)
+     return NULL;
+
+   memory = ememoa_memory_base_alloc (sizeof (struct ememoa_mempool_fixed_s));
+   if (memory == NULL)
+     return NULL;
+
+   /* Walkers must never see the slot before it is set to NULL. */
+   EMEMOA_LIST_LOCK();
+
+   index = ememoa_memory_base_resize_list_new_item (list);
+   slot = ememoa_memory_base_resize_list_get_item (list, index);
+   if (slot)
+     __atomic_store_n (slot, NULL, __ATOMIC_RELEASE);
+
+   EMEMOA_LIST_UNLOCK();
+
+   if (slot == NULL)
+     {
+        ememoa_memory_base_free (memory);
+        return NULL;
+     }
+
+   bzero (memory, sizeof (struct ememoa_mempool_fixed_s));
+   memory->index = index;
+
+   return memory;
+}
+
+/**
+ * Make a fully initialized mempool visible to the int API and to the walks over all mempool.
+ *
+ * @param       memory  The memory pool to publish.
+ * @ingroup     Ememoa_Search_Mempool
+ */
+static void
+ememoa_mempool_fixed_publish (struct ememoa_mempool_fixed_s *memory)
+{
+   struct ememoa_mempool_fixed_s        **slot;
 
-   return ememoa_memory_base_resize_list_new_item (fixed_pool_list);
+   slot = ememoa_memory_base_resize_list_get_item (fixed_pool_list, memory->index);
+   __atomic_store_n (slot, memory, __ATOMIC_RELEASE);
 }
 
 /**
- * Search the mempool structur matching the specified index.
+ * Search the mempool structur matching the specified index. It never take any lock.
  *
  * @param       index   The memory pool index you want to retrieve.
  * @return              Will return a pointer to the mempool if succeeded and NULL otherwise.
@@ -126,73 +218,98 @@ ememoa_fixed_pool_new ()
 struct ememoa_mempool_fixed_s*
 ememoa_mempool_fixed_get_index (unsigned int index)
 {
-   if (fixed_pool_list == NULL)
+   struct ememoa_memory_base_resize_list_s      *list = __atomic_load_n (&fixed_pool_list, __ATOMIC_ACQUIRE);
+   struct ememoa_mempool_fixed_s                **slot;
+
+   if (list == NULL)
      return NULL;
 
-   return ememoa_memory_base_resize_list_get_item (fixed_pool_list, index);
+   slot = ememoa_memory_base_resize_list_get_item (list, index);
+   return slot ? __atomic_load_n (slot, __ATOMIC_ACQUIRE) : NULL;
 }
 
 /**
  * Give back a mempool index. This mempool index will be given back during a later call ememoa_fixed_pool_new().
+ * It waits for any walk over all mempool to finish, so once it returns nobody else can reach the mempool.
  *
- * @param       index   The memory pool index, you want to give back.
+ * @param       memory  The memory pool, you want to give back.
  * @ingroup     Ememoa_Search_Mempool
  */
 static void
-ememoa_mempool_fixed_back (unsigned int index)
+ememoa_mempool_fixed_back (struct ememoa_mempool_fixed_s *memory)
 {
-   if (fixed_pool_list)
-     ememoa_memory_base_resize_list_back (fixed_pool_list, index);
+   struct ememoa_mempool_fixed_s        **slot;
+
+   EMEMOA_LIST_LOCK();
+
+#ifdef HAVE_PTHREAD
+   while (fixed_pool_pinned == memory)
+     pthread_cond_wait (&fixed_pool_pinned_cond, &fixed_pool_list_lock);
+#endif
+
+   slot = ememoa_memory_base_resize_list_get_item (fixed_pool_list, memory->index);
+   __atomic_store_n (slot, NULL, __ATOMIC_RELEASE);
+   ememoa_memory_base_resize_list_back (fixed_pool_list, memory->index);
+
+   EMEMOA_LIST_UNLOCK();
 }
 
 /**
- * Allocate a set of new bitmask_t
+ * Keep all mempool alive while walking over fixed_pool_list.
  *
- * @param   count  How many bitmask_t to allocate.
- * @return         Will return the index of the first bitmask_t or -1 if it failed.
- * @ingroup        Ememoa_Search_Mempool
+ * @ingroup     Ememoa_Search_Mempool
  */
-static int
-ememoa_bitmask_new(int count)
+void
+ememoa_mempool_fixed_registry_lock (void)
 {
-   if (!fixed_bitmap_list)
-     fixed_bitmap_list = ememoa_memory_base_resize_list_new(sizeof (bitmask_t));
-
-   if (fixed_bitmap_list == NULL)
-     return -1;
-
-   return ememoa_memory_base_resize_list_new_items (fixed_bitmap_list, count);
+   EMEMOA_LIST_LOCK();
 }
 
 /**
- * Search the bitmask_t structur matching the specified index.
+ * Release the lock taken by ememoa_mempool_fixed_registry_lock.
  *
- * @param       index   The memory pool index you want to retrieve.
- * @param       offset  The particular offset in it you want to access.
- * @return              Will return a pointer to the mempool if succeeded and NULL otherwise.
  * @ingroup     Ememoa_Search_Mempool
  */
-static bitmask_t*
-ememoa_bitmask_get_index (unsigned int index, unsigned int offset)
+void
+ememoa_mempool_fixed_registry_unlock (void)
 {
-   if (fixed_bitmap_list == NULL)
-     return NULL;
+   EMEMOA_LIST_UNLOCK();
+}
 
-   return ememoa_memory_base_resize_list_get_item (fixed_bitmap_list, index + offset);
+/**
+ * Keep one memory pool alive and release the lock taken by
+ * ememoa_mempool_fixed_registry_lock, so creating and cleaning the other memory
+ * pools doesn't wait for a long job on it. Only one memory pool can be pinned at
+ * a time.
+ *
+ * @param       memory  A memory pool found while holding the lock.
+ * @ingroup     Ememoa_Search_Mempool
+ */
+void
+ememoa_mempool_fixed_registry_pin (struct ememoa_mempool_fixed_s *memory)
+{
+#ifdef HAVE_PTHREAD
+   fixed_pool_pinned = memory;
+#else
+   (void) memory;
+#endif
+   EMEMOA_LIST_UNLOCK();
 }
 
 /**
- * Give back a bitmask_t index. This mempool index will be given back during a later call ememoa_bitmask_new().
+ * Take the lock again and let ememoa_mempool_fixed_clean go on with the pinned
+ * memory pool.
  *
- * @param       index   The memory pool index, you want to give back.
- * @param       count   How much bitmask_t you are giving back.
  * @ingroup     Ememoa_Search_Mempool
  */
-static void
-ememoa_bitmask_back (unsigned int index, unsigned int count)
+void
+ememoa_mempool_fixed_registry_unpin (void)
 {
-   if (fixed_bitmap_list)
-     ememoa_memory_base_resize_list_back_many (fixed_bitmap_list, index, count);
+   EMEMOA_LIST_LOCK();
+#ifdef HAVE_PTHREAD
+   fixed_pool_pinned = NULL;
+   pthread_cond_broadcast (&fixed_pool_pinned_cond);
+#endif
 }
 
 /**
@@ -220,8 +337,20 @@ ememoa_bitmask_back (unsigned int index, unsigned int count)
  *					stupid.
  * @param	options			This parameter will give you the possibility to take
  *					into account the exact pattern usage of the memory pool.
- *					Right now, only EMEMOA_THREAD_PROTECTION is supported,
- *					but futur improvement could use this facilty too.
+ *					EMEMOA_THREAD_PROTECTION protects the pool with a lock,
+ *					EMEMOA_MEMPOOL_ALIGN(pot) aligns every object on 2^pot
+ *					bytes (EMEMOA_ALIGN_CACHE_LINE, EMEMOA_ALIGN_PAGE).
+ *					EMEMOA_CACHE_COLORING starts the objects of each pool
+ *					a different number of cache lines after the start of
+ *					the allocation, using the unused tail of its last page,
+ *					so the first objects of all pools don't share cache sets.
+ *					EMEMOA_PREALLOCATE allocates the first pool and touches
+ *					its pages during the init, see ememoa_mempool_fixed_reserve.
+ *					EMEMOA_ADAPTIVE_POOLS sizes each new pool after the
+ *					highest number of objects in use since the last garbage
+ *					collection, so a busy memory pool ends up with a few big
+ *					pools instead of thousands of small ones. The pools never
+ *					get smaller than 2^preallocated_item_pot objects.
  * @param	desc			Pointer to a valid description for this new pool.
  *					If @c NULL is passed, you will not be able to
  *					see the content of the memory for debug purpose.
@@ -235,21 +364,55 @@ ememoa_mempool_fixed_init (unsigned int				object_size,
                            unsigned int				options,
                            const struct ememoa_mempool_desc_s	*desc)
 {
-   int					index = ememoa_fixed_pool_new ();
-   struct ememoa_mempool_fixed_s	*memory = ememoa_mempool_fixed_get_index(index);
+   struct ememoa_mempool_fixed_s	*memory;
 
-   if (index == -1)
-     return -1;
+   memory = ememoa_fixed_init (object_size, preallocated_item_pot, options, desc);
 
-   if (memory == NULL)
-     return -1;
+   return memory ? memory->index : -1;
+}
+
+/**
+ * Initializes a memory pool and gives back a handle to it. The handle stays valid
+ * until ememoa_fixed_clean and avoid the index lookup done by the int API on each call.
+ * The parameters are the same as ememoa_mempool_fixed_init.
+ *
+ * @code
+ * ememoa_fixed_t	*nodes = ememoa_fixed_init (sizeof (struct node_s), 8, 0, NULL);
+ * struct node_s	*n = ememoa_fixed_pop_object (nodes);
+ *
+ * ememoa_fixed_push_object (nodes, n);
+ * ememoa_fixed_clean (nodes);
+ * @endcode
+ *
+ * @return	Will return @c NULL if the initialization of the memory pool failed.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+ememoa_fixed_t*
+ememoa_fixed_init (unsigned int				object_size,
+		   unsigned int				preallocated_item_pot,
+		   unsigned int				options,
+		   const struct ememoa_mempool_desc_s	*desc)
+{
+   struct ememoa_mempool_fixed_s	*memory;
 
    assert(object_size > 0);
    assert(preallocated_item_pot > 0);
 
-   bzero (memory, sizeof (struct ememoa_mempool_fixed_s));
+   memory = ememoa_fixed_pool_new ();
+   if (memory == NULL)
+     return NULL;
 
-   EMEMOA_ALIGN(object_size);
+   /* Thread protected pool must take the lock on each call. */
+   memory->cache.count = 0;
+   memory->cache.size = (options & EMEMOA_THREAD_PROTECTION) ? 0 : EMEMOA_FIXED_CACHE_SIZE;
+
+   /* Objects are at least aligned on a pointer size, and their size is a multiple
+      of the asked alignment so every object of a pool stay aligned. */
+   memory->align = 1 << EMEMOA_MEMPOOL_ALIGN_POT(options);
+   if (memory->align < sizeof (void*))
+     memory->align = sizeof (void*);
+   memory->requested_size = object_size;
+   object_size = (object_size + memory->align - 1) & ~(memory->align - 1);
    memory->object_size = object_size;
    /* First make an upper approximation of the minimal
       number of objects per pool that fit in n * bitmask_t */
@@ -257,24 +420,43 @@ ememoa_mempool_fixed_init (unsigned int				object_size,
    memory->max_objects_poi = (1 << (memory->max_objects_pot - BITMASK_POWER));
    memory->max_objects = (1 << memory->max_objects_pot);
 
-#ifdef DEBUG
+   memory->max_pool_pot = memory->max_objects_pot;
+   if (options & EMEMOA_ADAPTIVE_POOLS)
+     while (memory->max_pool_pot < memory->max_objects_pot + EMEMOA_POOL_GROWTH_POT
+            && ((size_t) object_size << (memory->max_pool_pot + 1)) <= EMEMOA_POOL_MAX_SIZE)
+       memory->max_pool_pot++;
+
    memory->max_out_objects = 0;
    memory->out_objects = 0;
+   memory->peak_out_objects = 0;
+
+#ifdef DEBUG
    memory->magic = EMEMOA_MAGIC;
 #endif
 
    memory->desc = desc;
+   ememoa_mempool_backend_init (&memory->backend, desc);
    memory->last_error_code = EMEMOA_NO_ERROR;
 
-   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s));
+   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s*));
    memory->jump_pool = 0;
    memory->options = options;
 
 #ifdef HAVE_PTHREAD
-   pthread_mutex_init (&(memory->lock), NULL);
+   ememoa_mempool_lock_init (&(memory->lock), options);
 #endif
 
-   return index;
+   ememoa_mempool_fixed_publish (memory);
+
+   /* Start with one pool of preallocated_item objects already in memory. */
+   if ((options & EMEMOA_PREALLOCATE)
+       && ememoa_fixed_reserve (memory, memory->max_objects))
+     {
+        ememoa_fixed_clean (memory);
+        return NULL;
+     }
+
+   return memory;
 }
 
 /**
@@ -300,24 +482,69 @@ ememoa_mempool_fixed_init (unsigned int				object_size,
 int
 ememoa_mempool_fixed_clean (int	mempool)
 {
-   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index (mempool);
+   return ememoa_fixed_clean (ememoa_mempool_fixed_get_index (mempool));
+}
+
+/**
+ * Destroys all allocated objects of the memory pool and the handle itself.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c 0 if successfully cleaned.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_clean (ememoa_fixed_t	*memory)
+{
    int                                  error_code = 0;
 
-   error_code = ememoa_mempool_fixed_free_all_objects (mempool);
+   EMEMOA_CHECK_MAGIC(memory);
+
+   ememoa_mempool_fixed_back (memory);
+
+   error_code = ememoa_fixed_free_all_objects (memory);
    if (error_code)
      return error_code;
 
 #ifdef HAVE_PTHREAD
-   pthread_mutex_destroy (&(memory->lock));
+   ememoa_mempool_lock_destroy (&(memory->lock));
 #endif
 
    ememoa_memory_base_resize_list_clean (memory->base);
-   ememoa_mempool_fixed_back (mempool);
+
    bzero (memory, sizeof (struct ememoa_mempool_fixed_s));
+   ememoa_memory_base_free (memory);
 
    return 0;
 }
 
+/**
+ * Gives the handle of a memory pool created with the int API.
+ *
+ * @param	mempool		Index of a valid memory pool.
+ * @return	Will return the handle or @c NULL if there is no such memory pool.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+ememoa_fixed_t*
+ememoa_fixed_from_index (int	mempool)
+{
+   if (mempool < 0)
+     return NULL;
+   return ememoa_mempool_fixed_get_index (mempool);
+}
+
+/**
+ * Gives the index of a memory pool to use it with the int API.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return the index of the memory pool.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_to_index (const ememoa_fixed_t	*memory)
+{
+   return memory->index;
+}
+
 /**
  * @defgroup Ememoa_Alloc_Mempool Helper function for object allocation
  *
@@ -349,55 +576,192 @@ set_address (unsigned int	index_l,
 }
 
 /**
- * Allocate a new empty pool inside a Mempool
+ * Choose the number of objects of the next pool. With EMEMOA_ADAPTIVE_POOLS it is
+ * the power of two just above the peak of objects in use, so each new pool about
+ * doubles the capacity of the memory pool, until max_pool_pot. Once garbage
+ * collection freed the pools of a past peak, new pools are sized on the current use.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @return	Will return the number of objects of the next pool as a power of two.
+ * @ingroup	Ememoa_Alloc_Mempool
+ */
+static unsigned int
+ememoa_mempool_fixed_next_pot (const struct ememoa_mempool_fixed_s *memory)
+{
+   unsigned int pot = memory->max_objects_pot;
+
+   while (pot < memory->max_pool_pot && (1U << pot) <= memory->peak_out_objects)
+     pot++;
+
+   return pot;
+}
+
+/**
+ * Give the number of objects, at least objects, whose header, bitmap and objects
+ * fit in room bytes.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	objects		Number of objects that already fit in room.
+ * @param	room		Bytes available for the pool.
+ * @return	Will return the number of objects of the pool.
+ * @ingroup	Ememoa_Alloc_Mempool
+ */
+static unsigned int
+ememoa_mempool_fixed_fill (const struct ememoa_mempool_fixed_s	*memory,
+			   unsigned int				objects,
+			   size_t				room)
+{
+   size_t       used = EMEMOA_SIZEOF_POOL_HEADER(memory, EMEMOA_POOL_POI(objects)) + EMEMOA_SIZEOF_POOL(memory, objects);
+   unsigned int fill = objects + (room - used) / memory->object_size;
+
+   /* More objects may need a bigger bitmap. */
+   while (EMEMOA_SIZEOF_POOL_HEADER(memory, EMEMOA_POOL_POI(fill)) + EMEMOA_SIZEOF_POOL(memory, fill) > room)
+     fill--;
+
+   return fill;
+}
+
+/**
+ * Allocate a new empty pool inside a Mempool, with all its objects available.
+ * When the memory allocator rounds the size of the pool to whole pages or to
+ * a block size, the pool gets as many objects as fit in the rounded size. Its last bitmask_t may
+ * then only be partly used.
  *
  * @param	memory		Pointer to a valid address of a memory pool. If
  *				an invalid pool is passed, bad things will happen.
- * @return	Will return @c -1 if an error occurred or the index pool otherwise.
+ * @return	Will return @c NULL if an error occurred or the new pool otherwise.
  * @ingroup	Ememoa_Alloc_Mempool
  */
 static struct ememoa_mempool_fixed_pool_s*
 add_pool (struct ememoa_mempool_fixed_s *memory)
 {
+   struct ememoa_mempool_fixed_pool_s   **slot;
    struct ememoa_mempool_fixed_pool_s   *pool;
-   bitmask_t				*bmsk;
+   uint8_t                              *block;
+   uint8_t                              *objects_pool;
+   size_t                               header;
+   size_t                               size;
+   size_t                               slack;
+   size_t                               color = 0;
+   size_t                               granularity;
+   size_t                               overhead;
+   size_t                               total;
+   unsigned int                         objects;
    int                                  index;
 
    index = ememoa_memory_base_resize_list_new_item (memory->base);
-   pool = ememoa_memory_base_resize_list_get_item (memory->base, index);
+   slot = ememoa_memory_base_resize_list_get_item (memory->base, index);
 
-   if (pool == NULL)
+   if (slot == NULL)
      return NULL;
 
-   pool->objects = memory->max_objects_poi;
-   pool->objects_use = ememoa_bitmask_new(pool->objects);
-   pool->objects_pool = ememoa_memory_base_alloc (EMEMOA_SIZEOF_POOL(memory));
-   pool->available_objects = memory->max_objects - 1;
-   pool->jump_object = 0;
+   objects = 1 << ememoa_mempool_fixed_next_pot (memory);
+   header = EMEMOA_SIZEOF_POOL_HEADER(memory, EMEMOA_POOL_POI(objects));
+   size = EMEMOA_SIZEOF_POOL(memory, objects);
+   /* Only ask for the alignment slack when the backend doesn't already provide it. */
+   slack = memory->align > ememoa_mempool_backend_alignment (&memory->backend, header + size) ? memory->align - 1 : 0;
+   if (memory->options & EMEMOA_CACHE_COLORING)
+     {
+        size_t  step = memory->align > EMEMOA_CACHE_LINE ? memory->align : EMEMOA_CACHE_LINE;
+        size_t  total = header + size + slack;
+        size_t  page = ememoa_mempool_backend_granularity (&memory->backend, total);
+        size_t  room;
+
+        if (page <= 2 * sizeof (void*))
+          page = EMEMOA_PAGE_SIZE;
+        overhead = ememoa_mempool_backend_overhead (&memory->backend, total);
+        room = ((total + overhead + page - 1) & ~(page - 1)) - overhead - total;
+
+        /* Shift the objects of each new pool by one more cache line, as long as
+           it fit in the last page the allocator gives to the pool. */
+        color = (memory->color++ % (room / step + 1)) * step;
+     }
+
+   total = header + size + slack + color;
+   granularity = ememoa_mempool_backend_granularity (&memory->backend, total);
+   overhead = ememoa_mempool_backend_overhead (&memory->backend, total);
+   /* The allocator own header shares the rounded size with the pool. */
+   total = ((total + overhead + granularity - 1) & ~(granularity - 1)) - overhead;
+   /* Rounding to malloc chunk alignment leaves too little for an object, and cache
+      coloring already use the end of the last page. */
+   if (granularity > 2 * sizeof (void*) && !(memory->options & EMEMOA_CACHE_COLORING))
+     {
+        objects = ememoa_mempool_fixed_fill (memory, objects, total - slack - color);
+        header = EMEMOA_SIZEOF_POOL_HEADER(memory, EMEMOA_POOL_POI(objects));
+        size = EMEMOA_SIZEOF_POOL(memory, objects);
+     }
 
-   if (pool->objects_use == -1
-       || pool->objects_pool == NULL)
+   block = ememoa_mempool_backend_alloc (&memory->backend, header + size + slack + color);
+   if (block == NULL)
      {
-	ememoa_bitmask_back (pool->objects_use, pool->objects);
-	ememoa_memory_base_free (pool->objects_pool);
         ememoa_memory_base_resize_list_back (memory->base, index);
 	memory->last_error_code = EMEMOA_ERROR_MALLOC_NEW_POOL;
 
 	return NULL;
      }
 
+   if (EMEMOA_POOL_HEADER_TAIL(memory))
+     {
+        objects_pool = (uint8_t*) ((((uintptr_t) block + slack) & ~((uintptr_t) memory->align - 1)) + color);
+        pool = (struct ememoa_mempool_fixed_pool_s*) (objects_pool + size);
+     }
+   else
+     {
+        pool = (struct ememoa_mempool_fixed_pool_s*) block;
+        objects_pool = (uint8_t*) ((((uintptr_t) block + header + slack) & ~((uintptr_t) memory->align - 1)) + color);
+     }
+
+   pool->objects = EMEMOA_POOL_POI(objects);
+   pool->max_objects = objects;
+   pool->wasted = total - header - size;
+   pool->offset = (uint8_t*) pool - block;
+   pool->objects_pool = objects_pool;
+
+   pool->available_objects = pool->max_objects;
+   pool->jump_object = 0;
+
 #ifdef DEBUG
-   memset (pool->objects_pool, 42, EMEMOA_SIZEOF_POOL(memory));
+   memset (pool->objects_pool, 42, size);
 #endif
 
-   /* Set all objects as available */
-   bmsk = ememoa_bitmask_get_index (pool->objects_use, 0);
-   assert(bmsk != NULL);
-   memset (bmsk, 0xFF, sizeof (bitmask_t) * memory->max_objects_poi);
+   /* Set all objects as available, the bits after the last object stay in use. */
+   memset (pool->objects_use, 0xFF, sizeof (bitmask_t) * pool->objects);
+   if (EMEMOA_INDEX_LOW(objects))
+     pool->objects_use[pool->objects - 1] = ((bitmask_t) 1 << EMEMOA_INDEX_LOW(objects)) - 1;
+
+   *slot = pool;
+
+   /* Pools before jump_pool are expected to be full. */
+   if (memory->jump_pool > index)
+     memory->jump_pool = index;
+
+   EMEMOA_TRACE3(fixed_pool_add, memory->index, header + size + slack + color, pool);
 
    return pool;
 }
 
+/**
+ * Touch every page of a new pool, so the page faults happen now and not during
+ * the pops that will use it.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	pool		The new pool.
+ * @ingroup	Ememoa_Alloc_Mempool
+ */
+static void
+ememoa_mempool_fixed_prefault (struct ememoa_mempool_fixed_s		*memory,
+			       struct ememoa_mempool_fixed_pool_s	*pool)
+{
+   volatile uint8_t     *page = pool->objects_pool;
+   uint8_t              *end = (uint8_t*) pool->objects_pool + EMEMOA_SIZEOF_POOL(memory, pool->max_objects);
+   size_t               step = ememoa_memory_base_map_length (1);
+
+   for (; (uint8_t*) page < end; page += step)
+     *page = *page;
+   page = end - 1;
+   *page = *page;
+}
+
 /**
  * This callback is used to find a pool with available slot for new object. It is used during
  * the allocation with of a new object.
@@ -411,7 +775,7 @@ add_pool (struct ememoa_mempool_fixed_s *memory)
 static int
 ememoa_mempool_fixed_lookup_empty_pool_cb (void *ctx, int index, void *data)
 {
-   struct ememoa_mempool_fixed_pool_s   *pool = data;
+   struct ememoa_mempool_fixed_pool_s   *pool = EMEMOA_POOL(data);
 
    (void) index; (void) ctx;
 
@@ -443,23 +807,39 @@ ememoa_mempool_fixed_lookup_empty_pool_cb (void *ctx, int index, void *data)
 void*
 ememoa_mempool_fixed_pop_object (int mempool)
 {
-   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index (mempool);
+   return ememoa_fixed_pop_object_slow (ememoa_mempool_fixed_get_index (mempool));
+}
+
+/**
+ * Pops a new object out of the pools of the memory pool, without looking at the cache.
+ * It is the out of line part of ememoa_fixed_pop_object.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c NULL if it was impossible to allocate any data.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+void*
+ememoa_fixed_pop_object_slow (ememoa_fixed_t *memory)
+{
+   struct ememoa_mempool_fixed_pool_s   **slot;
    struct ememoa_mempool_fixed_pool_s   *pool;
    uint8_t				*start_address = NULL;
 
    EMEMOA_CHECK_MAGIC(memory);
    EMEMOA_LOCK(memory);
 
-   pool = ememoa_memory_base_resize_list_search_over (memory->base,
+   slot = ememoa_memory_base_resize_list_search_over (memory->base,
                                                       memory->jump_pool,
                                                       -1,
                                                       ememoa_mempool_fixed_lookup_empty_pool_cb,
                                                       NULL,
                                                       &memory->jump_pool);
 
-   if (pool != NULL)
+   if (slot != NULL)
      {
-	bitmask_t	*itr = ememoa_bitmask_get_index(pool->objects_use, 0);
+        pool = *slot;
+
+	bitmask_t	*itr = pool->objects_use;
 	bitmask_t	reg;
 	int		index = 0;
 
@@ -489,7 +869,7 @@ ememoa_mempool_fixed_pop_object (int mempool)
 
 	set_address (EMEMOA_INDEX_LOW(index),
 		     EMEMOA_INDEX_HIGH(index),
-		     ememoa_bitmask_get_index(pool->objects_use, 0),
+		     pool->objects_use,
 		     &pool->jump_object);
      }
    else
@@ -497,18 +877,23 @@ ememoa_mempool_fixed_pop_object (int mempool)
         pool = add_pool (memory);
 	if (pool != NULL)
 	  {
+	     pool->available_objects--;
 	     start_address = pool->objects_pool;
 	     set_address (0, 0,
-			  ememoa_bitmask_get_index(pool->objects_use, 0),
+			  pool->objects_use,
 			  &pool->jump_object);
 	  }
 	else
 	  memory->last_error_code = EMEMOA_NO_MORE_MEMORY;
      }
 
-#ifdef DEBUG
-   memory->max_out_objects += (memory->max_out_objects < ++memory->out_objects) ? 1 : 0;
-#endif
+   if (start_address)
+     {
+        memory->max_out_objects += (memory->max_out_objects < ++memory->out_objects) ? 1 : 0;
+        memory->peak_out_objects += (memory->peak_out_objects < memory->out_objects) ? 1 : 0;
+     }
+
+   EMEMOA_TRACE3(fixed_pop, memory->index, memory->object_size, start_address);
 
    EMEMOA_UNLOCK(memory);
    return start_address;
@@ -517,7 +902,7 @@ ememoa_mempool_fixed_pop_object (int mempool)
 /**
  * Callback destroying all the content of the memory pool.
  *
- * @param       ctx     Useless in this context.
+ * @param       ctx     Pointer to the current memory pool.
  * @param       index   Useless in this context.
  * @param       data    Pointer to the pool to be cleaned.
  * @return      Will return @c 1 if successfull.
@@ -526,12 +911,12 @@ ememoa_mempool_fixed_pop_object (int mempool)
 static int
 ememoa_mempool_fixed_free_pool_cb (void *ctx, int index, void *data)
 {
-   struct ememoa_mempool_fixed_pool_s   *pool = data;
+   struct ememoa_mempool_fixed_s        *memory = ctx;
 
-   (void) ctx; (void) index;
+   (void) index;
 
-   ememoa_bitmask_back (pool->objects_use, pool->objects);
-   ememoa_memory_base_free (pool->objects_pool);
+   EMEMOA_TRACE2(fixed_pool_release, memory->index, EMEMOA_POOL(data));
+   ememoa_mempool_backend_free (&memory->backend, EMEMOA_POOL_BLOCK(EMEMOA_POOL(data)));
 
    return 1;
 }
@@ -548,19 +933,31 @@ ememoa_mempool_fixed_free_pool_cb (void *ctx, int index, void *data)
 int
 ememoa_mempool_fixed_free_all_objects (int mempool)
 {
-   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index (mempool);
+   return ememoa_fixed_free_all_objects (ememoa_mempool_fixed_get_index (mempool));
+}
 
+/**
+ * Destroys all allocated object of the memory pool, including the cached ones.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c 0 if successfully cleaned.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_free_all_objects (ememoa_fixed_t *memory)
+{
    EMEMOA_CHECK_MAGIC(memory);
    EMEMOA_LOCK(memory);
 
-   ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_free_pool_cb, NULL);
+   memory->cache.count = 0;
+
+   ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_free_pool_cb, memory);
    ememoa_memory_base_resize_list_clean (memory->base);
 
-#ifdef DEBUG
    memory->out_objects = 0;
-#endif
+   memory->peak_out_objects = 0;
 
-   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s));
+   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s*));
 
    EMEMOA_UNLOCK(memory);
 
@@ -570,7 +967,6 @@ ememoa_mempool_fixed_free_all_objects (int mempool)
 struct ememoa_mempool_fixed_push_ctx_s
 {
    void                                 *ptr;
-   uint8_t                              *ptr_inf;
    struct ememoa_mempool_fixed_s        *memory;
 };
 
@@ -587,13 +983,14 @@ static int
 ememoa_mempool_fixed_push_object_cb (void *ctx, int index, void *data)
 {
    struct ememoa_mempool_fixed_push_ctx_s       *pctx = ctx;
-   struct ememoa_mempool_fixed_pool_s           *pool = data;
+   struct ememoa_mempool_fixed_pool_s           *pool = EMEMOA_POOL(data);
 
    (void) index;
 
-   if (pool->objects_pool <= pctx->ptr && pctx->ptr_inf <= ((uint8_t*) pool->objects_pool))
+   if (pool->objects_pool <= pctx->ptr
+       && (uint8_t*) pctx->ptr < (uint8_t*) pool->objects_pool + EMEMOA_SIZEOF_POOL(pctx->memory, pool->max_objects))
      {
-        bitmask_t		*objects_use = ememoa_bitmask_get_index(pool->objects_use, 0);
+        bitmask_t		*objects_use = pool->objects_use;
         bitmask_t		mask = 1;
         /*
           High risk, if one day sizeof (unsigned long) > sizeof (void*)
@@ -605,72 +1002,109 @@ ememoa_mempool_fixed_push_object_cb (void *ctx, int index, void *data)
 
         mask <<= index_l;
 
-        EMEMOA_LOCK(pctx->memory);
-
-#ifdef DEBUG
-        pctx->memory->out_objects--;
-#endif
         if (objects_use[index_h] & mask)
           {
              pctx->memory->last_error_code = EMEMOA_DOUBLE_PUSH;
-
-             EMEMOA_UNLOCK(pctx->memory);
              return 1;
           }
 
+        pctx->memory->out_objects--;
+
         objects_use[index_h] |= mask;
         pool->available_objects++;
 
+        /* Only objects really given back, not foreign pointers or double push. */
+        EMEMOA_TRACE3(fixed_push, pctx->memory->index, pctx->memory->object_size, pctx->ptr);
+
         if (pool->jump_object > index_h)
           pool->jump_object = index_h;
 
         if (pctx->memory->jump_pool > index)
           pctx->memory->jump_pool = index;
 
-        EMEMOA_UNLOCK(pctx->memory);
         return 1;
      }
    return 0;
 }
 
 /**
- * Push back an object in the memory pool
+ * Callback checking that an object could wait in the cache: it must start an object
+ * of the pool and be in use.
  *
- * The following example code demonstrates how to ensure that a
- * given pointer has been successfully given back to his memory pool.
+ * @param       ctx     Push context (precomputed value checked against each pool).
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the pool to check.
+ * @return      Will return @c 1 when the pool holding the object is found.
+ * @ingroup     Ememoa_Mempool_Fixed
+ */
+static int
+ememoa_mempool_fixed_cache_check_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_fixed_push_ctx_s       *pctx = ctx;
+   struct ememoa_mempool_fixed_pool_s           *pool = EMEMOA_POOL(data);
+   unsigned long                                offset;
+   unsigned long                                position;
+
+   (void) index;
+
+   if (pctx->ptr < pool->objects_pool
+       || (uint8_t*) pctx->ptr >= (uint8_t*) pool->objects_pool + EMEMOA_SIZEOF_POOL(pctx->memory, pool->max_objects))
+     return 0;
+
+   offset = (uint8_t*) pctx->ptr - (uint8_t*) pool->objects_pool;
+   position = offset / pctx->memory->object_size;
+   if (offset % pctx->memory->object_size || position >= pool->max_objects)
+     pctx->memory->last_error_code = EMEMOA_ERROR_PUSH_ADDRESS_NOT_FOUND;
+   else if (pool->objects_use[EMEMOA_INDEX_HIGH(position)] & ((bitmask_t) 1 << EMEMOA_INDEX_LOW(position)))
+     pctx->memory->last_error_code = EMEMOA_DOUBLE_PUSH;
+   else
+     pctx->ptr = NULL;
+
+   return 1;
+}
+
+/**
+ * Tell if an object is one of the objects waiting in the cache.
  *
- * @code
- *   if (ememoa_mempool_fixed_push_object (mempool_of_object, new_object))
- *   {
- *	fprintf (stderr, "ERROR: %s", ememoa_mempool_error2string ( ememoa_mempool_fixed_get_last_error (mempool_of_object)));
- *	exit (-1);
- *   }
- * @endcode
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	ptr		The object.
+ * @return	Will return @c 1 if it is in the cache.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+static int
+ememoa_mempool_fixed_cached (const struct ememoa_mempool_fixed_s	*memory,
+			     const void					*ptr)
+{
+   unsigned int	i;
+
+   for (i = 0; i < memory->cache.count; ++i)
+     if (memory->cache.objects[i] == ptr)
+       return 1;
+   return 0;
+}
+
+/**
+ * Push back an object in one of the pools of the memory pool.
  *
- * @param	mempool		Index of a valid memory pool. If the pool was already clean
- *				bad things will happen to your program.
+ * @param	memory		Pointer to a valid address of a memory pool.
  * @param	ptr		Pointer to object that belongs to @c memory mempool.
- * @return	Will return @c 0 if it was successfully pushed back to the memory pool. If not, check
- *		memory->last_error_code and ememoa_mempool_error2string to know why.
+ * @return	Will return @c 0 if it was successfully pushed back to the memory pool.
  * @ingroup	Ememoa_Mempool_Fixed
  */
-int
-ememoa_mempool_fixed_push_object (int	mempool,
-                                  void	*ptr)
+static int
+ememoa_mempool_fixed_push_struct (struct ememoa_mempool_fixed_s	*memory,
+				  void				*ptr)
 {
-   struct ememoa_mempool_fixed_s                *memory = ememoa_mempool_fixed_get_index(mempool);
    struct ememoa_mempool_fixed_pool_s           *pool;
    struct ememoa_mempool_fixed_push_ctx_s       pctx;
-   unsigned int                                 size;
 
    EMEMOA_CHECK_MAGIC(memory);
 
-   size = memory->object_size * memory->max_objects;
-
    pctx.ptr = ptr;
-   pctx.ptr_inf = ((uint8_t*) ptr) - size;
    pctx.memory = memory;
 
+   EMEMOA_LOCK(memory);
+
    pool = ememoa_memory_base_resize_list_search_over (memory->base,
                                                       0,
                                                       -1,
@@ -679,12 +1113,130 @@ ememoa_mempool_fixed_push_object (int	mempool,
                                                       NULL);
 
    if (pool)
-     return 0;
+     {
+        EMEMOA_UNLOCK(memory);
+        return 0;
+     }
 
    memory->last_error_code = EMEMOA_ERROR_PUSH_ADDRESS_NOT_FOUND;
+
+   EMEMOA_UNLOCK(memory);
    return -1;
 }
 
+/**
+ * Push back an object in the memory pool
+ *
+ * The following example code demonstrates how to ensure that a
+ * given pointer has been successfully given back to his memory pool.
+ *
+ * @code
+ *   if (ememoa_mempool_fixed_push_object (mempool_of_object, new_object))
+ *   {
+ *	fprintf (stderr, "ERROR: %s", ememoa_mempool_error2string ( ememoa_mempool_fixed_get_last_error (mempool_of_object)));
+ *	exit (-1);
+ *   }
+ * @endcode
+ *
+ * @param	mempool		Index of a valid memory pool. If the pool was already clean
+ *				bad things will happen to your program.
+ * @param	ptr		Pointer to object that belongs to @c memory mempool.
+ * @return	Will return @c 0 if it was successfully pushed back to the memory pool. If not, check
+ *		memory->last_error_code and ememoa_mempool_error2string to know why.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_mempool_fixed_push_object (int	mempool,
+                                  void	*ptr)
+{
+   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index (mempool);
+
+   /* An object in the cache is still used for its pool, and will be given again. */
+   if (ememoa_mempool_fixed_cached (memory, ptr))
+     {
+        memory->last_error_code = EMEMOA_DOUBLE_PUSH;
+        return -1;
+     }
+   return ememoa_mempool_fixed_push_struct (memory, ptr);
+}
+
+/**
+ * Gives back all the objects sitting in the cache of the memory pool to their pools.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c 0 if all objects were pushed back, @c -1 if at least one was
+ *		refused. Check ememoa_fixed_get_last_error to know why.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_flush (ememoa_fixed_t	*memory)
+{
+   int		error = 0;
+
+   while (memory->cache.count)
+     if (ememoa_mempool_fixed_push_struct (memory, memory->cache.objects[--memory->cache.count]))
+       error = -1;
+
+   return error;
+}
+
+/**
+ * Push back an object in the memory pool. It waits in a small cache for the next
+ * ememoa_fixed_pop_object, once checked like ememoa_mempool_fixed_push_object would:
+ * the object must start an object of one of the pools and be in use. When the cache
+ * is full, its oldest half goes back to the pools, so the most recently used objects
+ * stay at hand. Thread protected pools have no cache. The fixed_push tracepoint
+ * only fires when an object leaves the cache for its pool.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @param	ptr		Pointer to object that belongs to @c memory.
+ * @return	Will return @c 0 if it was successfully pushed back to the memory pool, and
+ *		@c -1 for a pointer outside of the pools or an object already pushed.
+ *		Check ememoa_fixed_get_last_error to know why.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_push_object (ememoa_fixed_t	*memory,
+			  void			*ptr)
+{
+   struct ememoa_mempool_fixed_push_ctx_s       pctx;
+   unsigned int                                 half;
+   unsigned int                                 i;
+   int                                          error = 0;
+
+   if (memory->cache.size == 0)
+     return ememoa_mempool_fixed_push_struct (memory, ptr);
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   if (ememoa_mempool_fixed_cached (memory, ptr))
+     {
+        memory->last_error_code = EMEMOA_DOUBLE_PUSH;
+        return -1;
+     }
+
+   pctx.ptr = ptr;
+   pctx.memory = memory;
+   if (ememoa_memory_base_resize_list_search_over (memory->base, 0, -1, ememoa_mempool_fixed_cache_check_cb, &pctx, NULL) == NULL)
+     memory->last_error_code = EMEMOA_ERROR_PUSH_ADDRESS_NOT_FOUND;
+   if (pctx.ptr != NULL)
+     return -1;
+
+   if (memory->cache.count == memory->cache.size)
+     {
+        half = memory->cache.count / 2;
+        for (i = 0; i < half; ++i)
+          if (ememoa_mempool_fixed_push_struct (memory, memory->cache.objects[i]))
+            error = -1;
+
+        memory->cache.count -= half;
+        memmove (memory->cache.objects, memory->cache.objects + half, sizeof (void*) * memory->cache.count);
+     }
+   memory->cache.objects[memory->cache.count++] = ptr;
+
+   return error;
+}
+
 /**
  * Callback freeing empty pool.
  *
@@ -698,19 +1250,21 @@ static int
 ememoa_used_pool_cb (void *ctx, int index, void *data)
 {
    struct ememoa_mempool_fixed_s        *memory = ctx;
-   struct ememoa_mempool_fixed_pool_s   *pool = data;
+   struct ememoa_mempool_fixed_pool_s   *pool = EMEMOA_POOL(data);
 
-   (void) index;
-
-   if (pool->available_objects != memory->max_objects)
+   if (pool->available_objects != pool->max_objects)
      return 1;
 
-   ememoa_bitmask_back (pool->objects_use, pool->objects);
-   ememoa_memory_base_free (pool->objects_pool);
+   /* Keep the empty pools promised by ememoa_fixed_reserve. */
+   if (memory->reserved_objects > memory->kept_objects)
+     {
+        memory->kept_objects += pool->max_objects;
+        return 1;
+     }
 
-   pool->objects_use = 0;
-   pool->objects_pool = NULL;
-   pool->available_objects = 0;
+   EMEMOA_TRACE2(fixed_pool_release, memory->index, pool);
+   ememoa_mempool_backend_free (&memory->backend, EMEMOA_POOL_BLOCK(pool));
+   EMEMOA_POOL(data) = NULL;
 
    ememoa_memory_base_resize_list_back (memory->base, index);
    return 0;
@@ -731,17 +1285,24 @@ ememoa_mempool_fixed_garbage_collect_struct (struct ememoa_mempool_fixed_s *memo
 
    EMEMOA_CHECK_MAGIC(memory);
 
-   if (memory->base->count == 0)
-     return 0;
-
    EMEMOA_LOCK(memory);
 
+   if (memory->base->count == 0)
+     {
+        EMEMOA_UNLOCK(memory);
+        return 0;
+     }
+
+   memory->kept_objects = 0;
+   memory->peak_out_objects = memory->out_objects;
    allocated_pool = ememoa_memory_base_resize_list_walk_over (memory->base,
                                                               0,
                                                               -1,
                                                               ememoa_used_pool_cb,
                                                               memory);
 
+   EMEMOA_TRACE2(fixed_gc, memory->index, allocated_pool);
+
    if (allocated_pool == memory->base->count)
      {
 	EMEMOA_UNLOCK(memory);
@@ -752,13 +1313,15 @@ ememoa_mempool_fixed_garbage_collect_struct (struct ememoa_mempool_fixed_s *memo
 
    if (allocated_pool != 0)
      {
+        /* Safe because every reader of memory->base holds the memory pool lock. */
         ememoa_memory_base_resize_list_garbage_collect (memory->base);
 
+        EMEMOA_UNLOCK(memory);
         return 0;
      }
 
    ememoa_memory_base_resize_list_clean (memory->base);
-   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s));
+   memory->base = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_fixed_pool_s*));
 
    EMEMOA_UNLOCK(memory);
 
@@ -787,11 +1350,102 @@ ememoa_mempool_fixed_garbage_collect_struct (struct ememoa_mempool_fixed_s *memo
 int
 ememoa_mempool_fixed_garbage_collect(int mempool)
 {
-   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index(mempool);
+   return ememoa_fixed_garbage_collect (ememoa_mempool_fixed_get_index(mempool));
+}
+
+/**
+ * Flushes the cache, then collects all the empty pool of the memory pool.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @return	Will return @c 0 if some pools were freed.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_garbage_collect (ememoa_fixed_t *memory)
+{
+   ememoa_fixed_flush (memory);
 
    return ememoa_mempool_fixed_garbage_collect_struct (memory);
 }
 
+/**
+ * Callback counting the available objects of a pool.
+ *
+ * @param       ctx     Useless in this context.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the pool.
+ * @return      Will return the number of available objects.
+ * @ingroup     Ememoa_Alloc_Mempool
+ */
+static int
+ememoa_mempool_fixed_available_cb (void *ctx, int index, void *data)
+{
+   (void) ctx; (void) index;
+
+   return EMEMOA_POOL(data)->available_objects;
+}
+
+/**
+ * Makes sure the next count pops will not call the memory allocator. Missing pools
+ * are allocated now and their pages touched, and garbage collection will keep enough
+ * empty pools for count objects.
+ *
+ * @code
+ *   if (ememoa_mempool_fixed_reserve (mempool_of_requests, 4096))
+ *     fprintf (stderr, "ERROR: %s", ememoa_mempool_error2string (ememoa_mempool_fixed_get_last_error (mempool_of_requests)));
+ * @endcode
+ *
+ * @param	mempool		Index of a valid memory pool.
+ * @param	count		Number of objects to reserve.
+ * @return	Will return @c 0 on success, @c -1 if the pools could not be allocated.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_mempool_fixed_reserve (int		mempool,
+			      unsigned int	count)
+{
+   return ememoa_fixed_reserve (ememoa_mempool_fixed_get_index (mempool), count);
+}
+
+/**
+ * Makes sure the next count pops will not call the memory allocator.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @param	count		Number of objects to reserve.
+ * @return	Will return @c 0 on success, @c -1 if the pools could not be allocated.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_reserve (ememoa_fixed_t	*memory,
+		      unsigned int	count)
+{
+   struct ememoa_mempool_fixed_pool_s   *pool;
+   unsigned int                         available;
+
+   EMEMOA_CHECK_MAGIC(memory);
+   EMEMOA_LOCK(memory);
+
+   available = memory->cache.count
+     + ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_available_cb, NULL);
+
+   for (; available < count; available += pool->max_objects)
+     {
+        pool = add_pool (memory);
+        if (pool == NULL)
+          {
+             EMEMOA_UNLOCK(memory);
+             return -1;
+          }
+        ememoa_mempool_fixed_prefault (memory, pool);
+     }
+
+   if (memory->reserved_objects < count)
+     memory->reserved_objects = count;
+
+   EMEMOA_UNLOCK(memory);
+   return 0;
+}
+
 /**
  * Callback running garbage collector on a memory pool.
  *
@@ -804,10 +1458,13 @@ ememoa_mempool_fixed_garbage_collect(int mempool)
 static int
 ememoa_memory_base_walk_over_gc_cb (void *ctx, int index, void *data)
 {
-   struct ememoa_mempool_fixed_s        *memory = data;
+   struct ememoa_mempool_fixed_s        *memory = __atomic_load_n ((struct ememoa_mempool_fixed_s**) data, __ATOMIC_ACQUIRE);
    (void) index; (void) ctx;
 
-   return ememoa_mempool_fixed_garbage_collect_struct (memory);
+   if (memory == NULL)
+     return 0;
+
+   return ememoa_fixed_garbage_collect (memory);
 }
 
 /**
@@ -828,7 +1485,335 @@ ememoa_memory_base_walk_over_gc_cb (void *ctx, int index, void *data)
 int
 ememoa_mempool_fixed_garbage_collect_all (void)
 {
-   return ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_memory_base_walk_over_gc_cb, NULL);
+   int  result;
+
+   if (fixed_pool_list == NULL)
+     return 0;
+
+   EMEMOA_LIST_LOCK();
+   result = ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_memory_base_walk_over_gc_cb, NULL);
+   EMEMOA_LIST_UNLOCK();
+
+   return result;
+}
+
+struct ememoa_mempool_fixed_compact_s
+{
+   struct ememoa_mempool_fixed_pool_s   *pool;
+   unsigned int                         live;
+};
+
+/**
+ * Callback collecting all pools of a memory pool with their count of live objects.
+ *
+ * @param       ctx     Pointer to the next free slot in the collecting array.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the pool.
+ * @return      Will always return @c 0.
+ * @ingroup     Ememoa_Alloc_Mempool
+ */
+static int
+ememoa_mempool_fixed_compact_collect_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_fixed_compact_s        **itr = ctx;
+
+   (void) index;
+
+   (*itr)->pool = EMEMOA_POOL(data);
+   (*itr)++;
+
+   return 0;
+}
+
+/**
+ * Order pools from the densest to the sparsest.
+ *
+ * @ingroup     Ememoa_Alloc_Mempool
+ */
+static int
+ememoa_mempool_fixed_compact_cmp (const void *a, const void *b)
+{
+   const struct ememoa_mempool_fixed_compact_s  *pa = a;
+   const struct ememoa_mempool_fixed_compact_s  *pb = b;
+
+   if (pa->live == pb->live)
+     return 0;
+   return pa->live < pb->live ? 1 : -1;
+}
+
+/**
+ * Move one object from one pool to another and let the user fix his references.
+ *
+ * @param	memory		Pointer to a valid address of a memory pool.
+ * @param	src		Pool currently holding the object.
+ * @param	position	Position of the object inside src.
+ * @param	dst		Pool with at least one available slot.
+ * @param	data		Pointer given as is to the relocate callback.
+ * @return	Will return @c 0 if the object moved, the relocate callback refusal otherwise.
+ * @ingroup	Ememoa_Alloc_Mempool
+ */
+static int
+ememoa_mempool_fixed_move_object (struct ememoa_mempool_fixed_s		*memory,
+				  struct ememoa_mempool_fixed_pool_s	*src,
+				  unsigned int				position,
+				  struct ememoa_mempool_fixed_pool_s	*dst,
+				  void					*data)
+{
+   bitmask_t	*src_use = src->objects_use;
+   bitmask_t	*dst_use = dst->objects_use;
+   bitmask_t	mask = 1;
+   uint8_t	*old_ptr;
+   uint8_t	*new_ptr;
+   unsigned int	index;
+   int		error;
+
+   for (; dst_use[dst->jump_object] == 0; ++dst->jump_object)
+     ;
+
+   index = dst->jump_object << BITMASK_POWER;
+#ifdef USE64
+   index += ffsll (dst_use[dst->jump_object]) - 1;
+#else
+   index += ffs (dst_use[dst->jump_object]) - 1;
+#endif
+
+   old_ptr = (uint8_t*) src->objects_pool + position * memory->object_size;
+   new_ptr = (uint8_t*) dst->objects_pool + index * memory->object_size;
+
+   memcpy (new_ptr, old_ptr, memory->object_size);
+
+   error = memory->desc->relocate (old_ptr, new_ptr, data);
+   if (error)
+     return error;
+
+   set_address (EMEMOA_INDEX_LOW(index),
+                EMEMOA_INDEX_HIGH(index),
+                dst_use,
+                &dst->jump_object);
+   dst->available_objects--;
+
+   mask <<= EMEMOA_INDEX_LOW(position);
+   src_use[EMEMOA_INDEX_HIGH(position)] |= mask;
+   src->available_objects++;
+
+#ifdef DEBUG
+   memset (old_ptr, 42, memory->object_size);
+#endif
+
+   return 0;
+}
+
+/**
+ * Move live objects out of the sparsest pools into the densest ones, then give back
+ * all the pools that became empty. Each move copies the object and calls the relocate
+ * callback of the memory pool description with the old address, the new address and
+ * data, so the application can fix its references. If the callback returns something
+ * else than 0, the object is considered pinned and stays where it is.
+ *
+ * The relocate callback is called with the memory pool lock held, it must not call
+ * any function on the same memory pool.
+ *
+ * @code
+ *   static int relocate_cb (void *old_ptr, void *new_ptr, void *data)
+ *   {
+ *      struct object_s *object = new_ptr;
+ *      *object->back_reference = object;
+ *      return 0;
+ *   }
+ * @endcode
+ *
+ * @param	mempool		Index of a valid memory pool. If the pool was already clean
+ *				bad things will happen to your program.
+ * @param	data		Pointer that will be passed as is to each call to relocate.
+ * @return	Will return the number of pools given back to the system, or @c -1 if
+ *		the memory pool has no relocate callback.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_mempool_fixed_compact (int	mempool,
+			      void	*data)
+{
+   return ememoa_fixed_compact (ememoa_mempool_fixed_get_index (mempool), data);
+}
+
+/**
+ * Flushes the cache, then compacts the memory pool like ememoa_mempool_fixed_compact.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @param	data		Pointer that will be passed as is to each call to relocate.
+ * @return	Will return the number of pools given back to the system, or @c -1 if
+ *		the memory pool has no relocate callback.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_compact (ememoa_fixed_t	*memory,
+		      void		*data)
+{
+   struct ememoa_mempool_fixed_compact_s        *pools;
+   struct ememoa_mempool_fixed_compact_s        *itr;
+   unsigned int                                 count;
+   unsigned int                                 free_slots;
+   unsigned int                                 src;
+   unsigned int                                 dst;
+   unsigned int                                 i;
+   int                                          freed;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   if (memory->desc == NULL || memory->desc->relocate == NULL)
+     {
+        memory->last_error_code = EMEMOA_NO_RELOCATE_CALLBACK;
+        return -1;
+     }
+
+   ememoa_fixed_flush (memory);
+
+   EMEMOA_LOCK(memory);
+
+   count = memory->base->actif;
+   if (count < 2)
+     goto release;
+
+   pools = ememoa_memory_base_alloc (sizeof (struct ememoa_mempool_fixed_compact_s) * count);
+   if (pools == NULL)
+     {
+        memory->last_error_code = EMEMOA_NO_MORE_MEMORY;
+        EMEMOA_UNLOCK(memory);
+        return -1;
+     }
+
+   itr = pools;
+   ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_compact_collect_cb, &itr);
+   count = itr - pools;
+
+   for (i = 0; i < count; ++i)
+     pools[i].live = pools[i].pool->max_objects - pools[i].pool->available_objects;
+
+   qsort (pools, count, sizeof (struct ememoa_mempool_fixed_compact_s), ememoa_mempool_fixed_compact_cmp);
+
+   /* Only empty a pool if the denser ones can take all its objects. Empty pools are
+      skipped below, so their slots are never room for the others. */
+   for (free_slots = 0, i = 0; i < count; ++i)
+     if (pools[i].live)
+       free_slots += pools[i].pool->available_objects;
+
+   for (dst = 0, src = count - 1; dst < src; --src)
+     {
+        struct ememoa_mempool_fixed_pool_s      *pool = pools[src].pool;
+        bitmask_t                               *objects_use;
+        unsigned int                            j, k;
+
+        if (pool->available_objects == pool->max_objects)
+          continue;
+
+        free_slots -= pool->available_objects;
+        if (free_slots < pool->max_objects - pool->available_objects)
+          break;
+
+        objects_use = pool->objects_use;
+        for (j = 0; j < pool->objects; ++j)
+          for (k = 0; k < (1 << BITMASK_POWER) && (j << BITMASK_POWER) + k < pool->max_objects; ++k)
+            if ((objects_use[j] & ((bitmask_t) 1 << k)) == 0)
+              {
+                 for (; dst < src && pools[dst].pool->available_objects == 0; ++dst)
+                   ;
+                 if (dst == src)
+                   goto moved;
+
+                 if (ememoa_mempool_fixed_move_object (memory,
+                                                       pool,
+                                                       (j << BITMASK_POWER) + k,
+                                                       pools[dst].pool,
+                                                       data) == 0)
+                   free_slots--;
+              }
+     }
+
+ moved:
+   memory->jump_pool = 0;
+   ememoa_memory_base_free (pools);
+
+ release:
+   memory->kept_objects = 0;
+   freed = memory->base->actif;
+   ememoa_memory_base_resize_list_walk_over (memory->base,
+                                             0,
+                                             -1,
+                                             ememoa_used_pool_cb,
+                                             memory);
+   freed -= memory->base->actif;
+
+   EMEMOA_UNLOCK(memory);
+
+   return freed;
+}
+
+/**
+ * Callback visiting one pool during an incremental garbage collection step.
+ *
+ * @param       ctx     Pointer to the current collection budget.
+ * @param       index   Pool index inside the memory pool.
+ * @param       data    Pointer to the pool to check.
+ * @return      Will return @c 1 when the budget is exhausted, @c 0 otherwise.
+ * @ingroup     Ememoa_Alloc_Mempool
+ */
+static int
+ememoa_mempool_fixed_garbage_collect_step_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_gc_budget_s    *budget = ctx;
+
+   if (ememoa_mempool_gc_budget_exhausted (budget))
+     return 1;
+
+   budget->visited++;
+   if (ememoa_used_pool_cb (budget->memory, index, data) == 0)
+     budget->freed++;
+
+   return 0;
+}
+
+/**
+ * Frees the empty pools of a memory pool, starting at budget->cursor and stopping as
+ * soon as the budget is exhausted. The lock is only held during this bounded walk.
+ *
+ * @param	memory		Pointer to a valid address of a memory pool. If
+ *				an invalid pool is passed, bad things will happen.
+ * @param	budget		Collection budget, budget->cursor is updated to the
+ *				pool index the next step should resume from.
+ * @return	Will return @c 1 if the walk reached the last pool, @c 0 if it was interrupted.
+ * @ingroup	Ememoa_Alloc_Mempool
+ */
+int
+ememoa_mempool_fixed_garbage_collect_step (struct ememoa_mempool_fixed_s	*memory,
+					   struct ememoa_mempool_gc_budget_s	*budget)
+{
+   void                                 *stop;
+   int                                  index = 0;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   /* Cached objects keep their pools alive. */
+   ememoa_fixed_flush (memory);
+
+   EMEMOA_LOCK(memory);
+
+   budget->memory = memory;
+   if (budget->cursor == 0)
+     {
+        memory->kept_objects = 0;
+        memory->peak_out_objects = memory->out_objects;
+     }
+   stop = ememoa_memory_base_resize_list_search_over (memory->base,
+                                                      budget->cursor,
+                                                      -1,
+                                                      ememoa_mempool_fixed_garbage_collect_step_cb,
+                                                      budget,
+                                                      &index);
+
+   EMEMOA_UNLOCK(memory);
+
+   budget->cursor = stop ? index : 0;
+   return stop == NULL;
 }
 
 struct ememoa_mempool_fixed_walk_ctx_s
@@ -851,21 +1836,22 @@ struct ememoa_mempool_fixed_walk_ctx_s
 static int
 ememoa_mempool_fixed_walk_over_cb (void *ctx, int index, void *data)
 {
-   struct ememoa_mempool_fixed_pool_s           *pool = data;
+   struct ememoa_mempool_fixed_pool_s           *pool = EMEMOA_POOL(data);
    struct ememoa_mempool_fixed_walk_ctx_s       *wctx = ctx;
    uint8_t                                      *start_address = pool->objects_pool;
-   bitmask_t                                    *objects_use = ememoa_bitmask_get_index(pool->objects_use, 0);
+   bitmask_t                                    *objects_use = pool->objects_use;
+   unsigned int                                 left = pool->max_objects;
    unsigned int                                 j, k;
 
    (void) index;
 
-   for (j = 0; j < wctx->memory->max_objects_poi; ++j)
+   for (j = 0; j < pool->objects; ++j)
      {
         bitmask_t	value = *objects_use++;
 
         for (k = 0;
-             k < (1 << BITMASK_POWER);
-             ++k, value >>= 1, start_address += wctx->memory->object_size)
+             k < (1 << BITMASK_POWER) && left;
+             ++k, --left, value >>= 1, start_address += wctx->memory->object_size)
           if ((value & 1) == 0)
             {
                wctx->error = wctx->fctl (start_address, wctx->data);
@@ -876,6 +1862,40 @@ ememoa_mempool_fixed_walk_over_cb (void *ctx, int index, void *data)
    return 0;
 }
 
+/**
+ * Executes fctl on all allocated data in the pool. The caller must already hold the
+ * memory pool lock.
+ *
+ * @param	memory		Pointer to a valid address of a memory pool. If
+ *				an invalid pool is passed, bad things will happen.
+ * @param	fctl		Function pointer that must be run on all allocated
+ *				objects.
+ * @param	data		Pointer that will be passed as is to each call to fctl.
+ * @return	Will return @c 0 if the run walked over all allocated objects.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+static int
+ememoa_mempool_fixed_walk_over_struct (struct ememoa_mempool_fixed_s	*memory,
+				       ememoa_fctl			fctl,
+				       void				*data)
+{
+   struct ememoa_mempool_fixed_walk_ctx_s       wctx;
+
+   wctx.memory = memory;
+   wctx.data = data;
+   wctx.fctl = fctl;
+   wctx.error = 0;
+
+   ememoa_memory_base_resize_list_search_over (memory->base,
+                                               0,
+                                               -1,
+                                               ememoa_mempool_fixed_walk_over_cb,
+                                               &wctx,
+                                               NULL);
+
+   return wctx.error;
+}
+
 /**
  * Executes fctl on all allocated data in the pool. If the execution of fctl returns something
  * else than 0, then the walk ends and returns the error code provided by fctl.
@@ -893,25 +1913,147 @@ ememoa_mempool_fixed_walk_over (int		mempool,
 				ememoa_fctl	fctl,
 				void		*data)
 {
-   struct ememoa_mempool_fixed_s                *memory = ememoa_mempool_fixed_get_index (mempool);
-   struct ememoa_mempool_fixed_walk_ctx_s       wctx;
+   return ememoa_fixed_walk_over (ememoa_mempool_fixed_get_index (mempool), fctl, data);
+}
+
+/**
+ * Flushes the cache, then executes fctl on all allocated data like
+ * ememoa_mempool_fixed_walk_over.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @param	fctl		Function pointer that must be run on all allocated
+ *				objects.
+ * @param	data		Pointer that will be passed as is to each call to fctl.
+ * @return	Will return @c 0 if the run walked over all allocated objects.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_walk_over (ememoa_fixed_t	*memory,
+			ememoa_fctl	fctl,
+			void		*data)
+{
+   int                                          error;
 
    EMEMOA_CHECK_MAGIC(memory);
+
+   ememoa_fixed_flush (memory);
+
    EMEMOA_LOCK(memory);
 
-   wctx.memory = memory;
-   wctx.data = data;
-   wctx.fctl = fctl;
+   error = ememoa_mempool_fixed_walk_over_struct (memory, fctl, data);
 
-   ememoa_memory_base_resize_list_search_over (memory->base,
-                                               0,
-                                               -1,
-                                               ememoa_mempool_fixed_walk_over_cb,
-                                               &wctx,
-                                               NULL);
+   EMEMOA_UNLOCK(memory);
+   return error;
+}
+
+/**
+ * Gives the contention statistics of the lock of a thread protected memory pool,
+ * useful to find which memory pool needs to be split between threads.
+ *
+ * @param	mempool		Index of a valid memory pool.
+ * @param	stat		Where to store the statistics.
+ * @return	Will return @c 0 on success.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_mempool_fixed_lock_stat (int					mempool,
+				struct ememoa_mempool_lock_stat_s	*stat)
+{
+   struct ememoa_mempool_fixed_s        *memory = ememoa_mempool_fixed_get_index (mempool);
+
+   if (memory == NULL)
+     return -1;
+
+   return ememoa_fixed_lock_stat (memory, stat);
+}
+
+/**
+ * Gives the contention statistics of the lock of a thread protected memory pool.
+ *
+ * @param	memory		Handle of a valid memory pool.
+ * @param	stat		Where to store the statistics.
+ * @return	Will return @c 0 on success.
+ * @ingroup	Ememoa_Mempool_Fixed
+ */
+int
+ememoa_fixed_lock_stat (const ememoa_fixed_t			*memory,
+			struct ememoa_mempool_lock_stat_s	*stat)
+{
+   EMEMOA_CHECK_MAGIC(memory);
+
+   ememoa_mempool_lock_stat (&(memory->lock), stat);
+   return 0;
+}
+
+struct ememoa_mempool_fixed_footprint_ctx_s
+{
+   struct ememoa_mempool_fixed_s        *memory;
+   struct ememoa_mempool_footprint_s    *footprint;
+};
+
+/**
+ * Callback adding the memory used by one pool to a footprint.
+ *
+ * @param       ctx     The memory pool and the footprint.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the pool.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Display_Mempool
+ */
+static int
+ememoa_mempool_fixed_footprint_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_fixed_footprint_ctx_s  *walk = ctx;
+   struct ememoa_mempool_fixed_s                *memory = walk->memory;
+   struct ememoa_mempool_fixed_pool_s           *pool = EMEMOA_POOL(data);
+   unsigned int                                 used;
+
+   (void) index;
+
+   used = pool->max_objects - pool->available_objects;
+
+   walk->footprint->pools++;
+   walk->footprint->objects += used;
+   walk->footprint->reserved += EMEMOA_SIZEOF_POOL_HEADER(memory, pool->objects) + EMEMOA_SIZEOF_POOL(memory, pool->max_objects);
+   walk->footprint->wasted += pool->wasted;
+   if (used && pool->available_objects)
+     walk->footprint->free_partial += (unsigned long long) pool->available_objects * memory->object_size;
+
+   return 0;
+}
+
+/**
+ * Add the memory used by a memory pool to footprint. Objects waiting in the cache
+ * are counted as free space of their pool.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	footprint	Where to add the counters.
+ * @ingroup	Ememoa_Display_Mempool
+ */
+void
+ememoa_mempool_fixed_footprint (struct ememoa_mempool_fixed_s		*memory,
+				struct ememoa_mempool_footprint_s	*footprint)
+{
+   struct ememoa_mempool_fixed_footprint_ctx_s  walk;
+   unsigned int                                 objects = footprint->objects;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   walk.memory = memory;
+   walk.footprint = footprint;
+
+   EMEMOA_LOCK(memory);
+
+   ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_footprint_cb, &walk);
+
+   footprint->objects -= memory->cache.count;
+   footprint->free_partial += (unsigned long long) memory->cache.count * memory->object_size;
 
    EMEMOA_UNLOCK(memory);
-   return wctx.error;
+
+   objects = footprint->objects - objects;
+   footprint->requested += (unsigned long long) objects * memory->requested_size;
+   footprint->handed += (unsigned long long) objects * memory->object_size;
 }
 
 /**
@@ -931,7 +2073,7 @@ static int
 ememoa_mempool_fixed_display_pool_cb (void *ctx, int index, void *data)
 {
    struct ememoa_mempool_fixed_s        *memory = ctx;
-   struct ememoa_mempool_fixed_pool_s   *pool = data;
+   struct ememoa_mempool_fixed_pool_s   *pool = EMEMOA_POOL(data);
    unsigned int				i, j;
    char					display[64] = "";
    bitmask_t				value;
@@ -940,17 +2082,17 @@ ememoa_mempool_fixed_display_pool_cb (void *ctx, int index, void *data)
    (void) index;
 
    bound_l = EMEMOA_EVAL_BOUND_LOW(pool->objects_pool);
-   bound_h = EMEMOA_EVAL_BOUND_HIGH(pool->objects_pool, (*memory));
+   bound_h = EMEMOA_EVAL_BOUND_HIGH(pool->objects_pool, (*memory), pool);
 
-   printf ("Available objects: %i\n", pool->available_objects);
+   printf ("Available objects: %i of %i, wasted bytes: %i\n", pool->available_objects, pool->max_objects, pool->wasted);
    printf ("Start at: %p, end at: %p\n", (void*) bound_l, (void*) bound_h);
 
    if (bound_l != 0)
      {
 	display[(1 << BITMASK_POWER)] = '\0';
-	for (i = 0; i < memory->max_objects_poi; ++i)
+	for (i = 0; i < pool->objects; ++i)
 	  {
-	     bitmask_t	*objects_use = ememoa_bitmask_get_index(pool->objects_use, 0);
+	     bitmask_t	*objects_use = pool->objects_use;
 
 	     value = objects_use[i];
 	     for (j = 0; j < (1 << BITMASK_POWER); ++j, value >>= 1)
@@ -972,6 +2114,23 @@ ememoa_mempool_fixed_display_pool_cb (void *ctx, int index, void *data)
    return 0;
 }
 
+/**
+ * Callback counting the objects a pool can hold.
+ *
+ * @param       ctx     Useless in this context.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the pool.
+ * @return      Will return the size of the pool in objects.
+ * @ingroup     Ememoa_Display_Mempool
+ */
+static int
+ememoa_mempool_fixed_capacity_cb (void *ctx, int index, void *data)
+{
+   (void) ctx; (void) index;
+
+   return EMEMOA_POOL(data)->max_objects;
+}
+
 /**
  * Displays all the statistic currently known about a Mempool, usefull to dimension it.
  *
@@ -986,26 +2145,27 @@ ememoa_mempool_fixed_display_statistic (int mempool)
 
    printf ("Memory information for pool located at : %p\n", (void*) memory);
 
-   EMEMOA_LOCK(memory);
-
 #ifdef	DEBUG
    printf ("Memory magic is : %x\n", memory->magic);
    if (memory->magic != EMEMOA_MAGIC)
      return ;
 #endif
 
+   ememoa_fixed_flush (memory);
+
+   EMEMOA_LOCK(memory);
+
    if (memory->desc && memory->desc->name)
      printf ("This pool contains : %s.\n", memory->desc->name);
 
-   printf ("Objects per pool: %i[%x] (for poi: %i, pot: %i)\n", memory->max_objects, memory->max_objects, memory->max_objects_poi, memory->max_objects_pot);
+   printf ("Objects per pool: %i[%x] (for poi: %i, pot: %i to %i)\n", memory->max_objects, memory->max_objects, memory->max_objects_poi, memory->max_objects_pot, memory->max_pool_pot);
    printf ("Object size: %i\n", memory->object_size);
    printf ("Allocated pool: %i\n", memory->base->actif);
 
-#ifdef DEBUG
    printf ("Objects currently delivered: %i.\n", memory->out_objects);
-   printf ("Total objects currently in pool: %i.\n", memory->max_objects * memory->base->actif);
+   printf ("Total objects currently in pool: %i.\n",
+           ememoa_memory_base_resize_list_walk_over (memory->base, 0, -1, ememoa_mempool_fixed_capacity_cb, NULL));
    printf ("Maximum delivered objects since the birth of the memory pool: %i.\n", memory->max_out_objects);
-#endif
 
    ememoa_memory_base_resize_list_walk_over (memory->base,
                                              0,
@@ -1021,7 +2181,7 @@ ememoa_mempool_fixed_display_statistic (int mempool)
 	if (memory->desc->data_display)
 	  {
 	     printf ("=== Content ===\n");
-	     ememoa_mempool_fixed_walk_over (mempool, memory->desc->data_display, name);
+	     ememoa_mempool_fixed_walk_over_struct (memory, memory->desc->data_display, name);
 	     printf ("=== ===\n");
 	  }
      }
@@ -1059,9 +2219,10 @@ ememoa_mempool_fixed_display_statistic_count_cb (void* ctx, int index, void *dat
 static int
 ememoa_mempool_fixed_display_statistic_cb (void* ctx, int index, void *data)
 {
-   (void) ctx; (void) data;
+   (void) ctx;
 
-   ememoa_mempool_fixed_display_statistic (index);
+   if (__atomic_load_n ((struct ememoa_mempool_fixed_s**) data, __ATOMIC_ACQUIRE))
+     ememoa_mempool_fixed_display_statistic (index);
    return 0;
 }
 
@@ -1075,8 +2236,13 @@ ememoa_mempool_fixed_display_statistic_all (void)
 {
    int                                  result = 0;
 
+   if (fixed_pool_list == NULL)
+     return ;
+
+   EMEMOA_LIST_LOCK();
    result = ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_mempool_fixed_display_statistic_count_cb, NULL);
    printf ("%i mempool are used in %i currently allocated.\n", result, fixed_pool_list->count);
    ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_mempool_fixed_display_statistic_cb, NULL);
+   EMEMOA_LIST_UNLOCK();
 }
 
@@ -0,0 +1,163 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide the out of line part of the compile time specialized
+** fixed size memory pool, the fast path live in ememoa_mempool_fixed_static.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "ememoa_mempool_fixed_static.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+
+/* Objects start on a two pointers boundary after the pool header and its bitmap. */
+#define EMEMOA_STATIC_HEADER(Pot) \
+  ((sizeof (struct ememoa_mempool_fixed_static_pool_s) + ((1 << (Pot)) >> 3) + 2 * sizeof (void*) - 1) \
+   & ~(2 * sizeof (void*) - 1))
+
+/**
+ * @defgroup Ememoa_Mempool_Fixed_Static Compile time specialized memory pool.
+ *
+ */
+
+/**
+ * Allocate a new pool and give its first object. Called with the memory pool lock held
+ * when no pool has an available object left.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	object_size	Aligned size of the objects.
+ * @param	pot		Power of two of the number of objects per pool.
+ * @return	Will return the first object of the new pool, or @c NULL if out of memory.
+ * @ingroup	Ememoa_Mempool_Fixed_Static
+ */
+void*
+ememoa_mempool_fixed_static_add_pool (struct ememoa_mempool_fixed_static_s	*memory,
+				      unsigned int				object_size,
+				      unsigned int				pot)
+{
+   struct ememoa_mempool_fixed_static_pool_s    *pool;
+   uint32_t                                     *objects_use;
+
+   assert (pot >= 5);
+
+   if (memory->pools_count == memory->pools_size)
+     {
+        struct ememoa_mempool_fixed_static_pool_s       **tmp;
+        unsigned int                                    size;
+
+        size = memory->pools_size ? memory->pools_size * 2 : 4;
+        tmp = ememoa_memory_base_realloc (memory->pools, sizeof (struct ememoa_mempool_fixed_static_pool_s*) * size);
+        if (tmp == NULL)
+          return NULL;
+
+        memory->pools = tmp;
+        memory->pools_size = size;
+     }
+
+   pool = ememoa_memory_base_alloc (EMEMOA_STATIC_HEADER(pot) + ((size_t) object_size << pot));
+   if (pool == NULL)
+     return NULL;
+
+   pool->objects_pool = (uint8_t*) pool + EMEMOA_STATIC_HEADER(pot);
+   pool->available_objects = (1 << pot) - 1;
+   pool->jump_object = 0;
+
+   objects_use = EMEMOA_MEMPOOL_FIXED_STATIC_BITMAP(pool);
+   memset (objects_use, 0xFF, (1 << pot) >> 3);
+   objects_use[0] &= ~1;
+
+#ifdef DEBUG
+   memset (pool->objects_pool, 42, (size_t) object_size << pot);
+#endif
+
+   memory->jump_pool = memory->pools_count;
+   memory->pools[memory->pools_count++] = pool;
+
+   return pool->objects_pool;
+}
+
+/**
+ * Give back all empty pools. Called with the memory pool lock held.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	pot		Power of two of the number of objects per pool.
+ * @return	Will return the number of pools freed.
+ * @ingroup	Ememoa_Mempool_Fixed_Static
+ */
+int
+ememoa_mempool_fixed_static_garbage_collect (struct ememoa_mempool_fixed_static_s	*memory,
+					     unsigned int				pot)
+{
+   unsigned int i;
+   unsigned int j;
+
+   for (i = 0, j = 0; i < memory->pools_count; ++i)
+     if (memory->pools[i]->available_objects == (1U << pot))
+       ememoa_memory_base_free (memory->pools[i]);
+     else
+       memory->pools[j++] = memory->pools[i];
+
+   i = memory->pools_count - j;
+   memory->pools_count = j;
+   memory->jump_pool = 0;
+
+   return i;
+}
+
+/**
+ * Wait for the lock of a thread protected memory pool that was not free on the
+ * first try, spinning a little then sleeping.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @ingroup	Ememoa_Mempool_Fixed_Static
+ */
+void
+ememoa_mempool_fixed_static_lock_slow (struct ememoa_mempool_fixed_static_s	*memory)
+{
+   ememoa_mempool_lock_word_take_slow (&memory->lock);
+}
+
+/**
+ * Wake up a thread sleeping on the lock of a memory pool.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @ingroup	Ememoa_Mempool_Fixed_Static
+ */
+void
+ememoa_mempool_fixed_static_unlock_slow (struct ememoa_mempool_fixed_static_s	*memory)
+{
+   ememoa_mempool_lock_word_release_slow (&memory->lock);
+}
+
+/**
+ * Destroys all objects and pools of the memory pool. It can be used again after
+ * this call.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @return	Will return @c 0 if successfully cleaned.
+ * @ingroup	Ememoa_Mempool_Fixed_Static
+ */
+int
+ememoa_mempool_fixed_static_clean (struct ememoa_mempool_fixed_static_s		*memory)
+{
+   unsigned int i;
+
+   for (i = 0; i < memory->pools_count; ++i)
+     ememoa_memory_base_free (memory->pools[i]);
+
+   ememoa_memory_base_free (memory->pools);
+
+   memory->pools = NULL;
+   memory->pools_count = 0;
+   memory->pools_size = 0;
+   memory->jump_pool = 0;
+
+   return 0;
+}
@@ -0,0 +1,395 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide an incremental garbage collector walking over all
+** fixed memory pool (and so over all unknown size memory pool).
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <sched.h>
+
+static pthread_mutex_t gc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define LK(Lock) pthread_mutex_lock(&Lock);
+#define ULK(Lock) pthread_mutex_unlock(&Lock);
+
+#else
+
+#define LK(Lock)
+#define ULK(Lock)
+
+#endif
+
+#include "ememoa_mempool_gc.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+#include "ememoa_trace.h"
+
+/**
+ * @defgroup Ememoa_Mempool_Gc Incremental garbage collector.
+ *
+ */
+
+/**
+ * Memory pool index the next step will resume from.
+ * @ingroup Ememoa_Mempool_Gc
+ */
+static int      gc_mempool = 0;
+
+/**
+ * Pool index inside gc_mempool the next step will resume from.
+ * @ingroup Ememoa_Mempool_Gc
+ */
+static int      gc_pool = 0;
+
+/**
+ * Check if a collection step has consumed all the work it was allowed to do.
+ *
+ * @param       budget  The budget of the running step.
+ * @return	Will return @c 1 if the step must stop now.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+int
+ememoa_mempool_gc_budget_exhausted (struct ememoa_mempool_gc_budget_s *budget)
+{
+   struct timespec      now;
+   unsigned long long   elapsed;
+
+   if (budget->max_pools && budget->visited >= budget->max_pools)
+     return 1;
+
+   if (budget->max_ns == 0)
+     return 0;
+
+   clock_gettime (CLOCK_MONOTONIC, &now);
+   elapsed = (now.tv_sec - budget->start.tv_sec) * 1000000000ULL;
+   elapsed += now.tv_nsec;
+   elapsed -= budget->start.tv_nsec;
+
+   return elapsed >= budget->max_ns;
+}
+
+/**
+ * Callback running a bounded collection step on one memory pool. It is called with
+ * the registry lock held, and only keeps the memory pool pinned during its step.
+ *
+ * @param       ctx     Pointer to the current collection budget.
+ * @param       index   Memory pool index.
+ * @param       data    Pointer to the fixed_pool_list slot of the memory pool.
+ * @return      Will return @c 1 when the walk over memory pool must stop.
+ * @ingroup     Ememoa_Mempool_Gc
+ */
+static int
+ememoa_mempool_gc_step_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_gc_budget_s    *budget = ctx;
+   struct ememoa_mempool_fixed_s        *memory;
+   int                                  done;
+
+   if (budget->mempool != index)
+     {
+        budget->mempool = index;
+        budget->cursor = 0;
+     }
+
+   memory = __atomic_load_n ((struct ememoa_mempool_fixed_s**) data, __ATOMIC_ACQUIRE);
+   if (memory == NULL)
+     return 0;
+
+   /* Nothing protects an unlocked memory pool from its own thread. */
+   if (budget->protected_only && !(memory->options & EMEMOA_THREAD_PROTECTION))
+     return 0;
+
+   ememoa_mempool_fixed_registry_pin (memory);
+   done = ememoa_mempool_fixed_garbage_collect_step (memory, budget);
+   ememoa_mempool_fixed_registry_unpin ();
+
+   return !done;
+}
+
+/**
+ * Run one collection step, see ememoa_mempool_gc_step_ext.
+ *
+ * @param	max_pools	Maximum number of pools to look at, @c 0 means no limit.
+ * @param	max_ns		Maximum time spent in this call in nanoseconds, @c 0 means
+ *				no limit.
+ * @param	protected_only	Skip the memory pools without EMEMOA_THREAD_PROTECTION.
+ * @param	done		Where to store @c 1 if the walk is complete, can be @c NULL.
+ * @return	Will return the number of pools given back to the system during this step.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+static int
+ememoa_mempool_gc_run (unsigned int	max_pools,
+		       unsigned int	max_ns,
+		       unsigned int	protected_only,
+		       unsigned int	*done)
+{
+   struct ememoa_mempool_gc_budget_s    budget;
+   void                                 *stop;
+   int                                  index = 0;
+
+   LK(gc_lock);
+
+   if (fixed_pool_list == NULL)
+     {
+        ULK(gc_lock);
+        if (done)
+          *done = 1;
+        return 0;
+     }
+
+   budget.max_pools = max_pools;
+   budget.max_ns = max_ns;
+   budget.visited = 0;
+   budget.protected_only = protected_only;
+   budget.freed = 0;
+   budget.memory = NULL;
+   budget.mempool = gc_mempool;
+   budget.cursor = gc_pool;
+   if (max_ns)
+     clock_gettime (CLOCK_MONOTONIC, &budget.start);
+
+   ememoa_mempool_fixed_registry_lock ();
+   stop = ememoa_memory_base_resize_list_search_over (fixed_pool_list,
+                                                      gc_mempool,
+                                                      -1,
+                                                      ememoa_mempool_gc_step_cb,
+                                                      &budget,
+                                                      &index);
+   ememoa_mempool_fixed_registry_unlock ();
+
+   EMEMOA_TRACE3(gc_step, budget.visited, budget.freed, stop != NULL);
+
+   if (stop)
+     {
+        gc_mempool = index;
+        gc_pool = budget.cursor;
+     }
+   else
+     {
+        gc_mempool = 0;
+        gc_pool = 0;
+     }
+
+   ULK(gc_lock);
+
+   if (done)
+     *done = stop == NULL;
+   return budget.freed;
+}
+
+/**
+ * Run the garbage collector over all memory pool, but stop after having looked at
+ * max_pools pools or after max_ns nanoseconds. The next call resumes where the previous
+ * one stopped, so calling it regularly with a small budget will give back all empty
+ * pools without long pauses. Each memory pool is only locked while its own part of
+ * the step is running.
+ *
+ * A step can free nothing while most of the walk is still ahead, so use done to know
+ * when the walk reached the last memory pool. The next step starts a new walk from
+ * the first one.
+ *
+ * @code
+ *   unsigned int done = 0;
+ *
+ *   while (!done)
+ *     ememoa_mempool_gc_step_ext (16, 50000, &done);
+ * @endcode
+ *
+ * @param	max_pools	Maximum number of pools to look at, @c 0 means no limit.
+ * @param	max_ns		Maximum time spent in this call in nanoseconds, @c 0 means
+ *				no limit.
+ * @param	done		Where to store @c 1 if this step completed the walk, and
+ *				@c 0 if it stopped on its budget. Can be @c NULL.
+ * @return	Will return the number of pools given back to the system during this step.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+int
+ememoa_mempool_gc_step_ext (unsigned int	max_pools,
+			    unsigned int	max_ns,
+			    unsigned int	*done)
+{
+   return ememoa_mempool_gc_run (max_pools, max_ns, 0, done);
+}
+
+/**
+ * Same as ememoa_mempool_gc_step_ext, without telling if the walk is complete.
+ *
+ * @param	max_pools	Maximum number of pools to look at, @c 0 means no limit.
+ * @param	max_ns		Maximum time spent in this call in nanoseconds, @c 0 means
+ *				no limit.
+ * @return	Will return the number of pools given back to the system during this step.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+int
+ememoa_mempool_gc_step (unsigned int	max_pools,
+			unsigned int	max_ns)
+{
+   return ememoa_mempool_gc_run (max_pools, max_ns, 0, NULL);
+}
+
+#ifdef HAVE_PTHREAD
+struct ememoa_mempool_gc_thread_s
+{
+   pthread_t            thread;
+   pthread_mutex_t      lock;
+   pthread_cond_t       cond;
+
+   unsigned int         period_ms;
+   unsigned int         max_pools;
+   unsigned int         max_ns;
+
+   unsigned char        running;
+   unsigned char        stop;
+};
+
+static struct ememoa_mempool_gc_thread_s       gc_thread = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * Main loop of the background garbage collector. It runs at the lowest priority
+ * available and sleeps period_ms between each step.
+ *
+ * @param       data    Useless in this context.
+ * @return      Will always return @c NULL.
+ * @ingroup     Ememoa_Mempool_Gc
+ */
+static void*
+ememoa_mempool_gc_thread_main (void *data)
+{
+   struct timespec      deadline;
+   struct timeval       now;
+
+   (void) data;
+
+#ifdef SCHED_IDLE
+   {
+      struct sched_param        param;
+
+      param.sched_priority = 0;
+      pthread_setschedparam (pthread_self (), SCHED_IDLE, &param);
+   }
+#endif
+
+   pthread_mutex_lock (&gc_thread.lock);
+   while (!gc_thread.stop)
+     {
+        pthread_mutex_unlock (&gc_thread.lock);
+
+        ememoa_mempool_gc_run (gc_thread.max_pools, gc_thread.max_ns, 1, NULL);
+
+        gettimeofday (&now, NULL);
+        deadline.tv_sec = now.tv_sec + gc_thread.period_ms / 1000;
+        deadline.tv_nsec = now.tv_usec * 1000 + (gc_thread.period_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+          {
+             deadline.tv_sec++;
+             deadline.tv_nsec -= 1000000000;
+          }
+
+        pthread_mutex_lock (&gc_thread.lock);
+        while (!gc_thread.stop
+               && pthread_cond_timedwait (&gc_thread.cond, &gc_thread.lock, &deadline) != ETIMEDOUT)
+          ;
+     }
+   pthread_mutex_unlock (&gc_thread.lock);
+
+   return NULL;
+}
+#endif
+
+/**
+ * Start a background thread calling ememoa_mempool_gc_step every period_ms with
+ * the given budget. Only one background collector can run at a time. The thread
+ * only looks at memory pools created with EMEMOA_THREAD_PROTECTION, the others
+ * can only be collected by their own thread.
+ *
+ * @param	period_ms	Time to sleep between two steps in milliseconds.
+ * @param	max_pools	Budget in pools given to each step, @c 0 means no limit.
+ * @param	max_ns		Budget in nanoseconds given to each step, @c 0 means no limit.
+ * @return	Will return @c 0 if the thread is running, @c -1 if it was already
+ *		running, or if ememoa was built without pthread support.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+int
+ememoa_mempool_gc_thread_start (unsigned int	period_ms,
+				unsigned int	max_pools,
+				unsigned int	max_ns)
+{
+#ifdef HAVE_PTHREAD
+   pthread_mutex_lock (&gc_thread.lock);
+
+   if (gc_thread.running)
+     {
+        pthread_mutex_unlock (&gc_thread.lock);
+        return -1;
+     }
+
+   gc_thread.period_ms = period_ms;
+   gc_thread.max_pools = max_pools;
+   gc_thread.max_ns = max_ns;
+   gc_thread.stop = 0;
+
+   if (pthread_create (&gc_thread.thread, NULL, ememoa_mempool_gc_thread_main, NULL))
+     {
+        pthread_mutex_unlock (&gc_thread.lock);
+        return -1;
+     }
+
+   gc_thread.running = 1;
+   pthread_mutex_unlock (&gc_thread.lock);
+
+   return 0;
+#else
+   (void) period_ms; (void) max_pools; (void) max_ns;
+
+   return -1;
+#endif
+}
+
+/**
+ * Stop the background garbage collector and wait for it to finish its current step.
+ *
+ * @return	Will return @c 0 if the thread was stopped, @c -1 if it was not running.
+ * @ingroup	Ememoa_Mempool_Gc
+ */
+int
+ememoa_mempool_gc_thread_stop (void)
+{
+#ifdef HAVE_PTHREAD
+   pthread_mutex_lock (&gc_thread.lock);
+
+   if (!gc_thread.running)
+     {
+        pthread_mutex_unlock (&gc_thread.lock);
+        return -1;
+     }
+
+   gc_thread.stop = 1;
+   pthread_cond_signal (&gc_thread.cond);
+   pthread_mutex_unlock (&gc_thread.lock);
+
+   pthread_join (gc_thread.thread, NULL);
+
+   pthread_mutex_lock (&gc_thread.lock);
+   gc_thread.running = 0;
+   pthread_mutex_unlock (&gc_thread.lock);
+
+   return 0;
+#else
+   return -1;
+#endif
+}
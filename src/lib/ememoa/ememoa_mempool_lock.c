@@ -0,0 +1,207 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide the lock used by thread protected memory pool, either a
+** pthread mutex or a spin then sleep lock, with contention statistics.
+*/
+
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "config.h"
+
+#include <sched.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "ememoa_mempool_fixed.h"
+#include "mempool_struct.h"
+
+/* Number of tries before an adaptive lock goes to sleep. */
+#define EMEMOA_LOCK_SPIN	100
+
+/**
+ * @defgroup Ememoa_Mempool_Lock Lock of thread protected memory pool.
+ *
+ */
+
+/**
+ * Sleep as long as the adaptive lock word is still equal to value.
+ *
+ * @param	word	Pointer to the lock word.
+ * @param	value	Value that the lock word had.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+static inline void
+ememoa_mempool_lock_wait (int *word, int value)
+{
+#ifdef HAVE_LINUX_FUTEX_H
+   syscall (SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+   (void) word; (void) value;
+   sched_yield ();
+#endif
+}
+
+/**
+ * Wake up one thread sleeping on the adaptive lock word.
+ *
+ * @param	word	Pointer to the lock word.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+static inline void
+ememoa_mempool_lock_wake (int *word)
+{
+#ifdef HAVE_LINUX_FUTEX_H
+   syscall (SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+   (void) word;
+#endif
+}
+
+/**
+ * Take a spin then sleep lock word that was not free on the first try. The word
+ * is 0 when free, 1 when locked and 2 when locked with sleepers.
+ *
+ * @param	word	Pointer to the lock word.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_word_take_slow (int *word)
+{
+   unsigned int	i;
+   int		c;
+
+   /* Most memory pool operations are short, spinning a little often avoid the syscall. */
+   for (i = 0; i < EMEMOA_LOCK_SPIN; ++i)
+     {
+	c = 0;
+	if (__atomic_load_n (word, __ATOMIC_RELAXED) == 0
+	    && __atomic_compare_exchange_n (word, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	  return ;
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause ();
+#endif
+     }
+
+   while (__atomic_exchange_n (word, 2, __ATOMIC_ACQUIRE) != 0)
+     ememoa_mempool_lock_wait (word, 2);
+}
+
+/**
+ * Wake up a sleeper after a lock word that had some was released.
+ *
+ * @param	word	Pointer to the lock word.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_word_release_slow (int *word)
+{
+   ememoa_mempool_lock_wake (word);
+}
+
+#ifdef HAVE_PTHREAD
+
+/**
+ * Initialize a memory pool lock. The EMEMOA_ADAPTIVE_LOCK bit of options select
+ * the spin then sleep lock instead of the pthread mutex.
+ *
+ * @param	lock		Pointer to the lock.
+ * @param	options		Options of the memory pool.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_init (struct ememoa_mempool_lock_s	*lock,
+			  unsigned int			options)
+{
+   bzero (lock, sizeof (struct ememoa_mempool_lock_s));
+   lock->adaptive = (options & EMEMOA_ADAPTIVE_LOCK) == EMEMOA_ADAPTIVE_LOCK;
+   if (!lock->adaptive)
+     pthread_mutex_init (&(lock->mutex), NULL);
+}
+
+/**
+ * Destroy a memory pool lock.
+ *
+ * @param	lock		Pointer to the lock.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_destroy (struct ememoa_mempool_lock_s	*lock)
+{
+   if (!lock->adaptive)
+     pthread_mutex_destroy (&(lock->mutex));
+}
+
+/**
+ * Take a lock that was not free on the first try, and account the time spent
+ * waiting for it. Called by ememoa_mempool_lock_take.
+ *
+ * @param	lock		Pointer to the lock.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_take_slow (struct ememoa_mempool_lock_s	*lock)
+{
+   struct timespec	start;
+   struct timespec	now;
+
+   clock_gettime (CLOCK_MONOTONIC, &start);
+
+   if (!lock->adaptive)
+     {
+	pthread_mutex_lock (&(lock->mutex));
+	goto locked;
+     }
+
+   ememoa_mempool_lock_word_take_slow (&lock->word);
+
+ locked:
+   clock_gettime (CLOCK_MONOTONIC, &now);
+
+   lock->acquisitions++;
+   lock->contended++;
+   lock->wait_ns += (now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec;
+}
+
+/**
+ * Wake up a sleeper after an adaptive lock was released. Called by
+ * ememoa_mempool_lock_release.
+ *
+ * @param	lock		Pointer to the lock.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_release_slow (struct ememoa_mempool_lock_s	*lock)
+{
+   ememoa_mempool_lock_word_release_slow (&lock->word);
+}
+
+#endif
+
+/**
+ * Copy the contention statistics of a memory pool lock. They are only updated
+ * by the lock holder, so they can be slightly late when read from another thread.
+ *
+ * @param	lock		Pointer to the lock.
+ * @param	stat		Where to store the statistics.
+ * @ingroup	Ememoa_Mempool_Lock
+ */
+void
+ememoa_mempool_lock_stat (const struct ememoa_mempool_lock_s	*lock,
+			  struct ememoa_mempool_lock_stat_s	*stat)
+{
+   stat->acquisitions = __atomic_load_n (&lock->acquisitions, __ATOMIC_RELAXED);
+   stat->contended = __atomic_load_n (&lock->contended, __ATOMIC_RELAXED);
+   stat->wait_ns = __atomic_load_n (&lock->wait_ns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,424 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide a sampling heap profiler for unknown size memory pool.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include "ememoa_mempool_profile.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+
+/* Frames kept for each sample, the profiler own frames are not part of them. */
+#define EMEMOA_PROFILE_DEPTH	24
+#define EMEMOA_PROFILE_SKIP	2
+
+struct ememoa_mempool_profile_sample_s
+{
+   void			*ptr;
+   size_t		weight;
+   int			depth;
+   void			*frames[EMEMOA_PROFILE_DEPTH];
+};
+
+/**
+ * @defgroup Ememoa_Mempool_Profile Sampling heap profiler.
+ *
+ */
+
+/**
+ * Average number of bytes between two samples, 0 when the profiler is stopped.
+ * @ingroup Ememoa_Mempool_Profile
+ */
+unsigned int                                    ememoa_mempool_profile_rate = 0;
+
+/**
+ * Number of samples currently in the table, push only look at the table when it is not 0.
+ * @ingroup Ememoa_Mempool_Profile
+ */
+unsigned int                                    ememoa_mempool_profile_live = 0;
+
+/**
+ * Bytes left to allocate by this thread before the next sample.
+ * @ingroup Ememoa_Mempool_Profile
+ */
+__thread long                                   ememoa_mempool_profile_countdown = 0;
+
+/* The table is allocated by the first start and never freed, so push can look at it
+   without taking the lock. */
+static struct ememoa_mempool_profile_sample_s   *samples = NULL;
+static unsigned int                             samples_mask = 0;
+static unsigned int                             samples_max = 0;
+static unsigned int                             samples_dropped = 0;
+static unsigned char                            samples_lock = 0;
+/* Odd while a removal moves samples around, and bumped by each removal, so a lookup
+   without the lock knows when a miss could be wrong. */
+static unsigned int                             samples_generation = 0;
+
+#define PROFILE_LOCK() \
+  while (__atomic_exchange_n (&samples_lock, 1, __ATOMIC_ACQUIRE)) \
+    while (__atomic_load_n (&samples_lock, __ATOMIC_RELAXED)) ;
+
+#define PROFILE_UNLOCK() \
+  __atomic_store_n (&samples_lock, 0, __ATOMIC_RELEASE);
+
+/**
+ * Hash an object address to its first slot in the table.
+ *
+ * @param	ptr	Object address.
+ * @return	Will return the slot index.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+static inline unsigned int
+ememoa_mempool_profile_hash (const void *ptr)
+{
+   return (unsigned int) (((uintptr_t) ptr >> 4) * 2654435761U) & samples_mask;
+}
+
+/**
+ * Distance to the next sample. It is jittered so allocation patterns that repeat
+ * every sample_bytes are not always or never seen.
+ *
+ * @return	Will return the number of bytes before the next sample.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+static long
+ememoa_mempool_profile_next (void)
+{
+   static __thread unsigned int	seed = 0;
+   unsigned int			rate = ememoa_mempool_profile_rate;
+
+   if (seed == 0)
+     seed = (unsigned int) (uintptr_t) &seed | 1;
+
+   /* xorshift, uniform between rate / 2 and 3 * rate / 2. */
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+
+   return rate / 2 + (rate > 1 ? seed % rate : 0) + 1;
+}
+
+/**
+ * Start sampling unknown size memory pool allocations. Calling it again only
+ * change the sampling rate, the table keeps the size it got the first time.
+ *
+ * @param	sample_bytes	Average number of bytes allocated between two samples.
+ * @param	max_samples	Maximum number of live samples kept, the others are dropped.
+ * @return	Will return @c 0 on success, @c -1 if backtrace are not available or
+ *		if the table could not be allocated.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+int
+ememoa_mempool_profile_start (unsigned int	sample_bytes,
+			      unsigned int	max_samples)
+{
+#ifdef HAVE_EXECINFO_H
+   void		*frames[1];
+   unsigned int	size;
+
+   if (sample_bytes == 0 || max_samples == 0)
+     return -1;
+
+   /* The first call to backtrace may allocate, do it now and not during a sample. */
+   backtrace (frames, 1);
+
+   PROFILE_LOCK();
+
+   if (samples == NULL)
+     {
+	/* Keep the table at most half full so lookups stay short. */
+	for (size = 2; size < max_samples * 2; size <<= 1)
+	  ;
+
+	samples = ememoa_memory_base_alloc (sizeof (struct ememoa_mempool_profile_sample_s) * size);
+	if (samples == NULL)
+	  {
+	     PROFILE_UNLOCK();
+	     return -1;
+	  }
+	bzero (samples, sizeof (struct ememoa_mempool_profile_sample_s) * size);
+
+	samples_mask = size - 1;
+	samples_max = max_samples;
+     }
+
+   __atomic_store_n (&ememoa_mempool_profile_rate, sample_bytes, __ATOMIC_RELEASE);
+
+   PROFILE_UNLOCK();
+
+   return 0;
+#else
+   (void) sample_bytes;
+   (void) max_samples;
+   return -1;
+#endif
+}
+
+/**
+ * Stop sampling and forget all samples.
+ *
+ * @return	Will return @c 0.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+int
+ememoa_mempool_profile_stop (void)
+{
+   unsigned int	i;
+
+   PROFILE_LOCK();
+
+   __atomic_store_n (&ememoa_mempool_profile_rate, 0, __ATOMIC_RELEASE);
+   __atomic_store_n (&ememoa_mempool_profile_live, 0, __ATOMIC_RELEASE);
+
+   if (samples)
+     for (i = 0; i <= samples_mask; ++i)
+       __atomic_store_n (&samples[i].ptr, NULL, __ATOMIC_RELAXED);
+   samples_dropped = 0;
+
+   PROFILE_UNLOCK();
+
+   return 0;
+}
+
+/**
+ * Record the call stack of a new object. Called by ememoa_mempool_profile_pop
+ * when the countdown of this thread ran out.
+ *
+ * @param	ptr	The new object.
+ * @param	size	Its size.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+void
+ememoa_mempool_profile_record (void		*ptr,
+			       unsigned int	size)
+{
+#ifdef HAVE_EXECINFO_H
+   struct ememoa_mempool_profile_sample_s	*sample;
+   void						*frames[EMEMOA_PROFILE_DEPTH + EMEMOA_PROFILE_SKIP];
+   unsigned int					rate = ememoa_mempool_profile_rate;
+   unsigned int					i;
+   int						depth;
+
+   ememoa_mempool_profile_countdown = ememoa_mempool_profile_next ();
+   if (rate == 0)
+     return ;
+
+   depth = backtrace (frames, EMEMOA_PROFILE_DEPTH + EMEMOA_PROFILE_SKIP) - EMEMOA_PROFILE_SKIP;
+   if (depth <= 0)
+     return ;
+
+   PROFILE_LOCK();
+
+   if (ememoa_mempool_profile_live >= samples_max)
+     {
+	samples_dropped++;
+	PROFILE_UNLOCK();
+	return ;
+     }
+
+   for (i = ememoa_mempool_profile_hash (ptr);
+	samples[i].ptr != NULL;
+	i = (i + 1) & samples_mask)
+     ;
+
+   sample = samples + i;
+   /* Small objects stand for all the bytes allocated since the previous sample. */
+   sample->weight = size < rate ? rate : size;
+   sample->depth = depth;
+   memcpy (sample->frames, frames + EMEMOA_PROFILE_SKIP, sizeof (void*) * depth);
+   __atomic_store_n (&sample->ptr, ptr, __ATOMIC_RELEASE);
+
+   __atomic_store_n (&ememoa_mempool_profile_live, ememoa_mempool_profile_live + 1, __ATOMIC_RELEASE);
+
+   PROFILE_UNLOCK();
+#else
+   (void) ptr;
+   (void) size;
+#endif
+}
+
+/**
+ * Look for the sample of an object.
+ *
+ * @param	ptr	The object.
+ * @return	Will return the slot of its sample, or @c -1 if it has none.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+static int
+ememoa_mempool_profile_lookup (const void *ptr)
+{
+   void		*key;
+   unsigned int	i;
+   unsigned int	j;
+
+   /* The table is never full, but a lookup racing with a removal could see it so. */
+   for (i = ememoa_mempool_profile_hash (ptr), j = 0;
+	j <= samples_mask && (key = __atomic_load_n (&samples[i].ptr, __ATOMIC_ACQUIRE)) != NULL;
+	i = (i + 1) & samples_mask, ++j)
+     if (key == ptr)
+       return i;
+
+   return -1;
+}
+
+/**
+ * Remove a sample, and move back the samples after it that could not be found
+ * anymore, so no probe sequence goes over an empty slot. The caller must hold
+ * the lock.
+ *
+ * @param	hole	Slot of the sample to remove.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+static void
+ememoa_mempool_profile_remove (unsigned int hole)
+{
+   unsigned int	i;
+   unsigned int	home;
+
+   __atomic_store_n (&samples_generation, samples_generation + 1, __ATOMIC_RELEASE);
+
+   for (i = (hole + 1) & samples_mask; samples[i].ptr != NULL; i = (i + 1) & samples_mask)
+     {
+	home = ememoa_mempool_profile_hash (samples[i].ptr);
+
+	/* Samples whose home is after the hole stay where they are. */
+	if (hole <= i ? (hole < home && home <= i) : (hole < home || home <= i))
+	  continue;
+
+	samples[hole].weight = samples[i].weight;
+	samples[hole].depth = samples[i].depth;
+	memcpy (samples[hole].frames, samples[i].frames, sizeof (void*) * samples[i].depth);
+	__atomic_store_n (&samples[hole].ptr, samples[i].ptr, __ATOMIC_RELEASE);
+	hole = i;
+     }
+   __atomic_store_n (&samples[hole].ptr, NULL, __ATOMIC_RELEASE);
+
+   __atomic_store_n (&samples_generation, samples_generation + 1, __ATOMIC_RELEASE);
+   __atomic_store_n (&ememoa_mempool_profile_live, ememoa_mempool_profile_live - 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Remove the sample of an object given back, if it has one. The table is only
+ * locked when the object is found, or when a removal ran during the lookup.
+ *
+ * @param	ptr	The object given back.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+void
+ememoa_mempool_profile_forget (void	*ptr)
+{
+   unsigned int	generation;
+   int		i;
+
+   if (samples == NULL)
+     return ;
+
+   generation = __atomic_load_n (&samples_generation, __ATOMIC_ACQUIRE);
+   if (ememoa_mempool_profile_lookup (ptr) < 0
+       && !(generation & 1)
+       && generation == __atomic_load_n (&samples_generation, __ATOMIC_ACQUIRE))
+     return ;
+
+   PROFILE_LOCK();
+   i = ememoa_mempool_profile_lookup (ptr);
+   if (i >= 0)
+     ememoa_mempool_profile_remove (i);
+   PROFILE_UNLOCK();
+}
+
+/**
+ * Write one frame of a folded stack, the function name when it is known and the
+ * address otherwise.
+ *
+ * @param	out	Where to write.
+ * @param	symbol	String given by backtrace_symbols.
+ * @param	address	Address of the frame.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+static void
+ememoa_mempool_profile_dump_frame (FILE		*out,
+				   const char	*symbol,
+				   void		*address)
+{
+   const char	*start = symbol ? strchr (symbol, '(') : NULL;
+   size_t	length = 0;
+
+   if (start)
+     length = strcspn (++start, "+)");
+
+   if (length)
+     fprintf (out, "%.*s", (int) length, start);
+   else
+     fprintf (out, "%p", address);
+}
+
+/**
+ * Write all live samples in the folded stack format: the frames from the outermost
+ * to the allocation site separated by ';', then the number of bytes they stand for.
+ *
+ * @code
+ *   main;load_config;parse_value 524288
+ * @endcode
+ *
+ * @param	out	Where to write the profile.
+ * @return	Will return the number of samples written or @c -1 on failure.
+ * @ingroup	Ememoa_Mempool_Profile
+ */
+int
+ememoa_mempool_profile_dump (FILE	*out)
+{
+#ifdef HAVE_EXECINFO_H
+   struct ememoa_mempool_profile_sample_s	*sample;
+   char						**symbols;
+   unsigned int					i;
+   int						count = 0;
+   int						j;
+
+   if (out == NULL)
+     return -1;
+
+   PROFILE_LOCK();
+
+   if (samples)
+     for (i = 0; i <= samples_mask; ++i)
+       {
+	  sample = samples + i;
+	  if (sample->ptr == NULL)
+	    continue;
+
+	  symbols = backtrace_symbols (sample->frames, sample->depth);
+	  for (j = sample->depth - 1; j >= 0; --j)
+	    {
+	       ememoa_mempool_profile_dump_frame (out, symbols ? symbols[j] : NULL, sample->frames[j]);
+	       fputc (j ? ';' : ' ', out);
+	    }
+	  fprintf (out, "%lu\n", (unsigned long) sample->weight);
+	  free (symbols);
+
+	  count++;
+       }
+
+   if (samples_dropped)
+     fprintf (out, "[dropped] %lu\n", (unsigned long) samples_dropped * ememoa_mempool_profile_rate);
+
+   PROFILE_UNLOCK();
+
+   return count;
+#else
+   (void) out;
+   return -1;
+#endif
+}
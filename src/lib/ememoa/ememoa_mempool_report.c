@@ -0,0 +1,193 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide a JSON report of the memory used by all memory pool.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <strings.h>
+
+#include "config.h"
+
+#include "ememoa_mempool_report.h"
+#include "ememoa_mempool_struct.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+
+/**
+ * @defgroup Ememoa_Mempool_Report Footprint report of all memory pool.
+ *
+ */
+
+struct ememoa_mempool_report_ctx_s
+{
+   FILE                                 *out;
+   int                                  count;
+};
+
+/**
+ * Write a JSON string, or null.
+ *
+ * @param       out     Where to write.
+ * @param       str     The string, could be @c NULL.
+ * @ingroup     Ememoa_Mempool_Report
+ */
+static void
+ememoa_mempool_report_string (FILE *out, const char *str)
+{
+   if (str == NULL)
+     {
+        fputs ("null", out);
+        return ;
+     }
+
+   fputc ('"', out);
+   for (; *str; ++str)
+     if (*str == '"' || *str == '\\')
+       fprintf (out, "\\%c", *str);
+     else if ((unsigned char) *str < 0x20)
+       fprintf (out, "\\u%04x", (unsigned char) *str);
+     else
+       fputc (*str, out);
+   fputc ('"', out);
+}
+
+/**
+ * Write the counters shared by all kind of memory pool.
+ *
+ * @param       out             Where to write.
+ * @param       footprint       The counters.
+ * @ingroup     Ememoa_Mempool_Report
+ */
+static void
+ememoa_mempool_report_counters (FILE *out, const struct ememoa_mempool_footprint_s *footprint)
+{
+   fprintf (out,
+            "\"pools\": %u, \"objects\": %u, \"requested\": %llu, \"handed\": %llu, \"reserved\": %llu, \"free_in_partial\": %llu, \"wasted\": %llu }",
+            footprint->pools, footprint->objects,
+            footprint->requested, footprint->handed,
+            footprint->reserved, footprint->free_partial,
+            footprint->wasted);
+}
+
+/**
+ * Write the entry of one fixed memory pool.
+ *
+ * @param       ctx     The report.
+ * @param       index   Memory pool index.
+ * @param       data    Pointer to the memory pool slot.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Mempool_Report
+ */
+static int
+ememoa_mempool_report_fixed_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_report_ctx_s   *report = ctx;
+   struct ememoa_mempool_fixed_s        *memory = __atomic_load_n ((struct ememoa_mempool_fixed_s**) data, __ATOMIC_ACQUIRE);
+   struct ememoa_mempool_footprint_s    footprint;
+
+   if (memory == NULL)
+     return 0;
+
+   bzero (&footprint, sizeof (footprint));
+   ememoa_mempool_fixed_footprint (memory, &footprint);
+
+   fprintf (report->out, "%s\n    { \"index\": %i, \"name\": ", report->count++ ? "," : "", index);
+   ememoa_mempool_report_string (report->out, memory->desc ? memory->desc->name : NULL);
+   fprintf (report->out, ", \"object_size\": %u, ", memory->object_size);
+   ememoa_mempool_report_counters (report->out, &footprint);
+
+   return 0;
+}
+
+/**
+ * Write the entry of one unknown size memory pool.
+ *
+ * @param       ctx     The report.
+ * @param       index   Memory pool index.
+ * @param       data    Pointer to the memory pool.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Mempool_Report
+ */
+static int
+ememoa_mempool_report_unknown_size_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_report_ctx_s   *report = ctx;
+   struct ememoa_mempool_unknown_size_s *memory = data;
+   struct ememoa_mempool_footprint_s    footprint;
+   unsigned int                         i;
+
+   if (!memory->in_use)
+     return 0;
+
+   bzero (&footprint, sizeof (footprint));
+   ememoa_mempool_unknown_size_footprint (memory, &footprint);
+
+   fprintf (report->out, "%s\n    { \"index\": %i, \"name\": ", report->count++ ? "," : "", index);
+   ememoa_mempool_report_string (report->out, memory->desc ? memory->desc->name : NULL);
+   fputs (", \"fixed_pools\": [", report->out);
+   for (i = 0; i < memory->pools_count; ++i)
+     fprintf (report->out, "%s %i", i ? "," : "", memory->pools[i]);
+   fprintf (report->out, ", %i ], ", memory->allocated_list);
+   ememoa_mempool_report_counters (report->out, &footprint);
+
+   return 0;
+}
+
+/**
+ * Write a JSON report of the memory used by every fixed memory pool, every unknown
+ * size memory pool and the static buffer allocator. See ememoa_mempool_report.h
+ * for the format.
+ *
+ * @code
+ *   ememoa_report_footprint (stderr);
+ * @endcode
+ *
+ * @param	out	Where to write the report.
+ * @return	Will return @c 0 on success, @c -1 if out is @c NULL or a write failed.
+ * @ingroup	Ememoa_Mempool_Report
+ */
+int
+ememoa_report_footprint (FILE	*out)
+{
+   struct ememoa_mempool_report_ctx_s   report;
+   unsigned int                         page_size;
+   unsigned int                         pages;
+   unsigned int                         free_pages;
+   unsigned int                         largest_free;
+
+   if (out == NULL)
+     return -1;
+
+   report.out = out;
+
+   /* No memory pool could go away while the report look at it. */
+   ememoa_mempool_fixed_registry_lock ();
+
+   fputs ("{\n  \"fixed\": [", out);
+   report.count = 0;
+   if (fixed_pool_list)
+     ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_mempool_report_fixed_cb, &report);
+   fputs (report.count ? "\n  ],\n" : "],\n", out);
+
+   fputs ("  \"unknown_size\": [", out);
+   report.count = 0;
+   if (unknown_size_pool_list)
+     ememoa_memory_base_resize_list_walk_over (unknown_size_pool_list, 0, -1, ememoa_mempool_report_unknown_size_cb, &report);
+   fputs (report.count ? "\n  ],\n" : "],\n", out);
+
+   ememoa_mempool_fixed_registry_unlock ();
+
+   if (ememoa_memory_base_footprint_64m (&page_size, &pages, &free_pages, &largest_free) == 0)
+     fprintf (out,
+              "  \"heap_64m\": { \"page_size\": %u, \"pages\": %u, \"free_pages\": %u, \"largest_free_chunk\": %llu }\n",
+              page_size, pages, free_pages, (unsigned long long) largest_free * page_size);
+   else
+     fputs ("  \"heap_64m\": null\n", out);
+
+   fputs ("}\n", out);
+
+   return ferror (out) ? -1 : 0;
+}
@@ -9,17 +9,20 @@
 #include <strings.h>
 #include <assert.h>
 #include <stdio.h>
+#include <limits.h>
+
+#include "config.h"
 
 #ifdef HAVE_PTHREAD
 #include <pthread.h>
 
 #define	EMEMOA_LOCK(Memory) \
 	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
-		pthread_mutex_lock(&(Memory->lock));
+		ememoa_mempool_lock_take(&(Memory->lock));
 
 #define	EMEMOA_UNLOCK(Memory) \
 	if ((Memory->options & EMEMOA_THREAD_PROTECTION) == EMEMOA_THREAD_PROTECTION) \
-		pthread_mutex_unlock(&(Memory->lock));
+		ememoa_mempool_lock_release(&(Memory->lock));
 
 #else
 
@@ -33,6 +36,7 @@
 #include "ememoa_mempool_struct.h"
 #include "ememoa_memory_base.h"
 #include "mempool_struct.h"
+#include "ememoa_trace.h"
 
 #define	EMEMOA_MAGIC	0x4224008
 
@@ -52,11 +56,16 @@ struct ememoa_mempool_alloc_item_s
    struct ememoa_mempool_unknown_size_item_s	*data;
 
    unsigned int                                 size;
+   /* Length of the pages of a mapped object, 0 when it comes from the backend. */
+   size_t                                       mapping;
+   /* Length of the block given by the backend, header included. */
+   size_t                                       length;
 };
 
 struct ememoa_mempool_unknown_size_item_s
 {
    int					index;
+   unsigned int				size;
 #ifdef DEBUG
    unsigned int				magic;
 #endif
@@ -64,19 +73,139 @@ struct ememoa_mempool_unknown_size_item_s
    void*				data;
 };
 
+/* Aligned objects are preceded by a second header whose index encodes the alignment
+   and whose data points to the object really allocated. */
+#define EMEMOA_ALIGNED_INDEX(Pot)	(-2 - (int) (Pot))
+#define EMEMOA_ALIGNED_POT(Index)	(-2 - (Index))
+
 struct ememoa_memory_base_resize_list_s         *unknown_size_pool_list = NULL;
 
 static int					 collected = 0;
 
+/* Keep track of the bytes asked by the users, for ememoa_report_footprint. */
+static inline void
+ememoa_mempool_unknown_size_requested (struct ememoa_mempool_unknown_size_s *memory, long long delta)
+{
+   __atomic_add_fetch (&memory->requested, (unsigned long long) delta, __ATOMIC_RELAXED);
+}
+
+/* Give back the memory of a big object. */
+static void
+ememoa_mempool_unknown_size_release (struct ememoa_mempool_unknown_size_s	*memory,
+				     struct ememoa_mempool_alloc_item_s		*item)
+{
+   if (item->mapping)
+     ememoa_memory_base_unmap (item->data, item->mapping);
+   else
+     ememoa_mempool_backend_free (&memory->backend, item->data);
+}
+
+/**
+ * Take a cached big block for an object of size bytes, header included. Blocks are
+ * cached by the number of whole pages they hold, so any block of the bucket fits.
+ * The caller must hold the lock of the memory pool.
+ *
+ * @param	memory		The memory pool.
+ * @param	size		Size of the object with its header.
+ * @return	Will return @c NULL if no block of this size is cached.
+ * @ingroup	Ememoa_Mempool_Unknown_Size
+ */
+static struct ememoa_mempool_alloc_item_s*
+ememoa_mempool_unknown_size_cache_take (struct ememoa_mempool_unknown_size_s	*memory,
+					size_t					size)
+{
+   struct ememoa_mempool_alloc_item_s	*item;
+   size_t				pages = (size + (1 << EMEMOA_LARGE_CACHE_PAGE_POT) - 1) >> EMEMOA_LARGE_CACHE_PAGE_POT;
+
+   if (pages == 0 || pages > EMEMOA_LARGE_CACHE_PAGES)
+     return NULL;
+
+   item = memory->cache[pages - 1];
+   if (item == NULL)
+     return NULL;
+
+   memory->cache[pages - 1] = item->next;
+   memory->cache_count[pages - 1]--;
+   memory->cache_bytes -= item->length;
+
+   return item;
+}
+
+/**
+ * Keep a big block given back for the next pops of the same size. Mapped blocks are
+ * never cached. The caller must hold the lock of the memory pool.
+ *
+ * @param	memory		The memory pool.
+ * @param	item		The block, already out of the list of live objects.
+ * @return	Will return @c 1 if the block was kept.
+ * @ingroup	Ememoa_Mempool_Unknown_Size
+ */
+static int
+ememoa_mempool_unknown_size_cache_put (struct ememoa_mempool_unknown_size_s	*memory,
+				       struct ememoa_mempool_alloc_item_s	*item)
+{
+   size_t				pages = item->length >> EMEMOA_LARGE_CACHE_PAGE_POT;
+
+   if (item->mapping
+       || pages == 0 || pages > EMEMOA_LARGE_CACHE_PAGES
+       || memory->cache_count[pages - 1] >= EMEMOA_LARGE_CACHE_DEPTH
+       || memory->cache_bytes + item->length > EMEMOA_LARGE_CACHE_BYTES)
+     return 0;
+
+   item->prev = NULL;
+   item->next = memory->cache[pages - 1];
+   memory->cache[pages - 1] = item;
+   memory->cache_count[pages - 1]++;
+   memory->cache_bytes += item->length;
+
+   return 1;
+}
+
+/**
+ * Give back all the cached big blocks.
+ *
+ * @param	memory		The memory pool.
+ * @return	Will return the number of blocks given back.
+ * @ingroup	Ememoa_Mempool_Unknown_Size
+ */
+static int
+ememoa_mempool_unknown_size_cache_flush (struct ememoa_mempool_unknown_size_s	*memory)
+{
+   struct ememoa_mempool_alloc_item_s	*cache[EMEMOA_LARGE_CACHE_PAGES];
+   struct ememoa_mempool_alloc_item_s	*item;
+   unsigned int				i;
+   int					count = 0;
+
+   EMEMOA_LOCK(memory);
+
+   memcpy (cache, memory->cache, sizeof (cache));
+   bzero (memory->cache, sizeof (memory->cache));
+   bzero (memory->cache_count, sizeof (memory->cache_count));
+   memory->cache_bytes = 0;
+
+   EMEMOA_UNLOCK(memory);
+
+   for (i = 0; i < EMEMOA_LARGE_CACHE_PAGES; ++i)
+     while ((item = cache[i]) != NULL)
+       {
+	  cache[i] = item->next;
+	  ememoa_mempool_unknown_size_release (memory, item);
+	  ememoa_mempool_fixed_push_object (memory->allocated_list, item);
+	  count++;
+       }
+
+   return count;
+}
+
 static unsigned int
 new_ememoa_unknown_pool ()
 {
-   if (!unknown_size_pool_list)
-     unknown_size_pool_list = ememoa_memory_base_resize_list_new (sizeof (struct ememoa_mempool_unknown_size_s));
+   struct ememoa_memory_base_resize_list_s      *list;
 
-   assert (unknown_size_pool_list != NULL);
+   list = ememoa_memory_base_resize_list_shared (&unknown_size_pool_list, sizeof (struct ememoa_mempool_unknown_size_s));
+   assert (list != NULL);
 
-   return ememoa_memory_base_resize_list_new_item (unknown_size_pool_list);
+   return ememoa_memory_base_resize_list_new_item (list);
 }
 
 struct ememoa_mempool_unknown_size_s*
@@ -151,6 +280,10 @@ ememoa_mempool_unknown_size_init (unsigned int				map_items_count,
    memory->magic = EMEMOA_MAGIC;
 #endif
 
+   /* The fixed memory pools only share the backend of this pool. */
+   ememoa_mempool_backend_init (&memory->backend, desc);
+   memory->pools_desc.backend = &memory->backend;
+
    memory->pools_count = map_items_count;
    memory->pools_match = ememoa_memory_base_alloc (sizeof (unsigned int) * map_items_count);
    memory->pools = ememoa_memory_base_alloc (sizeof (unsigned int) * map_items_count);
@@ -171,7 +304,7 @@ ememoa_mempool_unknown_size_init (unsigned int				map_items_count,
 	memory->pools[i] = ememoa_mempool_fixed_init (map_size_count[(i << 1) + 0] + sizeof (struct ememoa_mempool_unknown_size_item_s),
 						      map_size_count[(i << 1) + 1],
 						      options,
-						      NULL);
+						      &memory->pools_desc);
 
         if (memory->pools[i] < 0)
           {
@@ -188,7 +321,7 @@ ememoa_mempool_unknown_size_init (unsigned int				map_items_count,
    memory->allocated_list = ememoa_mempool_fixed_init (sizeof (struct ememoa_mempool_alloc_item_s),
 						       7,
 						       options,
-						       NULL);
+						       &memory->pools_desc);
 
    if (memory->allocated_list < 0)
      {
@@ -211,7 +344,7 @@ ememoa_mempool_unknown_size_init (unsigned int				map_items_count,
    memory->in_use = 1;
 
 #ifdef HAVE_PTHREAD
-   pthread_mutex_init (&(memory->lock), NULL);
+   ememoa_mempool_lock_init (&(memory->lock), options);
 #endif
 
    return index;
@@ -243,6 +376,7 @@ int
 ememoa_mempool_unknown_size_clean (unsigned int		mempool)
 {
    struct ememoa_mempool_unknown_size_s	*memory = ememoa_mempool_unknown_size_get_index (mempool);
+   struct ememoa_mempool_alloc_item_s	*item;
    unsigned int                         i;
 
    if (memory == NULL)
@@ -253,10 +387,15 @@ ememoa_mempool_unknown_size_clean (unsigned int		mempool)
    for (i = 0; i < memory->pools_count; ++i)
      ememoa_mempool_fixed_clean (memory->pools[i]);
 
+   ememoa_mempool_unknown_size_cache_flush (memory);
+
 #ifdef HAVE_PTHREAD
-   pthread_mutex_destroy (&(memory->lock));
+   ememoa_mempool_lock_destroy (&(memory->lock));
 #endif
 
+   for (item = memory->start; item != NULL; item = item->next)
+     ememoa_mempool_unknown_size_release (memory, item);
+
    ememoa_mempool_fixed_clean(memory->allocated_list);
    ememoa_memory_base_free (memory->pools_match);
    ememoa_memory_base_free (memory->pools);
@@ -282,6 +421,7 @@ int
 ememoa_mempool_unknown_size_free_all_objects (unsigned int	mempool)
 {
    struct ememoa_mempool_unknown_size_s	*memory = ememoa_mempool_unknown_size_get_index(mempool);
+   struct ememoa_mempool_alloc_item_s	*item;
    unsigned int				i;
 
    if (memory == NULL)
@@ -296,8 +436,13 @@ ememoa_mempool_unknown_size_free_all_objects (unsigned int	mempool)
 	  return -1;
        }
 
+   ememoa_mempool_unknown_size_cache_flush (memory);
+
    EMEMOA_LOCK(memory);
 
+   for (item = memory->start; item != NULL; item = item->next)
+     ememoa_mempool_unknown_size_release (memory, item);
+
    if (ememoa_mempool_fixed_free_all_objects (memory->allocated_list))
      {
 	memory->last_error_code = ememoa_mempool_fixed_get_last_error (memory->allocated_list);
@@ -306,6 +451,7 @@ ememoa_mempool_unknown_size_free_all_objects (unsigned int	mempool)
      }
 
    memory->start = NULL;
+   __atomic_store_n (&memory->requested, 0, __ATOMIC_RELAXED);
 
    EMEMOA_UNLOCK(memory);
    return 0;
@@ -350,6 +496,13 @@ ememoa_mempool_unknown_size_push_object (unsigned int	mempool,
 
    collected = 1;
 
+   if (old->index <= EMEMOA_ALIGNED_INDEX(0))
+     return ememoa_mempool_unknown_size_push_object (mempool, old->data);
+
+   EMEMOA_TRACE2(unknown_push, mempool, ptr);
+   ememoa_mempool_profile_push (ptr);
+   ememoa_mempool_unknown_size_requested (memory, - (long long) old->size);
+
    if (old->index == -1)
      {
 	struct ememoa_mempool_alloc_item_s	*item;
@@ -367,12 +520,17 @@ ememoa_mempool_unknown_size_push_object (unsigned int	mempool,
 	if (memory->start == item)
 	  memory->start = item->next;
 
+	if (ememoa_mempool_unknown_size_cache_put (memory, item))
+	  {
+	     EMEMOA_UNLOCK(memory);
+	     return 0;
+	  }
+
 	EMEMOA_UNLOCK(memory);
 
-	ememoa_memory_base_free (old);
+	ememoa_mempool_unknown_size_release (memory, item);
 
 	return ememoa_mempool_fixed_push_object (memory->allocated_list, item);
-	return -1;
      }
    else
      return ememoa_mempool_fixed_push_object(memory->pools[old->index], old);
@@ -398,21 +556,68 @@ ememoa_mempool_unknown_size_resize_object (unsigned int mempool,
 
    EMEMOA_CHECK_MAGIC(old);
 
+   if (old->index <= EMEMOA_ALIGNED_INDEX(0))
+     {
+        struct ememoa_mempool_unknown_size_item_s       *real = (struct ememoa_mempool_unknown_size_item_s*) old->data - 1;
+
+        /* Keep the object where it is if it still fit. */
+        if (real->index >= 0)
+          copy = memory->pools_match[real->index];
+        else
+          copy = real->item->size;
+        copy -= (uint8_t*) ptr - (uint8_t*) old->data;
+        if (copy >= size)
+          {
+             ememoa_mempool_unknown_size_requested (memory, (long long) size - real->size);
+             real->size = size;
+             return ptr;
+          }
+
+        new = ememoa_mempool_unknown_size_pop_object_aligned (mempool, size, 1 << EMEMOA_ALIGNED_POT(old->index));
+        if (!new)
+          return NULL;
+
+        memcpy (new, ptr, copy);
+        ememoa_mempool_unknown_size_push_object (mempool, ptr);
+
+        return new;
+     }
+
    EMEMOA_LOCK(memory);
 
    if (old->index == -1)
      {
         struct ememoa_mempool_alloc_item_s              *item;
-        struct ememoa_mempool_unknown_size_item_s       *tmp;
+        struct ememoa_mempool_unknown_size_item_s       *tmp = NULL;
+        unsigned int                                    old_size = old->size;
+        size_t                                          total = size + sizeof (struct ememoa_mempool_unknown_size_item_s);
 
         item = old->item;
 
-        tmp = ememoa_memory_base_realloc (old, size + sizeof (struct ememoa_mempool_unknown_size_item_s));
+        if (item->mapping)
+          {
+             size_t     length = ememoa_memory_base_map_length (total);
+
+             /* The pages move without being copied. */
+             tmp = length <= item->mapping ? old : ememoa_memory_base_remap (old, item->mapping, length);
+             if (tmp && length > item->mapping)
+               item->mapping = length;
+          }
+        /* Past the mmap threshold an object moves once to its own pages. */
+        else if (memory->backend.alloc != NULL || !ememoa_memory_base_mappable (total))
+          {
+             tmp = total <= item->length ? old : ememoa_mempool_backend_realloc (&memory->backend, old, total);
+             if (tmp && total > item->length)
+               item->length = total;
+          }
 
         if (tmp)
           {
              item->size = size;
+             item->data = tmp;
+             tmp->size = size;
              tmp->data = tmp + 1;
+             ememoa_mempool_unknown_size_requested (memory, (long long) size - old_size);
 
 	     EMEMOA_UNLOCK(memory);
 
@@ -425,6 +630,8 @@ ememoa_mempool_unknown_size_resize_object (unsigned int mempool,
      {
         if (memory->pools_match[old->index] >= size)
 	  {
+	     ememoa_mempool_unknown_size_requested (memory, (long long) size - old->size);
+	     old->size = size;
 	     EMEMOA_UNLOCK(memory);
 	     return ptr;
 	  }
@@ -480,6 +687,13 @@ ememoa_mempool_unknown_size_pop_object (unsigned int	mempool,
 
    EMEMOA_CHECK_MAGIC(memory);
 
+   /* The header must not wrap the size around to a tiny object. */
+   if (size > UINT_MAX - sizeof (struct ememoa_mempool_unknown_size_item_s))
+     {
+        memory->last_error_code = EMEMOA_NO_MORE_MEMORY;
+        return NULL;
+     }
+
    /* Don't forget to count ememoa_mempool_unknown_size_item_s size in size. */
    size += sizeof (struct ememoa_mempool_unknown_size_item_s);
 
@@ -505,25 +719,45 @@ ememoa_mempool_unknown_size_pop_object (unsigned int	mempool,
      {
 	struct ememoa_mempool_alloc_item_s	*item;
 
-	if ((item = ememoa_mempool_fixed_pop_object (memory->allocated_list)) == NULL)
+	EMEMOA_LOCK(memory);
+	item = ememoa_mempool_unknown_size_cache_take (memory, size);
+	EMEMOA_UNLOCK(memory);
+
+	if (item)
+	  new = item->data;
+	else
 	  {
-	     memory->last_error_code = ememoa_mempool_fixed_get_last_error (memory->allocated_list);
-	     return NULL;
+	     if ((item = ememoa_mempool_fixed_pop_object (memory->allocated_list)) == NULL)
+	       {
+		  memory->last_error_code = ememoa_mempool_fixed_get_last_error (memory->allocated_list);
+		  return NULL;
+	       }
+
+	     item->mapping = 0;
+	     item->length = size;
+	     /* Whole pages, so the block could be cached for any object of as many pages. */
+	     if ((size >> EMEMOA_LARGE_CACHE_PAGE_POT) < EMEMOA_LARGE_CACHE_PAGES)
+	       item->length = (size + (1 << EMEMOA_LARGE_CACHE_PAGE_POT) - 1) & ~(size_t) ((1 << EMEMOA_LARGE_CACHE_PAGE_POT) - 1);
+
+	     if (memory->backend.alloc == NULL && ememoa_memory_base_mappable (size))
+	       {
+		  item->mapping = ememoa_memory_base_map_length (size);
+		  new = ememoa_memory_base_map (item->mapping);
+	       }
+	     else
+	       new = ememoa_mempool_backend_alloc (&memory->backend, item->length);
+	     if (!new)
+	       {
+		  ememoa_mempool_fixed_push_object(memory->allocated_list, item);
+		  return NULL;
+	       }
 	  }
 
-	new = ememoa_memory_base_alloc (size);
-        if (!new)
-          {
-             ememoa_mempool_fixed_push_object(memory->allocated_list, item);
-             return NULL;
-          }
-
 	EMEMOA_LOCK(memory);
 
 	item->prev = NULL;
 	item->next = memory->start;
 
-        /* size need to be a multiple of 4K for the allocator. */
         item->size = size - sizeof (struct ememoa_mempool_unknown_size_item_s);
 	item->data = new;
 
@@ -542,10 +776,81 @@ ememoa_mempool_unknown_size_pop_object (unsigned int	mempool,
    new->magic = EMEMOA_MAGIC;
 #endif
    new->data = new + 1;
+   new->size = size - sizeof (struct ememoa_mempool_unknown_size_item_s);
+   ememoa_mempool_unknown_size_requested (memory, new->size);
+
+   EMEMOA_TRACE3(unknown_pop, mempool, size - sizeof (struct ememoa_mempool_unknown_size_item_s), new->data);
+   ememoa_mempool_profile_pop (new->data, size - sizeof (struct ememoa_mempool_unknown_size_item_s));
 
    return new->data;
 }
 
+/**
+ * Pops a new object aligned on align bytes out of the memory pool. The object is taken
+ * a little bigger than size from the usual pools, so only the alignment slack is lost.
+ * It is given back with ememoa_mempool_unknown_size_push_object and can be resized
+ * with ememoa_mempool_unknown_size_resize_object, it keeps its alignment.
+ *
+ * @code
+ *   struct queue_s *queue = ememoa_mempool_unknown_size_pop_object_aligned (mempool, sizeof (struct queue_s), 64);
+ * @endcode
+ *
+ * @param	mempool			Index of a valid memory pool.
+ * @param	size			Size of the object.
+ * @param	align			Alignment of the object, must be a power of two.
+ * @return	Will return @c NULL if it was impossible to allocate any data.
+ * @ingroup	Ememoa_Mempool_Unknown_Size
+ */
+void*
+ememoa_mempool_unknown_size_pop_object_aligned (unsigned int	mempool,
+						unsigned int	size,
+						unsigned int	align)
+{
+   struct ememoa_mempool_unknown_size_item_s	*shadow;
+   struct ememoa_mempool_unknown_size_item_s	*real;
+   uint8_t					*ptr;
+   uintptr_t					aligned;
+
+   assert ((align & (align - 1)) == 0);
+
+   /* Normal objects are already aligned on a pointer size. */
+   if (align <= sizeof (void*))
+     return ememoa_mempool_unknown_size_pop_object (mempool, size);
+
+   /* Same check as ememoa_mempool_unknown_size_pop_object, with the alignment slack. */
+   if (size > UINT_MAX - align - sizeof (struct ememoa_mempool_unknown_size_item_s))
+     {
+        struct ememoa_mempool_unknown_size_s	*memory = ememoa_mempool_unknown_size_get_index (mempool);
+
+        if (memory != NULL)
+          memory->last_error_code = EMEMOA_NO_MORE_MEMORY;
+        return NULL;
+     }
+
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, size + align - sizeof (void*) + sizeof (struct ememoa_mempool_unknown_size_item_s));
+   if (!ptr)
+     return NULL;
+
+   /* Only the size asked by the user is accounted, not the alignment slack. */
+   real = (struct ememoa_mempool_unknown_size_item_s*) ptr - 1;
+   ememoa_mempool_unknown_size_requested (ememoa_mempool_unknown_size_get_index (mempool), (long long) size - real->size);
+   real->size = size;
+
+   /* Leave room for the shadow header before the aligned address. */
+   aligned = ((uintptr_t) ptr + sizeof (struct ememoa_mempool_unknown_size_item_s) + align - 1) & ~((uintptr_t) align - 1);
+   shadow = (struct ememoa_mempool_unknown_size_item_s*) aligned - 1;
+
+   shadow->index = EMEMOA_ALIGNED_INDEX(__builtin_ctz (align));
+#ifdef DEBUG
+   shadow->magic = EMEMOA_MAGIC;
+#endif
+   shadow->size = size;
+   shadow->item = NULL;
+   shadow->data = ptr;
+
+   return (void*) aligned;
+}
+
 /**
  * Collects all the empty pool and resize the Mempool accordingly.
  *
@@ -573,6 +878,7 @@ ememoa_mempool_unknown_size_garbage_collect (unsigned int mempool)
    for (i = 0; i < memory->pools_count; ++i)
      count += ememoa_mempool_fixed_garbage_collect (memory->pools[i]);
 
+   count += ememoa_mempool_unknown_size_cache_flush (memory);
    count += ememoa_mempool_fixed_garbage_collect (memory->allocated_list);
 
    collected = 0;
@@ -615,6 +921,93 @@ ememoa_mempool_unknown_size_walk_over    (unsigned    int   mempool,
    return 0;
 }
 
+/**
+ * Gives the contention statistics of the lock of a thread protected memory pool.
+ * The locks of the fixed memory pools it uses are not included.
+ *
+ * @param	mempool		Index of a valid memory pool.
+ * @param	stat		Where to store the statistics.
+ * @return	Will return @c 0 on success.
+ * @ingroup	Ememoa_Mempool_Unknown_Size
+ */
+int
+ememoa_mempool_unknown_size_lock_stat (unsigned int			mempool,
+				       struct ememoa_mempool_lock_stat_s	*stat)
+{
+   struct ememoa_mempool_unknown_size_s *memory = ememoa_mempool_unknown_size_get_index (mempool);
+
+   if (memory == NULL)
+     return -1;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   ememoa_mempool_lock_stat (&(memory->lock), stat);
+   return 0;
+}
+
+/**
+ * Add the memory used by a memory pool and its fixed memory pools to footprint. Objects
+ * too big for the fixed memory pools are reserved exactly for their size.
+ *
+ * @param	memory		Pointer to a valid memory pool.
+ * @param	footprint	Where to add the counters.
+ * @ingroup	Ememoa_Display_Mempool
+ */
+void
+ememoa_mempool_unknown_size_footprint (struct ememoa_mempool_unknown_size_s	*memory,
+				       struct ememoa_mempool_footprint_s	*footprint)
+{
+   struct ememoa_mempool_fixed_s        *fixed;
+   struct ememoa_mempool_alloc_item_s   *item;
+   unsigned long long                   requested = footprint->requested;
+   unsigned int                         i;
+
+   EMEMOA_CHECK_MAGIC(memory);
+
+   for (i = 0; i < memory->pools_count; ++i)
+     if ((fixed = ememoa_mempool_fixed_get_index (memory->pools[i])) != NULL)
+       ememoa_mempool_fixed_footprint (fixed, footprint);
+
+   /* One item of allocated_list per big object, live or cached. The cached ones are
+      taken out below. */
+   if ((fixed = ememoa_mempool_fixed_get_index (memory->allocated_list)) != NULL)
+     ememoa_mempool_fixed_footprint (fixed, footprint);
+
+   EMEMOA_LOCK(memory);
+
+   for (item = memory->start; item != NULL; item = item->next)
+     {
+        size_t  size = item->size + sizeof (struct ememoa_mempool_unknown_size_item_s);
+        size_t  granularity = ememoa_mempool_backend_granularity (&memory->backend, size);
+        size_t  overhead = ememoa_mempool_backend_overhead (&memory->backend, size);
+
+        footprint->handed += size;
+        footprint->reserved += size;
+        if (item->mapping)
+          footprint->wasted += item->mapping - size;
+        else
+          footprint->wasted += ((item->length + overhead + granularity - 1) & ~(granularity - 1)) - overhead - size;
+     }
+
+   /* Cached blocks are free memory kept by the memory pool, not live objects. */
+   for (i = 0; i < EMEMOA_LARGE_CACHE_PAGES; ++i)
+     for (item = memory->cache[i]; item != NULL; item = item->next)
+       {
+          footprint->reserved += item->length;
+          footprint->free_partial += item->length;
+          footprint->objects--;
+          if (fixed != NULL)
+            {
+               footprint->handed -= fixed->object_size;
+               footprint->free_partial += fixed->object_size;
+            }
+       }
+
+   EMEMOA_UNLOCK(memory);
+
+   footprint->requested = requested + __atomic_load_n (&memory->requested, __ATOMIC_RELAXED);
+}
+
 /**
  * Displays all the statistics currently known about a Mempool, useful to dimension it.
  *
@@ -0,0 +1,402 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+** This file provide persistent memory pool, kept in a file mapped at a fixed address.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "ememoa_snapshot.h"
+#include "ememoa_memory_base.h"
+#include "mempool_struct.h"
+
+/* Set in the header of a persistent static buffer. */
+#define EMEMOA_PERSISTENT_MAGIC	0x5AED65
+
+/**
+ * @defgroup Ememoa_Snapshot Persistent memory pool.
+ *
+ */
+
+/**
+ * Tell if an object lies inside the persistent buffer.
+ *
+ * @param       heap    The persistent buffer.
+ * @param       ptr     The object.
+ * @param       size    Its size.
+ * @return      Will return @c 1 if the whole object is in the buffer.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_inside (const struct ememoa_memory_base_s *heap, const void *ptr, size_t size)
+{
+   return (const uint8_t*) ptr >= (const uint8_t*) heap
+     && (const uint8_t*) ptr + size <= (const uint8_t*) heap + heap->size;
+}
+
+/**
+ * Give back the description of a memory pool left by a previous process if it is
+ * still valid. Only a description living in the buffer and pointing at nothing
+ * outside of it is, the code and static data of the previous process are gone.
+ *
+ * @param       heap    The persistent buffer.
+ * @param       desc    The description kept by the memory pool.
+ * @return      Will return desc, or @c NULL if it is not valid anymore.
+ * @ingroup     Ememoa_Snapshot
+ */
+static const struct ememoa_mempool_desc_s*
+ememoa_snapshot_desc (const struct ememoa_memory_base_s *heap, const struct ememoa_mempool_desc_s *desc)
+{
+   if (desc == NULL
+       || !ememoa_snapshot_inside (heap, desc, sizeof (*desc))
+       || desc->name || desc->data_display || desc->relocate
+       || (desc->backend && !ememoa_snapshot_inside (heap, desc->backend, sizeof (*desc->backend))))
+     return NULL;
+   return desc;
+}
+
+/**
+ * Callback checking that a fixed memory pool could be restored. Its memory must
+ * come from the persistent buffer, a backend is a set of function pointers into
+ * the previous process.
+ *
+ * @param       ctx     Useless in this context.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the memory pool slot.
+ * @return      Will return @c 1 if the memory pool could not be restored.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_fixed_check_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_fixed_s        *memory = *(struct ememoa_mempool_fixed_s**) data;
+
+   (void) ctx; (void) index;
+
+   return memory && memory->backend.alloc != NULL;
+}
+
+/**
+ * Same as ememoa_snapshot_fixed_check_cb for an unknown size memory pool.
+ *
+ * @param       ctx     Useless in this context.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the memory pool.
+ * @return      Will return @c 1 if the memory pool could not be restored.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_unknown_size_check_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_unknown_size_s *memory = data;
+
+   (void) ctx; (void) index;
+
+   return memory->in_use && memory->backend.alloc != NULL;
+}
+
+/**
+ * Same as ememoa_snapshot_fixed_check_cb for an arena.
+ *
+ * @param       ctx     Useless in this context.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the arena.
+ * @return      Will return @c 1 if the arena could not be restored.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_arena_check_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_arena_s        *memory = data;
+
+   (void) ctx; (void) index;
+
+   return memory->backend.alloc != NULL;
+}
+
+/**
+ * Callback giving a fresh lock to a fixed memory pool and dropping its description
+ * if it belonged to the previous process.
+ *
+ * @param       ctx     The persistent buffer.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the memory pool slot.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_fixed_restore_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_fixed_s        *memory = *(struct ememoa_mempool_fixed_s**) data;
+
+   (void) index;
+
+   if (memory)
+     {
+        memory->desc = ememoa_snapshot_desc (ctx, memory->desc);
+#ifdef HAVE_PTHREAD
+        ememoa_mempool_lock_init (&(memory->lock), memory->options);
+#endif
+     }
+   return 0;
+}
+
+/**
+ * Same as ememoa_snapshot_fixed_restore_cb for an unknown size memory pool.
+ *
+ * @param       ctx     The persistent buffer.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the memory pool.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_unknown_size_restore_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_unknown_size_s *memory = data;
+
+   (void) index;
+
+   if (memory->in_use)
+     {
+        memory->desc = ememoa_snapshot_desc (ctx, memory->desc);
+#ifdef HAVE_PTHREAD
+        ememoa_mempool_lock_init (&(memory->lock), memory->options);
+#endif
+     }
+   return 0;
+}
+
+/**
+ * Same as ememoa_snapshot_fixed_restore_cb for an arena.
+ *
+ * @param       ctx     The persistent buffer.
+ * @param       index   Useless in this context.
+ * @param       data    Pointer to the arena.
+ * @return      Will return @c 0.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_arena_restore_cb (void *ctx, int index, void *data)
+{
+   struct ememoa_mempool_arena_s        *memory = data;
+
+   (void) index;
+
+   memory->desc = ememoa_snapshot_desc (ctx, memory->desc);
+#ifdef HAVE_PTHREAD
+   ememoa_mempool_lock_init (&(memory->lock), memory->options);
+#endif
+   return 0;
+}
+
+/**
+ * Find back all memory pool of a persistent buffer left by a previous process.
+ * Locks are created again, whatever state the previous process left them in, and
+ * descriptions outside of the buffer are dropped. Nothing is changed if a memory
+ * pool took its memory from a backend, the buffer is then refused.
+ *
+ * @param       heap    The persistent buffer, mapped at its address.
+ * @return      Will return @c 0 on success, @c -1 if a memory pool use a backend.
+ * @ingroup     Ememoa_Snapshot
+ */
+static int
+ememoa_snapshot_restore (struct ememoa_memory_base_s *heap)
+{
+   struct ememoa_memory_base_resize_list_s      *fixed = heap->roots[EMEMOA_ROOT_FIXED];
+   struct ememoa_memory_base_resize_list_s      *unknown_size = heap->roots[EMEMOA_ROOT_UNKNOWN_SIZE];
+   struct ememoa_memory_base_resize_list_s      *arena = heap->roots[EMEMOA_ROOT_ARENA];
+
+   if ((fixed && ememoa_memory_base_resize_list_walk_over (fixed, 0, -1, ememoa_snapshot_fixed_check_cb, NULL))
+       || (unknown_size && ememoa_memory_base_resize_list_walk_over (unknown_size, 0, -1, ememoa_snapshot_unknown_size_check_cb, NULL))
+       || (arena && ememoa_memory_base_resize_list_walk_over (arena, 0, -1, ememoa_snapshot_arena_check_cb, NULL)))
+     return -1;
+
+#ifdef HAVE_PTHREAD
+   pthread_mutex_init (&(heap->lock), NULL);
+#endif
+   ememoa_memory_base_use_64m (heap);
+   ememoa_memory_base_resize_list_restore (heap->roots[EMEMOA_ROOT_RESIZE_LIST_POOLS]);
+
+   fixed_pool_list = fixed;
+   unknown_size_pool_list = unknown_size;
+   arena_pool_list = arena;
+
+   if (fixed_pool_list)
+     ememoa_memory_base_resize_list_walk_over (fixed_pool_list, 0, -1, ememoa_snapshot_fixed_restore_cb, heap);
+   if (unknown_size_pool_list)
+     ememoa_memory_base_resize_list_walk_over (unknown_size_pool_list, 0, -1, ememoa_snapshot_unknown_size_restore_cb, heap);
+   if (arena_pool_list)
+     ememoa_memory_base_resize_list_walk_over (arena_pool_list, 0, -1, ememoa_snapshot_arena_restore_cb, heap);
+
+   return 0;
+}
+
+/**
+ * Map a file as the static buffer of ememoa. If the file already hold a persistent
+ * buffer, it is mapped at the address it had and all memory pool and objects it holds
+ * are given back, address and size are then ignored. Otherwise the file is resized to
+ * size bytes and a new static buffer is created in it. Like ememoa_memory_base_init_64m,
+ * it must be called before any other ememoa operation.
+ *
+ * Nothing is copied: objects are used in place from the file and pointers to them
+ * stay valid across restarts. Pointers to the code or static data of the previous
+ * process are not: memory pool descriptions are dropped unless they live in the file,
+ * and a file holding a memory pool with a backend is refused.
+ *
+ * @param	path		The file, created if it doesn't exist.
+ * @param	address		Where to map a new file, @c NULL let the system choose.
+ * @param	size		Size of a new file.
+ * @return	Will return the address of the mapping, or @c NULL if the file could not
+ *		be mapped at its address or ememoa was already in use.
+ * @ingroup	Ememoa_Snapshot
+ */
+void*
+ememoa_attach (const char	*path,
+	       void		*address,
+	       unsigned int	size)
+{
+   struct ememoa_memory_base_s  header;
+   struct ememoa_memory_base_s  *heap;
+   struct stat                  st;
+   void                         *buffer;
+   int                          flags = MAP_SHARED;
+   int                          existing = 0;
+   int                          fd;
+
+   if (ememoa_memory_base_current_64m () || fixed_pool_list || unknown_size_pool_list || arena_pool_list)
+     return NULL;
+
+   fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+   if (fd < 0)
+     return NULL;
+
+   if (fstat (fd, &st))
+     goto on_error;
+
+   if (st.st_size >= (off_t) sizeof (header)
+       && pread (fd, &header, sizeof (header), 0) == sizeof (header)
+       && header.persistent == EMEMOA_PERSISTENT_MAGIC)
+     {
+        if (header.header_size != sizeof (header) || header.size != st.st_size)
+          goto on_error;
+
+        address = header.address;
+        size = header.size;
+        existing = 1;
+     }
+   else if (ftruncate (fd, size))
+     goto on_error;
+
+#ifdef MAP_FIXED_NOREPLACE
+   if (address)
+     flags |= MAP_FIXED_NOREPLACE;
+#endif
+
+   buffer = mmap (address, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+   if (buffer == MAP_FAILED)
+     goto on_error;
+   close (fd);
+
+   /* Every pointer inside the file is only right at this address. */
+   if (address && buffer != address)
+     goto on_unmap;
+
+   heap = buffer;
+   if (existing)
+     {
+        if (ememoa_snapshot_restore (heap))
+          goto on_unmap;
+     }
+   else
+     {
+        if (ememoa_memory_base_setup_64m (buffer, size, 12, 0))
+          goto on_unmap;
+
+        heap->address = buffer;
+        heap->header_size = sizeof (struct ememoa_memory_base_s);
+        heap->persistent = EMEMOA_PERSISTENT_MAGIC;
+     }
+
+   return buffer;
+
+ on_unmap:
+   munmap (buffer, size);
+   return NULL;
+
+ on_error:
+   close (fd);
+   return NULL;
+}
+
+/**
+ * Save what a restarted process need to find back all memory pool and write the
+ * whole persistent buffer to its file. It must be called while no other thread use
+ * ememoa, and the file is only consistent if nothing change after the last call,
+ * usually right before a clean exit.
+ *
+ * @return	Will return @c 0 on success, @c -1 if no persistent buffer is in use
+ *		or the file could not be written.
+ * @ingroup	Ememoa_Snapshot
+ */
+int
+ememoa_snapshot_sync (void)
+{
+   struct ememoa_memory_base_s  *heap = ememoa_memory_base_current_64m ();
+
+   if (heap == NULL || heap->persistent != EMEMOA_PERSISTENT_MAGIC)
+     return -1;
+
+   heap->roots[EMEMOA_ROOT_RESIZE_LIST_POOLS] = ememoa_memory_base_resize_list_pools ();
+   heap->roots[EMEMOA_ROOT_FIXED] = fixed_pool_list;
+   heap->roots[EMEMOA_ROOT_UNKNOWN_SIZE] = unknown_size_pool_list;
+   heap->roots[EMEMOA_ROOT_ARENA] = arena_pool_list;
+
+   return msync (heap, heap->size, MS_SYNC) ? -1 : 0;
+}
+
+/**
+ * Keep a pointer in the persistent buffer, it is given back by
+ * ememoa_snapshot_root_get after a restart.
+ *
+ * @param	root	Usually the root of the application data, allocated from a
+ *			memory pool.
+ * @ingroup	Ememoa_Snapshot
+ */
+void
+ememoa_snapshot_root_set (void	*root)
+{
+   struct ememoa_memory_base_s  *heap = ememoa_memory_base_current_64m ();
+
+   if (heap && heap->persistent == EMEMOA_PERSISTENT_MAGIC)
+     heap->roots[EMEMOA_ROOT_USER] = root;
+}
+
+/**
+ * Give the pointer kept by ememoa_snapshot_root_set.
+ *
+ * @return	Will return @c NULL if no persistent buffer is in use or no root was set.
+ * @ingroup	Ememoa_Snapshot
+ */
+void*
+ememoa_snapshot_root_get (void)
+{
+   struct ememoa_memory_base_s  *heap = ememoa_memory_base_current_64m ();
+
+   if (heap == NULL || heap->persistent != EMEMOA_PERSISTENT_MAGIC)
+     return NULL;
+   return heap->roots[EMEMOA_ROOT_USER];
+}
@@ -0,0 +1,37 @@
+/*
+** Copyright Cedric BAIL, 2006
+** contact: cedric.bail@free.fr
+**
+*/
+
+#ifndef		EMEMOA_TRACE_H__
+# define	EMEMOA_TRACE_H__
+
+/*
+ * Static tracepoints of the "ememoa" provider, for perf, bpftrace or systemtap.
+ * They are only compiled in with --enable-usdt, and then only cost a nop until
+ * a tracer attach to them.
+ *
+ *   bpftrace -e 'usdt:libememoa.so:ememoa:fixed_pool_add { @[arg0] = count(); }'
+ *
+ * fixed_pop and fixed_push trace the objects leaving and coming back to the pools.
+ * The cache of the ememoa_fixed_t handle API is not traced: an object pushed in it
+ * is only seen by fixed_push once flushed, and an object popped from it was never
+ * seen going back, so the two probes stay balanced.
+ */
+
+#include	"config.h"
+
+#ifdef EMEMOA_USDT
+# include	<sys/sdt.h>
+
+# define EMEMOA_TRACE1(Name, A)				DTRACE_PROBE1(ememoa, Name, A)
+# define EMEMOA_TRACE2(Name, A, B)			DTRACE_PROBE2(ememoa, Name, A, B)
+# define EMEMOA_TRACE3(Name, A, B, C)			DTRACE_PROBE3(ememoa, Name, A, B, C)
+#else
+# define EMEMOA_TRACE1(Name, A)				;
+# define EMEMOA_TRACE2(Name, A, B)			;
+# define EMEMOA_TRACE3(Name, A, B, C)			;
+#endif
+
+#endif		/* EMEMOA_TRACE_H__ */
@@ -10,6 +10,8 @@
 #include	"config.h"
 
 #include	<stdint.h>
+#include	<string.h>
+#include	<time.h>
 
 #ifdef HAVE_PTHREAD
 # include	<pthread.h>
@@ -17,6 +19,8 @@
 
 #include        "ememoa_memory_base.h"
 #include        "ememoa_mempool_error.h"
+#include        "ememoa_mempool_fixed.h"
+#include        "ememoa_mempool_arena.h"
 
 struct ememoa_memory_base_chunck_s
 {
@@ -30,25 +34,80 @@ struct ememoa_memory_base_chunck_s
    uint8_t                                      use;
 };
 
+/* The static buffer allocator carve allocations up to EMEMOA_SMALL_MAX bytes out of
+   pages shared by blocks of the same power of two size, from 16 bytes. */
+#define EMEMOA_SMALL_CLASSES    7
+#define EMEMOA_SMALL_MAX        (16 << (EMEMOA_SMALL_CLASSES - 1))
+
+/* Globals saved in a persistent buffer, see ememoa_snapshot_sync. */
+enum ememoa_memory_base_root_e
+{
+  EMEMOA_ROOT_RESIZE_LIST_POOLS,
+  EMEMOA_ROOT_FIXED,
+  EMEMOA_ROOT_UNKNOWN_SIZE,
+  EMEMOA_ROOT_ARENA,
+  EMEMOA_ROOT_USER,
+  EMEMOA_ROOTS
+};
+
 struct ememoa_memory_base_s
 {
 #ifdef DEBUG
    unsigned int                                 magic;
 #endif
-   void                                         *base;
+   /* Offsets from the start of this structure, so every process sharing it
+      could map it at a different address. */
+   unsigned int                                 data_offset;
+   unsigned int                                 chunks_offset;
+   unsigned int                                 pages_offset;
 
-   struct ememoa_memory_base_chunck_s           *chunks;
-   uint16_t                                     *pages;
+   unsigned int                                 size;
+   unsigned int                                 shared;
 
    unsigned int                                 chunks_count;
+   /* Page size as a power of two, see ememoa_memory_base_init_ext_64m. */
+   unsigned int                                 page_shift;
+   /* Biggest allocation carved out of a shared page. */
+   unsigned int                                 small_max;
 
    uint16_t                                     start;
    uint16_t                                     over;
    uint16_t                                     jump;
+
+   /* Pages of each small block size class with free blocks, see ememoa_memory_base_alloc_small_64m. */
+   uint16_t                                     small[EMEMOA_SMALL_CLASSES];
+
+#ifdef HAVE_PTHREAD
+   pthread_mutex_t                              lock;
+#endif
+
+   /* Only set in a persistent buffer, it is always mapped at address. */
+   unsigned int                                 persistent;
+   unsigned int                                 header_size;
+   void                                         *address;
+   void                                         *roots[EMEMOA_ROOTS];
+};
+
+/* Lock of a thread protected memory pool. The statistics are only updated
+   by the thread holding the lock. */
+struct ememoa_mempool_lock_s
+{
+#ifdef HAVE_PTHREAD
+   pthread_mutex_t                              mutex;
+#endif
+   int                                          word;
+   int                                          adaptive;
+
+   unsigned long long                           acquisitions;
+   unsigned long long                           contended;
+   unsigned long long                           wait_ns;
 };
 
 struct ememoa_mempool_fixed_s
 {
+   /* Must stay first, see ememoa_fixed_pop_object. */
+   struct ememoa_fixed_cache_s                  cache;
+
 #ifdef DEBUG
    unsigned int                                 magic;
 #endif
@@ -57,25 +116,44 @@ struct ememoa_mempool_fixed_s
    ememoa_mempool_error_t                       last_error_code;
 
    unsigned int                                 object_size;
+   unsigned int                                 requested_size;
    unsigned int                                 options;
+   unsigned int                                 align;
+   unsigned int                                 color;
 
+   /* Size of the smallest pool. */
    unsigned int                                 max_objects_pot;
    unsigned int                                 max_objects_poi;
    unsigned int                                 max_objects;
 
+   /* Size of the biggest pool with EMEMOA_ADAPTIVE_POOLS. */
+   unsigned int                                 max_pool_pot;
+
    int                                          jump_pool;
+   int                                          index;
+
+   /* Available objects garbage collection must keep in empty pools, see ememoa_fixed_reserve. */
+   unsigned int                                 reserved_objects;
+   unsigned int                                 kept_objects;
    const struct ememoa_mempool_desc_s           *desc;
+   struct ememoa_memory_backend_s               backend;
 
-#ifdef DEBUG
    unsigned int                                 out_objects;
    unsigned int                                 max_out_objects;
-#endif
+   /* Highest out_objects since the last garbage collection. */
+   unsigned int                                 peak_out_objects;
 
-#ifdef HAVE_PTHREAD
-   pthread_mutex_t                              lock;
-#endif
+   struct ememoa_mempool_lock_s                 lock;
 };
 
+/* Big blocks of up to EMEMOA_LARGE_CACHE_PAGES pages given back to an unknown size
+   memory pool are kept for the next pops of the same number of pages, at most
+   EMEMOA_LARGE_CACHE_DEPTH blocks of each size and EMEMOA_LARGE_CACHE_BYTES in all. */
+#define EMEMOA_LARGE_CACHE_PAGE_POT     12
+#define EMEMOA_LARGE_CACHE_PAGES        32
+#define EMEMOA_LARGE_CACHE_DEPTH        4
+#define EMEMOA_LARGE_CACHE_BYTES        (1024 * 1024)
+
 struct ememoa_mempool_unknown_size_s
 {
 #ifdef DEBUG
@@ -94,16 +172,227 @@ struct ememoa_mempool_unknown_size_s
 
    struct ememoa_mempool_alloc_item_s           *start;
 
+   /* Big blocks kept by number of pages, see ememoa_mempool_unknown_size_cache_take. */
+   struct ememoa_mempool_alloc_item_s           *cache[EMEMOA_LARGE_CACHE_PAGES];
+   unsigned int                                 cache_count[EMEMOA_LARGE_CACHE_PAGES];
+   size_t                                       cache_bytes;
+
+   /* Sum of the sizes asked by the users of the live objects. */
+   unsigned long long                           requested;
+
    const struct ememoa_mempool_desc_s           *desc;
+   struct ememoa_memory_backend_s               backend;
+   /* Given to the fixed memory pools, it only carry the backend. */
+   struct ememoa_mempool_desc_s                 pools_desc;
 
-#ifdef HAVE_PTHREAD
-   pthread_mutex_t                              lock;
-#endif
+   struct ememoa_mempool_lock_s                 lock;
 
    unsigned char                                in_use;
 };
 
+struct ememoa_mempool_arena_block_s
+{
+   struct ememoa_mempool_arena_block_s          *next;
+   uint8_t                                      *end;
+};
+
+struct ememoa_mempool_arena_s
+{
+   /* Must stay first, see ememoa_arena_pop_object. */
+   struct ememoa_arena_bump_s                   bump;
+
+#ifdef DEBUG
+   unsigned int                                 magic;
+#endif
+
+   struct ememoa_mempool_arena_block_s          *current;
+   struct ememoa_mempool_arena_block_s          *first;
+
+   ememoa_mempool_error_t                       last_error_code;
+
+   unsigned int                                 block_size;
+   unsigned int                                 options;
+
+   const struct ememoa_mempool_desc_s           *desc;
+   struct ememoa_memory_backend_s               backend;
+
+   struct ememoa_mempool_lock_s                 lock;
+};
+
+struct ememoa_mempool_gc_budget_s
+{
+   struct timespec                              start;
+
+   unsigned int                                 max_pools;
+   unsigned int                                 max_ns;
+   unsigned int                                 visited;
+   /* Only visit memory pools created with EMEMOA_THREAD_PROTECTION. */
+   unsigned int                                 protected_only;
+
+   struct ememoa_mempool_fixed_s                *memory;
+   int                                          mempool;
+   int                                          cursor;
+   int                                          freed;
+};
+
+/* Memory used by a memory pool, see ememoa_report_footprint. */
+struct ememoa_mempool_footprint_s
+{
+   unsigned long long                           requested;
+   unsigned long long                           handed;
+   unsigned long long                           reserved;
+   unsigned long long                           free_partial;
+   unsigned long long                           wasted;
+
+   unsigned int                                 pools;
+   unsigned int                                 objects;
+};
+
+extern struct ememoa_memory_base_resize_list_s  *fixed_pool_list;
+extern struct ememoa_memory_base_resize_list_s  *unknown_size_pool_list;
+extern struct ememoa_memory_base_resize_list_s  *arena_pool_list;
+
+int                                     ememoa_memory_base_setup_64m (void *buffer, unsigned int size, unsigned int page_shift, int shared);
+void                                    ememoa_memory_base_use_64m (struct ememoa_memory_base_s *heap);
+struct ememoa_memory_base_s*            ememoa_memory_base_current_64m (void);
+void*                                   ememoa_memory_base_resize_list_pools (void);
+int                                     ememoa_memory_base_mappable (size_t size);
+size_t                                  ememoa_memory_base_map_length (size_t size);
+void*                                   ememoa_memory_base_map (size_t length);
+void*                                   ememoa_memory_base_remap (void *ptr, size_t old_length, size_t length);
+void                                    ememoa_memory_base_unmap (void *ptr, size_t length);
+void                                    ememoa_memory_base_resize_list_restore (void *pools);
+
 struct ememoa_mempool_fixed_s*          ememoa_mempool_fixed_get_index (unsigned int index);
+void                                    ememoa_mempool_fixed_registry_lock (void);
+void                                    ememoa_mempool_fixed_registry_unlock (void);
+void                                    ememoa_mempool_fixed_registry_pin (struct ememoa_mempool_fixed_s *memory);
+void                                    ememoa_mempool_fixed_registry_unpin (void);
 struct ememoa_mempool_unknown_size_s*   ememoa_mempool_unknown_size_get_index (unsigned int index);
+struct ememoa_mempool_arena_s*          ememoa_mempool_arena_get_index (int index);
+
+void    ememoa_mempool_lock_init (struct ememoa_mempool_lock_s *lock, unsigned int options);
+void    ememoa_mempool_lock_destroy (struct ememoa_mempool_lock_s *lock);
+void    ememoa_mempool_lock_word_take_slow (int *word);
+void    ememoa_mempool_lock_word_release_slow (int *word);
+void    ememoa_mempool_lock_take_slow (struct ememoa_mempool_lock_s *lock);
+void    ememoa_mempool_lock_release_slow (struct ememoa_mempool_lock_s *lock);
+void    ememoa_mempool_lock_stat (const struct ememoa_mempool_lock_s *lock,
+                                  struct ememoa_mempool_lock_stat_s *stat);
+
+#ifdef HAVE_PTHREAD
+static inline void
+ememoa_mempool_lock_take (struct ememoa_mempool_lock_s *lock)
+{
+   int  c = 0;
+
+   if (lock->adaptive
+       ? __atomic_compare_exchange_n (&lock->word, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+       : pthread_mutex_trylock (&(lock->mutex)) == 0)
+     lock->acquisitions++;
+   else
+     ememoa_mempool_lock_take_slow (lock);
+}
+
+static inline void
+ememoa_mempool_lock_release (struct ememoa_mempool_lock_s *lock)
+{
+   if (!lock->adaptive)
+     pthread_mutex_unlock (&(lock->mutex));
+   else if (__atomic_exchange_n (&lock->word, 0, __ATOMIC_RELEASE) == 2)
+     ememoa_mempool_lock_release_slow (lock);
+}
+#endif
+
+/* Memory of a memory pool, from the backend of its description or, without one,
+   from ememoa_memory_base_alloc. */
+static inline void
+ememoa_mempool_backend_init (struct ememoa_memory_backend_s *backend,
+                             const struct ememoa_mempool_desc_s *desc)
+{
+   if (desc && desc->backend)
+     *backend = *desc->backend;
+   else
+     memset (backend, 0, sizeof (*backend));
+}
+
+static inline void*
+ememoa_mempool_backend_alloc (const struct ememoa_memory_backend_s *backend, size_t size)
+{
+   return backend->alloc ? backend->alloc (backend->ctx, size) : ememoa_memory_base_alloc (size);
+}
+
+static inline void
+ememoa_mempool_backend_free (const struct ememoa_memory_backend_s *backend, void *ptr)
+{
+   if (backend->free)
+     backend->free (backend->ctx, ptr);
+   else
+     ememoa_memory_base_free (ptr);
+}
+
+static inline void*
+ememoa_mempool_backend_realloc (const struct ememoa_memory_backend_s *backend, void *ptr, size_t size)
+{
+   return backend->realloc ? backend->realloc (backend->ctx, ptr, size) : ememoa_memory_base_realloc (ptr, size);
+}
+
+static inline unsigned int
+ememoa_mempool_backend_alignment (const struct ememoa_memory_backend_s *backend, size_t size)
+{
+   if (backend->alloc == NULL)
+     return ememoa_memory_base_alignment (size);
+   return backend->alignment ? backend->alignment (backend->ctx, size) : 2 * sizeof (void*);
+}
+
+static inline size_t
+ememoa_mempool_backend_granularity (const struct ememoa_memory_backend_s *backend, size_t size)
+{
+   if (backend->alloc == NULL)
+     return ememoa_memory_base_granularity (size);
+   return backend->granularity ? backend->granularity (backend->ctx, size) : 2 * sizeof (void*);
+}
+
+static inline size_t
+ememoa_mempool_backend_overhead (const struct ememoa_memory_backend_s *backend, size_t size)
+{
+   return backend->alloc == NULL ? ememoa_memory_base_overhead (size) : 0;
+}
+
+extern unsigned int                     ememoa_mempool_profile_rate;
+extern unsigned int                     ememoa_mempool_profile_live;
+extern __thread long                    ememoa_mempool_profile_countdown;
+
+void    ememoa_mempool_profile_record (void *ptr, unsigned int size);
+void    ememoa_mempool_profile_forget (void *ptr);
+
+/* Sampling heap profiler hooks, they cost one load and a branch when it is stopped. */
+static inline void
+ememoa_mempool_profile_pop (void *ptr, unsigned int size)
+{
+   if (__builtin_expect (ememoa_mempool_profile_rate != 0, 0)
+       && (ememoa_mempool_profile_countdown -= size) < 0)
+     ememoa_mempool_profile_record (ptr, size);
+}
+
+static inline void
+ememoa_mempool_profile_push (void *ptr)
+{
+   if (__builtin_expect (__atomic_load_n (&ememoa_mempool_profile_live, __ATOMIC_ACQUIRE) != 0, 0))
+     ememoa_mempool_profile_forget (ptr);
+}
+
+void    ememoa_mempool_fixed_footprint (struct ememoa_mempool_fixed_s *memory,
+                                        struct ememoa_mempool_footprint_s *footprint);
+void    ememoa_mempool_unknown_size_footprint (struct ememoa_mempool_unknown_size_s *memory,
+                                               struct ememoa_mempool_footprint_s *footprint);
+int     ememoa_memory_base_footprint_64m (unsigned int *page_size,
+                                          unsigned int *pages,
+                                          unsigned int *free_pages,
+                                          unsigned int *largest_free);
+
+int     ememoa_mempool_gc_budget_exhausted (struct ememoa_mempool_gc_budget_s *budget);
+int     ememoa_mempool_fixed_garbage_collect_step (struct ememoa_mempool_fixed_s *memory,
+                                                   struct ememoa_mempool_gc_budget_s *budget);
 
 #endif		/* MEMPOOL_STRUCT_H__ */
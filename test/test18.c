@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_gc.h"
+
+/* Pool size: 2^5 objects */
+#define MAX_POOL 5
+#define POOLS 8
+
+int main(void)
+{
+   int          *tbl[(1 << MAX_POOL) * POOLS];
+   int          test_zone;
+   int          freed;
+   int          step;
+   unsigned int done;
+   unsigned int i;
+
+   test_zone = ememoa_mempool_fixed_init (sizeof (int), MAX_POOL, 0, NULL);
+   if (test_zone < 0)
+     return 1;
+
+   for (i = 0; i < sizeof (tbl) / sizeof (int*); ++i)
+     {
+        tbl[i] = ememoa_mempool_fixed_pop_object (test_zone);
+        if (tbl[i] == NULL)
+          return 2;
+        *tbl[i] = i;
+     }
+
+   /* Nothing to collect yet. */
+   if (ememoa_mempool_gc_step (0, 0) != 0)
+     return 3;
+
+   /* Give back every pool but the last one. */
+   for (i = 0; i < (1 << MAX_POOL) * (POOLS - 1); ++i)
+     if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+       {
+          fprintf (stderr, "ERROR: %s\n", ememoa_mempool_error2string (ememoa_mempool_fixed_get_last_error (test_zone)));
+          return 4;
+       }
+
+   /* One pool per step, never more. */
+   for (freed = 0, i = 0; i < 2 * POOLS; ++i)
+     {
+        step = ememoa_mempool_gc_step (1, 0);
+        if (step < 0 || step > 1)
+          return 5;
+        freed += step;
+     }
+
+   if (freed != POOLS - 1)
+     {
+        fprintf (stderr, "ERROR: %i pools freed instead of %i.\n", freed, POOLS - 1);
+        return 6;
+     }
+
+   for (i = (1 << MAX_POOL) * (POOLS - 1); i < sizeof (tbl) / sizeof (int*); ++i)
+     if (*tbl[i] != (int) i)
+       return 7;
+
+   /* The surviving pool must still accept its objects back. */
+   for (i = (1 << MAX_POOL) * (POOLS - 1); i < sizeof (tbl) / sizeof (int*); ++i)
+     if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+       return 8;
+
+   /* The background thread never touch a memory pool without thread protection. */
+   if (ememoa_mempool_gc_thread_start (1, 4, 100000) == 0)
+     {
+        usleep (20000);
+        if (ememoa_mempool_gc_thread_stop ())
+          return 9;
+     }
+   if (ememoa_mempool_gc_step (0, 1000000) != 1)
+     return 10;
+
+   for (i = 0; i < 100; ++i)
+     if ((tbl[i] = ememoa_mempool_fixed_pop_object (test_zone)) == NULL)
+       return 11;
+
+   /* Steps freeing nothing don't end the walk, done does. */
+   for (i = 0; i < 100; ++i)
+     if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+       return 12;
+   for (freed = 0, done = 0, i = 0; !done; ++i)
+     freed += ememoa_mempool_gc_step_ext (1, 0, &done);
+   if (freed != 4 || i < 4)
+     {
+        fprintf (stderr, "ERROR: %i pools freed in %u steps.\n", freed, i);
+        return 13;
+     }
+
+   /* Memory pools come and go while the background thread walks over them. */
+   if (ememoa_mempool_gc_thread_start (0, 1, 0) == 0)
+     {
+        int	churn;
+
+        for (i = 0; i < 2000; ++i)
+          {
+             churn = ememoa_mempool_fixed_init (sizeof (int), 2, EMEMOA_THREAD_PROTECTION, NULL);
+             if (churn < 0)
+               return 14;
+             ememoa_mempool_fixed_push_object (churn, ememoa_mempool_fixed_pop_object (churn));
+             if (ememoa_mempool_fixed_clean (churn))
+               return 15;
+          }
+        if (ememoa_mempool_gc_thread_stop ())
+          return 16;
+     }
+
+   ememoa_mempool_fixed_clean (test_zone);
+
+   return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "ememoa_mempool_fixed.h"
+
+/* Pool size: 2^5 objects */
+#define MAX_POOL 5
+#define POOLS 6
+#define PINNED 33
+
+struct object_s
+{
+   struct object_s      **ref;
+   unsigned int         value;
+};
+
+static unsigned int     moved = 0;
+
+static int
+relocate_cb (void *old_ptr, void *new_ptr, void *data)
+{
+   struct object_s      *object = new_ptr;
+
+   (void) old_ptr; (void) data;
+
+   if (object->value == PINNED)
+     return 1;
+
+   *object->ref = object;
+   moved++;
+   return 0;
+}
+
+static const struct ememoa_mempool_desc_s       desc = { "compact test", NULL, relocate_cb, NULL };
+
+int main(void)
+{
+   struct object_s      *tbl[(1 << MAX_POOL) * POOLS];
+   int                  test_zone;
+   int                  none_zone;
+   int                  freed;
+   unsigned int         i;
+
+   none_zone = ememoa_mempool_fixed_init (sizeof (struct object_s), MAX_POOL, 0, NULL);
+   if (ememoa_mempool_fixed_compact (none_zone, NULL) != -1
+       || ememoa_mempool_fixed_get_last_error (none_zone) != EMEMOA_NO_RELOCATE_CALLBACK)
+     return 1;
+
+   test_zone = ememoa_mempool_fixed_init (sizeof (struct object_s), MAX_POOL, 0, &desc);
+   if (test_zone < 0)
+     return 2;
+
+   for (i = 0; i < sizeof (tbl) / sizeof (struct object_s*); ++i)
+     {
+        tbl[i] = ememoa_mempool_fixed_pop_object (test_zone);
+        if (tbl[i] == NULL)
+          return 3;
+        tbl[i]->ref = tbl + i;
+        tbl[i]->value = i;
+     }
+
+   /* Keep two objects alive in every pool. */
+   for (i = 0; i < sizeof (tbl) / sizeof (struct object_s*); ++i)
+     if ((i & ((1 << MAX_POOL) - 1)) > 1)
+       {
+          if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+            return 4;
+          tbl[i] = NULL;
+       }
+
+   freed = ememoa_mempool_fixed_compact (test_zone, NULL);
+
+   /* 12 objects fit in one pool, but the pinned one keeps a second pool alive. */
+   if (freed != POOLS - 2)
+     {
+        fprintf (stderr, "ERROR: %i pools freed, %i objects moved.\n", freed, moved);
+        return 5;
+     }
+
+   for (i = 0; i < sizeof (tbl) / sizeof (struct object_s*); ++i)
+     if (tbl[i])
+       {
+          if (tbl[i]->value != i || tbl[i]->ref != tbl + i)
+            return 6;
+          if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+            return 7;
+       }
+
+   if (ememoa_mempool_fixed_garbage_collect (test_zone))
+     return 8;
+
+   /* An empty pool is no room: 20 objects don't fit in the single free slot left
+      in the full pool, so none of them moves. */
+   for (i = 0; i < 3 << MAX_POOL; ++i)
+     {
+        tbl[i] = ememoa_mempool_fixed_pop_object (test_zone);
+        if (tbl[i] == NULL)
+          return 9;
+        tbl[i]->ref = tbl + i;
+        tbl[i]->value = i;
+     }
+   for (i = 0; i < 3 << MAX_POOL; ++i)
+     if (i == 0 || (i >= 1 << MAX_POOL && i < (1 << MAX_POOL) + 12) || i >= 2 << MAX_POOL)
+       {
+          if (ememoa_mempool_fixed_push_object (test_zone, tbl[i]))
+            return 10;
+          tbl[i] = NULL;
+       }
+
+   moved = 0;
+   ememoa_mempool_fixed_compact (test_zone, NULL);
+   if (moved != 0)
+     {
+        fprintf (stderr, "ERROR: %i objects moved without freeing their pool.\n", moved);
+        return 11;
+     }
+
+   for (i = 0; i < 3 << MAX_POOL; ++i)
+     if (tbl[i] && (tbl[i]->value != i || ememoa_mempool_fixed_push_object (test_zone, tbl[i])))
+       return 12;
+
+   ememoa_mempool_fixed_clean (test_zone);
+   ememoa_mempool_fixed_clean (none_zone);
+
+   return 0;
+}
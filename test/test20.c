@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "ememoa_mempool_arena.h"
+
+#define BLOCK_SIZE 1024
+
+int main(void)
+{
+   struct ememoa_mempool_arena_mark_s   mark;
+   uint8_t                              *first;
+   uint8_t                              *tbl[256];
+   uint8_t                              *big;
+   uint8_t                              *again;
+   uint8_t                              *ptr;
+   ememoa_arena_t                       *handle;
+   int                                  arena;
+   unsigned int                         i;
+
+   arena = ememoa_mempool_arena_init (BLOCK_SIZE, 0, NULL);
+   if (arena < 0)
+     return 1;
+
+   first = ememoa_mempool_arena_pop_object (arena, 1);
+   if (first == NULL || ((uintptr_t) first & (sizeof (void*) - 1)))
+     return 2;
+
+   for (i = 0; i < 256; ++i)
+     {
+        tbl[i] = ememoa_mempool_arena_pop_object (arena, 24);
+        if (tbl[i] == NULL)
+          return 3;
+        memset (tbl[i], i, 24);
+     }
+
+   for (i = 0; i < 256; ++i)
+     if (tbl[i][0] != i || tbl[i][23] != i)
+       return 4;
+
+   if (ememoa_mempool_arena_checkpoint (arena, &mark))
+     return 5;
+
+   big = ememoa_mempool_arena_pop_object (arena, 4 * BLOCK_SIZE);
+   if (big == NULL)
+     return 6;
+   memset (big, 0xAA, 4 * BLOCK_SIZE);
+
+   if (ememoa_mempool_arena_rollback (arena, &mark))
+     return 7;
+
+   /* Everything before the mark is still there. */
+   for (i = 0; i < 256; ++i)
+     if (tbl[i][0] != i)
+       return 8;
+
+   again = ememoa_mempool_arena_pop_object (arena, 4 * BLOCK_SIZE);
+   if (again != big)
+     return 9;
+
+   if (ememoa_mempool_arena_reset (arena))
+     return 10;
+
+   /* Blocks are reused after a reset. */
+   if (ememoa_mempool_arena_pop_object (arena, 1) != first)
+     return 11;
+
+   if (ememoa_mempool_arena_garbage_collect (arena) <= 0)
+     return 12;
+
+   if (ememoa_mempool_arena_pop_object (arena, 2 * BLOCK_SIZE) == NULL)
+     return 13;
+
+   /* Sizes that would wrap around once rounded are refused. */
+   if (ememoa_mempool_arena_pop_object (arena, UINT_MAX) != NULL
+       || ememoa_mempool_arena_pop_object (arena, UINT_MAX - 3) != NULL
+       || ememoa_mempool_arena_get_last_error (arena) != EMEMOA_NO_MORE_MEMORY)
+     return 15;
+   if (ememoa_mempool_arena_init (UINT_MAX, 0, NULL) >= 0)
+     return 16;
+
+   /* The handle and the index share the same blocks. */
+   handle = ememoa_arena_from_index (arena);
+   if (handle == NULL || ememoa_arena_from_index (-1) != NULL)
+     return 17;
+   if (ememoa_mempool_arena_reset (arena))
+     return 18;
+   if (ememoa_arena_pop_object (handle, 1) != first)
+     return 19;
+   ptr = ememoa_arena_pop_object (handle, 24);
+   if (ptr != first + EMEMOA_ARENA_ROUND(1))
+     return 20;
+   if (ememoa_mempool_arena_pop_object (arena, 1) != ptr + EMEMOA_ARENA_ROUND(24))
+     return 21;
+   if (ememoa_arena_pop_object (handle, UINT_MAX) != NULL)
+     return 22;
+
+   if (ememoa_mempool_arena_clean (arena))
+     return 14;
+
+   return 0;
+}
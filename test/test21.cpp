@@ -0,0 +1,124 @@
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <cstdio>
+#include <climits>
+#include <cstdint>
+
+#include "ememoa.hpp"
+
+struct node_s
+{
+   node_s (int key, std::string value) : key (key), value (std::move (value)) { ++alive; }
+   ~node_s () { --alive; }
+
+   int                  key;
+   std::string          value;
+
+   static int           alive;
+};
+
+int node_s::alive = 0;
+
+struct alignas (64) line_s
+{
+   char                 data[24];
+};
+
+int main(void)
+{
+   ememoa::fixed_pool<node_s>   nodes (5);
+   node_s                       *tbl[100];
+   int                          i;
+
+   for (i = 0; i < 100; ++i)
+     tbl[i] = nodes.construct (i, std::to_string (i));
+
+   if (node_s::alive != 100)
+     return 1;
+
+   for (i = 0; i < 100; ++i)
+     if (tbl[i]->key != i || tbl[i]->value != std::to_string (i))
+       return 2;
+
+   for (i = 0; i < 100; ++i)
+     nodes.destroy (tbl[i]);
+
+   if (node_s::alive != 0)
+     return 3;
+
+   {
+      ememoa::fixed_pool<line_s>                        lines (4);
+      line_s                                            *l[20];
+
+      for (i = 0; i < 20; ++i)
+        if ((l[i] = lines.construct ()) == NULL || ((uintptr_t) l[i] & 63))
+          return 11;
+      for (i = 0; i < 20; ++i)
+        lines.destroy (l[i]);
+   }
+
+   {
+      ememoa::unknown_size_pool                         pool;
+      ememoa::allocator<int>                            alloc (pool);
+      std::list<int, ememoa::allocator<int> >           lst (alloc);
+      std::map<int, int, std::less<int>,
+               ememoa::allocator<std::pair<const int, int> > > map (alloc);
+
+      for (i = 0; i < 1000; ++i)
+        {
+           lst.push_back (i);
+           map[i] = i * 2;
+        }
+
+      i = 0;
+      for (std::list<int, ememoa::allocator<int> >::iterator it = lst.begin (); it != lst.end (); ++it, ++i)
+        if (*it != i)
+          return 4;
+
+      for (i = 0; i < 1000; ++i)
+        if (map[i] != i * 2)
+          return 5;
+
+      /* Sizes that would wrap around are refused instead of giving a tiny buffer. */
+      try
+        {
+           ememoa::allocator<std::pair<const int, int> > (pool).allocate ((std::size_t) UINT_MAX / 4);
+           return 8;
+        }
+      catch (const std::bad_array_new_length&)
+        {
+        }
+      catch (const std::bad_alloc&)
+        {
+           return 9;
+        }
+
+      try
+        {
+           pool.allocate (UINT_MAX - 8);
+           return 10;
+        }
+      catch (const std::bad_alloc&)
+        {
+        }
+
+#ifdef EMEMOA_HAVE_PMR
+      ememoa::memory_resource                           resource (pool);
+      std::pmr::unordered_map<int, std::pmr::string>    umap (&resource);
+
+      for (i = 0; i < 1000; ++i)
+        umap[i] = std::pmr::string ("a string too long for the small string optimisation", &resource);
+
+      for (i = 0; i < 1000; ++i)
+        if (umap[i].size () != 51)
+          return 6;
+
+      if (!resource.is_equal (resource))
+        return 7;
+#endif
+   }
+
+   return 0;
+}
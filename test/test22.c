@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ememoa_mempool_fixed_static.h"
+
+struct object_s
+{
+   unsigned int value;
+   char         name[20];
+};
+
+/* 2^6 objects per pool, not a power of two size. */
+EMEMOA_MEMPOOL_FIXED_STATIC(object, sizeof (struct object_s), 6, 0);
+EMEMOA_MEMPOOL_FIXED_STATIC_INSTANCE(object);
+
+/* Power of two size, thread protected. */
+EMEMOA_MEMPOOL_FIXED_STATIC(word, sizeof (uint64_t), 5, EMEMOA_THREAD_PROTECTION);
+EMEMOA_MEMPOOL_FIXED_STATIC_INSTANCE(word);
+
+#define COUNT 1000
+
+int main(void)
+{
+   struct object_s      *tbl[COUNT];
+   uint64_t             *words[COUNT];
+   unsigned int         i;
+
+   for (i = 0; i < COUNT; ++i)
+     {
+        tbl[i] = object_pop_object ();
+        words[i] = word_pop_object ();
+        if (tbl[i] == NULL || words[i] == NULL)
+          return 1;
+        tbl[i]->value = i;
+        snprintf (tbl[i]->name, sizeof (tbl[i]->name), "object %u", i);
+        *words[i] = i;
+     }
+
+   for (i = 0; i < COUNT; ++i)
+     if (tbl[i]->value != i || *words[i] != i)
+       return 2;
+
+   for (i = 0; i < COUNT; i += 2)
+     if (object_push_object (tbl[i]) || word_push_object (words[i]))
+       return 3;
+
+   /* Double push and foreign pointers are refused. */
+   if (object_push_object (tbl[0]) == 0)
+     return 4;
+   if (object_push_object (&i) == 0)
+     return 5;
+
+   /* Freed slots are reused. */
+   for (i = 0; i < COUNT; i += 2)
+     if ((tbl[i] = object_pop_object ()) == NULL)
+       return 6;
+     else
+       tbl[i]->value = i;
+
+   for (i = 0; i < COUNT; ++i)
+     if (tbl[i]->value != i)
+       return 7;
+
+   for (i = 0; i < COUNT; ++i)
+     if (object_push_object (tbl[i]))
+       return 8;
+
+   if (object_garbage_collect () != (COUNT + 63) / 64)
+     return 9;
+
+   if (word_clean () || object_clean ())
+     return 10;
+
+   if (object_pop_object () == NULL)
+     return 11;
+
+   return object_clean ();
+}
@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_gc.h"
+
+#define COUNT	3000
+
+static int
+count_cb (void *ptr, void *data)
+{
+   (void) ptr;
+   ++*(unsigned int*) data;
+   return 0;
+}
+
+int main(void)
+{
+   ememoa_fixed_t	*pool;
+   ememoa_fixed_t	*locked;
+   unsigned int		*tbl[COUNT];
+   unsigned int		live;
+   unsigned int		i;
+   void			*last;
+   void			*other;
+
+   pool = ememoa_fixed_init (sizeof (unsigned int), 6, 0, NULL);
+   if (pool == NULL)
+     return 1;
+
+   if (ememoa_fixed_from_index (ememoa_fixed_to_index (pool)) != pool)
+     return 2;
+
+   for (i = 0; i < COUNT; ++i)
+     {
+	tbl[i] = ememoa_fixed_pop_object (pool);
+	if (tbl[i] == NULL)
+	  {
+	     fprintf (stderr, "ERROR: %s\n", ememoa_mempool_error2string (ememoa_fixed_get_last_error (pool)));
+	     return 3;
+	  }
+	*tbl[i] = i;
+     }
+
+   for (i = 0; i < COUNT; ++i)
+     if (*tbl[i] != i)
+       return 4;
+
+   /* The last pushed object is the first given back. */
+   last = tbl[COUNT - 1];
+   if (ememoa_fixed_push_object (pool, last))
+     return 5;
+   if (ememoa_fixed_pop_object (pool) != last)
+     return 6;
+
+   /* Double push and foreign pointers never reach the cache. */
+   if (ememoa_fixed_push_object (pool, last))
+     return 20;
+   if (ememoa_fixed_push_object (pool, last) == 0)
+     return 21;
+   if (ememoa_fixed_push_object (pool, &live) == 0)
+     return 22;
+   if (ememoa_fixed_pop_object (pool) != last)
+     return 23;
+
+   /* Nor pointers inside an object. */
+   if (ememoa_fixed_push_object (pool, (char*) last + 1) == 0
+       || ememoa_fixed_get_last_error (pool) != EMEMOA_ERROR_PUSH_ADDRESS_NOT_FOUND)
+     return 29;
+
+   /* An object pushed again once it left the cache is refused, and given only once. */
+   if (ememoa_fixed_push_object (pool, last) || ememoa_fixed_flush (pool))
+     return 30;
+   if (ememoa_fixed_push_object (pool, last) == 0
+       || ememoa_fixed_get_last_error (pool) != EMEMOA_DOUBLE_PUSH)
+     return 31;
+   if (ememoa_fixed_pop_object (pool) != last)
+     return 32;
+   other = ememoa_fixed_pop_object (pool);
+   if (other == NULL || other == last || ememoa_fixed_push_object (pool, other))
+     return 33;
+   if (ememoa_fixed_pop_object (pool) != other)
+     return 34;
+   if (ememoa_mempool_fixed_push_object (ememoa_fixed_to_index (pool), other))
+     return 35;
+
+   for (i = 0; i < COUNT; i += 2)
+     if (ememoa_fixed_push_object (pool, tbl[i]))
+       return 7;
+
+   /* Cached objects must not be seen as live. */
+   live = 0;
+   if (ememoa_fixed_walk_over (pool, count_cb, &live) || live != COUNT / 2)
+     return 8;
+
+   /* The int API works on the same pool. */
+   if (ememoa_mempool_fixed_push_object (ememoa_fixed_to_index (pool), tbl[1]))
+     return 9;
+
+   for (i = 3; i < COUNT; i += 2)
+     if (ememoa_fixed_push_object (pool, tbl[i]))
+       return 10;
+
+   if (ememoa_fixed_garbage_collect (pool))
+     return 11;
+
+   live = 0;
+   if (ememoa_fixed_walk_over (pool, count_cb, &live) || live != 0)
+     return 12;
+
+   if (ememoa_fixed_clean (pool))
+     return 13;
+
+   /* An incremental collection step flushes the cache first. */
+   pool = ememoa_fixed_init (sizeof (unsigned int), 6, 0, NULL);
+   if (pool == NULL)
+     return 24;
+   for (i = 0; i < 100; ++i)
+     if ((tbl[i] = ememoa_fixed_pop_object (pool)) == NULL)
+       return 25;
+   for (i = 0; i < 100; ++i)
+     if (ememoa_fixed_push_object (pool, tbl[i]))
+       return 26;
+   if (ememoa_mempool_gc_step (0, 0) != 2)
+     return 27;
+   if (ememoa_fixed_clean (pool))
+     return 28;
+
+   /* Objects of a pool given back to the system are refused. */
+   pool = ememoa_fixed_init (sizeof (unsigned int), 6, 0, NULL);
+   if (pool == NULL)
+     return 36;
+   for (i = 0; i < 100; ++i)
+     if ((tbl[i] = ememoa_fixed_pop_object (pool)) == NULL)
+       return 37;
+   for (i = 64; i < 100; ++i)
+     if (ememoa_mempool_fixed_push_object (ememoa_fixed_to_index (pool), tbl[i]))
+       return 38;
+   if (ememoa_fixed_garbage_collect (pool))
+     return 39;
+   if (ememoa_fixed_push_object (pool, tbl[99]) == 0
+       || ememoa_fixed_get_last_error (pool) != EMEMOA_ERROR_PUSH_ADDRESS_NOT_FOUND)
+     return 40;
+   if (ememoa_fixed_clean (pool))
+     return 41;
+
+   /* Thread protected pool go through the library on each call. */
+   locked = ememoa_fixed_init (sizeof (double), 5, EMEMOA_THREAD_PROTECTION, NULL);
+   if (locked == NULL)
+     return 14;
+
+   last = ememoa_fixed_pop_object (locked);
+   if (last == NULL)
+     return 15;
+   if (ememoa_fixed_push_object (locked, &live) == 0)
+     return 16;
+   if (ememoa_fixed_push_object (locked, last))
+     return 17;
+
+   return ememoa_fixed_clean (locked);
+}
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+
+#define COUNT	200
+
+static int
+check_fixed (unsigned int size, unsigned int pot, unsigned int align)
+{
+   int		pool;
+   void		*tbl[COUNT];
+   unsigned int	i;
+
+   pool = ememoa_mempool_fixed_init (size, pot, EMEMOA_MEMPOOL_ALIGN(__builtin_ctz (align)), NULL);
+   if (pool < 0)
+     return 1;
+
+   for (i = 0; i < COUNT; ++i)
+     {
+	tbl[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (tbl[i] == NULL || ((uintptr_t) tbl[i] & (align - 1)))
+	  return 2;
+	memset (tbl[i], i, size);
+     }
+
+   for (i = 0; i < COUNT; ++i)
+     if (((unsigned char*) tbl[i])[size - 1] != (unsigned char) i)
+       return 3;
+
+   for (i = 0; i < COUNT; ++i)
+     if (ememoa_mempool_fixed_push_object (pool, tbl[i]))
+       return 4;
+
+   return ememoa_mempool_fixed_clean (pool) ? 5 : 0;
+}
+
+static size_t	largest = 0;
+
+static void*
+page_alloc (void *ctx, size_t size)
+{
+   void		*ptr;
+
+   (void) ctx;
+   if (size > largest)
+     largest = size;
+   return posix_memalign (&ptr, 4096, size) ? NULL : ptr;
+}
+
+static void
+page_free (void *ctx, void *ptr)
+{
+   (void) ctx;
+   free (ptr);
+}
+
+static unsigned int
+page_alignment (void *ctx, size_t size)
+{
+   (void) ctx; (void) size;
+   return 4096;
+}
+
+/* A page aligned pool only cost its objects and a small header. */
+static int
+check_page_header (void)
+{
+   struct ememoa_memory_backend_s	backend = { page_alloc, page_free, NULL, page_alignment, NULL, NULL };
+   struct ememoa_mempool_desc_s		desc = { "page", NULL, NULL, &backend };
+   void					*tbl[32];
+   int					pool;
+   unsigned int				i;
+
+   pool = ememoa_mempool_fixed_init (4096, 5, EMEMOA_ALIGN_PAGE, &desc);
+   if (pool < 0)
+     return 30;
+
+   for (i = 0; i < 32; ++i)
+     {
+	tbl[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (tbl[i] == NULL || ((uintptr_t) tbl[i] & 4095))
+	  return 31;
+	memset (tbl[i], i, 4096);
+     }
+
+   if (largest == 0 || largest >= (32 + 1) * 4096)
+     return 32;
+
+   for (i = 0; i < 32; ++i)
+     if (((unsigned char*) tbl[i])[4095] != (unsigned char) i
+	 || ememoa_mempool_fixed_push_object (pool, tbl[i]))
+       return 33;
+
+   return ememoa_mempool_fixed_clean (pool) ? 34 : 0;
+}
+
+static int
+check_unknown (unsigned int pool, unsigned int size, unsigned int align)
+{
+   void		*tbl[COUNT];
+   unsigned int	i;
+
+   for (i = 0; i < COUNT; ++i)
+     {
+	tbl[i] = ememoa_mempool_unknown_size_pop_object_aligned (pool, size, align);
+	if (tbl[i] == NULL || ((uintptr_t) tbl[i] & (align - 1)))
+	  return 10;
+	memset (tbl[i], i, size);
+     }
+
+   for (i = 0; i < COUNT; ++i)
+     if (((unsigned char*) tbl[i])[0] != (unsigned char) i
+	 || ((unsigned char*) tbl[i])[size - 1] != (unsigned char) i)
+       return 11;
+
+   /* Growing keeps both the content and the alignment. */
+   for (i = 0; i < COUNT; i += 3)
+     {
+	tbl[i] = ememoa_mempool_unknown_size_resize_object (pool, tbl[i], size * 4);
+	if (tbl[i] == NULL || ((uintptr_t) tbl[i] & (align - 1))
+	    || ((unsigned char*) tbl[i])[size - 1] != (unsigned char) i)
+	  return 12;
+	memset (tbl[i], i, size * 4);
+     }
+
+   for (i = 0; i < COUNT; ++i)
+     if (ememoa_mempool_unknown_size_push_object (pool, tbl[i]))
+       return 13;
+
+   return 0;
+}
+
+int main(void)
+{
+   unsigned int	pool;
+   int		error;
+
+   if ((error = check_fixed (40, 6, 64)) != 0)
+     return error;
+   if ((error = check_fixed (sizeof (int), 5, 4096)) != 0)
+     return error;
+   if ((error = check_fixed (24, 7, 8)) != 0)
+     return error;
+   if ((error = check_page_header ()) != 0)
+     return error;
+
+   pool = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					    default_map_size_count,
+					    0,
+					    NULL);
+   if ((int) pool < 0)
+     return 20;
+
+   if ((error = check_unknown (pool, 24, 64)) != 0)
+     return error;
+   if ((error = check_unknown (pool, 8, 16)) != 0)
+     return error;
+   if ((error = check_unknown (pool, 300, 4096)) != 0)
+     return error;
+   if ((error = check_unknown (pool, 20, 4)) != 0)
+     return error;
+
+   return ememoa_mempool_unknown_size_clean (pool);
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_memory_base.h"
+
+#define MEMSIZE	4 * 1024 * 1024
+#define POOLS	8
+#define BIG_PAGE	65536
+#define BIG_POOLS	20
+
+/* A heap with 64K pages leaves room for many more colors than a 4K page. */
+static int
+check_big_pages (void)
+{
+   struct ememoa_memory_backend_s	backend;
+   struct ememoa_mempool_desc_s		desc = { "colors", NULL, NULL, &backend };
+   ememoa_heap_t			*heap;
+   void					*mem;
+   void					*first[BIG_POOLS];
+   int					pool;
+   unsigned int				i, j;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   heap = ememoa_heap_init (mem, MEMSIZE, BIG_PAGE);
+   if (heap == NULL)
+     return 20;
+   ememoa_heap_backend (heap, &backend);
+
+   pool = ememoa_mempool_fixed_init (24, 7, EMEMOA_CACHE_COLORING, &desc);
+   if (pool < 0)
+     return 21;
+
+   for (i = 0; i < BIG_POOLS; ++i)
+     {
+	first[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (first[i] == NULL)
+	  return 22;
+	for (j = 1; j < 128; ++j)
+	  if (ememoa_mempool_fixed_pop_object (pool) == NULL)
+	    return 23;
+     }
+
+   /* More pools than colors in a 4K page, and none of them wrap around. */
+   for (i = 0; i < BIG_POOLS; ++i)
+     if (((uintptr_t) first[i] & (BIG_PAGE - 1)) != ((uintptr_t) first[0] & (BIG_PAGE - 1)) + i * 64)
+       return 24;
+
+   return ememoa_mempool_fixed_clean (pool);
+}
+
+int main(void)
+{
+   void		*mem;
+   void		*first[POOLS];
+   void		*ptr;
+   void		*start;
+   void		*prev;
+   int		pool;
+   int		plain;
+   unsigned int	i, j;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   if (ememoa_memory_base_init_64m (mem, MEMSIZE))
+     return 1;
+
+   /* 24 * 128 = 3072 bytes plus the pool header, so more than 960 bytes are free in the
+      last page of each pool. */
+   pool = ememoa_mempool_fixed_init (24, 7, EMEMOA_CACHE_COLORING, NULL);
+   plain = ememoa_mempool_fixed_init (24, 7, 0, NULL);
+   if (pool < 0 || plain < 0)
+     return 2;
+
+   for (i = 0; i < POOLS; ++i)
+     {
+	first[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (first[i] == NULL)
+	  return 3;
+	for (j = 1; j < 128; ++j)
+	  if (ememoa_mempool_fixed_pop_object (pool) == NULL)
+	    return 4;
+     }
+
+   /* Each pool start one cache line further in its page. */
+   for (i = 0; i < POOLS; ++i)
+     if (((uintptr_t) first[i] & 4095) != ((uintptr_t) first[0] & 4095) + i * 64)
+       return 5;
+
+   /* Without the option every pool start at the same place in its page. The pools
+      fill their last page, so they hold more than 128 objects. */
+   start = ememoa_mempool_fixed_pop_object (plain);
+   for (prev = start;
+	(ptr = ememoa_mempool_fixed_pop_object (plain)) == (uint8_t*) prev + 24;
+	prev = ptr)
+     ;
+   if (start == NULL || ptr == NULL || ((uintptr_t) ptr & 4095) != ((uintptr_t) start & 4095))
+     return 6;
+
+   if (ememoa_mempool_fixed_push_object (pool, first[3]))
+     return 7;
+   if (ememoa_mempool_fixed_pop_object (pool) != first[3])
+     return 8;
+
+   if (ememoa_mempool_fixed_clean (plain))
+     return 9;
+   if (ememoa_mempool_fixed_clean (pool))
+     return 10;
+   return check_big_pages ();
+}
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_gc.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+#define THREADS		4
+#define ROUNDS		200
+#define OBJECTS		100
+
+static void*
+worker (void *data)
+{
+   unsigned int	*tbl[OBJECTS];
+   unsigned int	id = (unsigned int) (uintptr_t) data;
+   unsigned int	round;
+   unsigned int	i;
+
+   for (round = 0; round < ROUNDS; ++round)
+     {
+	ememoa_fixed_t	*pool;
+	unsigned int	unknown;
+
+	pool = ememoa_fixed_init (sizeof (unsigned int) * (1 + (round & 7)), 5, EMEMOA_THREAD_PROTECTION, NULL);
+	if (pool == NULL)
+	  return (void*) 1;
+
+	for (i = 0; i < OBJECTS; ++i)
+	  {
+	     tbl[i] = ememoa_fixed_pop_object (pool);
+	     if (tbl[i] == NULL)
+	       return (void*) 2;
+	     *tbl[i] = id * OBJECTS + i;
+	  }
+
+	for (i = 0; i < OBJECTS; ++i)
+	  if (*tbl[i] != id * OBJECTS + i
+	      || ememoa_fixed_push_object (pool, tbl[i]))
+	    return (void*) 3;
+
+	if (ememoa_fixed_clean (pool))
+	  return (void*) 4;
+
+	unknown = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+						    default_map_size_count,
+						    EMEMOA_THREAD_PROTECTION,
+						    NULL);
+	if ((int) unknown < 0)
+	  return (void*) 5;
+	tbl[0] = ememoa_mempool_unknown_size_pop_object (unknown, 100);
+	if (tbl[0] == NULL)
+	  return (void*) 6;
+	ememoa_mempool_unknown_size_push_object (unknown, tbl[0]);
+	ememoa_mempool_unknown_size_clean (unknown);
+     }
+
+   return NULL;
+}
+
+int main(void)
+{
+   pthread_t		threads[THREADS];
+   unsigned int		*tbl[OBJECTS];
+   void			*result;
+   int			shared;
+   unsigned int		round;
+   unsigned int		i;
+   int			error = 0;
+
+   /* A long lived pool used through the int API while others come and go. */
+   shared = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, EMEMOA_THREAD_PROTECTION, NULL);
+   if (shared < 0)
+     return 1;
+
+   for (i = 0; i < THREADS; ++i)
+     if (pthread_create (threads + i, NULL, worker, (void*) (uintptr_t) i))
+       return 2;
+
+   for (round = 0; round < ROUNDS; ++round)
+     {
+	for (i = 0; i < OBJECTS; ++i)
+	  {
+	     tbl[i] = ememoa_mempool_fixed_pop_object (shared);
+	     if (tbl[i] == NULL)
+	       return 3;
+	     *tbl[i] = i;
+	  }
+	for (i = 0; i < OBJECTS; ++i)
+	  if (*tbl[i] != i || ememoa_mempool_fixed_push_object (shared, tbl[i]))
+	    return 4;
+	ememoa_mempool_gc_step (4, 0);
+     }
+
+   for (i = 0; i < THREADS; ++i)
+     {
+	pthread_join (threads[i], &result);
+	if (result != NULL)
+	  error = 10 + (int) (uintptr_t) result;
+     }
+
+   if (error)
+     return error;
+
+   return ememoa_mempool_fixed_clean (shared);
+}
+#else
+int main(void)
+{
+   /* Nothing to test without thread support. */
+   return 77;
+}
+#endif
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_arena.h"
+#include "ememoa_mempool_fixed_static.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+#define THREADS		4
+#define ROUNDS		20000
+
+EMEMOA_MEMPOOL_FIXED_STATIC(shared, sizeof (unsigned int), 5, EMEMOA_THREAD_PROTECTION);
+EMEMOA_MEMPOOL_FIXED_STATIC_INSTANCE(shared);
+
+static void*
+static_worker (void *data)
+{
+   unsigned int		*ptr;
+   unsigned int		i;
+
+   (void) data;
+
+   for (i = 0; i < ROUNDS; ++i)
+     {
+	ptr = shared_pop_object ();
+	if (ptr == NULL)
+	  return (void*) 1;
+	*ptr = i;
+	if (*ptr != i || shared_push_object (ptr))
+	  return (void*) 2;
+     }
+
+   return NULL;
+}
+
+static void*
+worker (void *data)
+{
+   ememoa_fixed_t	*pool = data;
+   unsigned int		*ptr;
+   unsigned int		i;
+
+   for (i = 0; i < ROUNDS; ++i)
+     {
+	ptr = ememoa_fixed_pop_object (pool);
+	if (ptr == NULL)
+	  return (void*) 1;
+	*ptr = i;
+	if (ememoa_fixed_push_object (pool, ptr))
+	  return (void*) 2;
+     }
+
+   return NULL;
+}
+
+static int
+run (unsigned int options)
+{
+   struct ememoa_mempool_lock_stat_s	stat;
+   pthread_t				threads[THREADS];
+   ememoa_fixed_t			*pool;
+   void					*result;
+   unsigned int				i;
+   int					error = 0;
+
+   pool = ememoa_fixed_init (sizeof (unsigned int), 5, options, NULL);
+   if (pool == NULL)
+     return 1;
+
+   for (i = 0; i < THREADS; ++i)
+     if (pthread_create (threads + i, NULL, worker, pool))
+       return 2;
+
+   for (i = 0; i < THREADS; ++i)
+     {
+	pthread_join (threads[i], &result);
+	if (result != NULL)
+	  error = 10 + (int) (uintptr_t) result;
+     }
+   if (error)
+     return error;
+
+   if (ememoa_fixed_lock_stat (pool, &stat))
+     return 3;
+
+   /* Every pop and push take the lock once. */
+   if (stat.acquisitions < 2 * THREADS * ROUNDS
+       || stat.contended > stat.acquisitions
+       || (stat.contended == 0 && stat.wait_ns != 0))
+     return 4;
+
+   if (ememoa_mempool_fixed_lock_stat (ememoa_fixed_to_index (pool), &stat))
+     return 5;
+
+   return ememoa_fixed_clean (pool);
+}
+
+int main(void)
+{
+   struct ememoa_mempool_lock_stat_s	stat;
+   unsigned int				unknown;
+   int					arena;
+   int					pool;
+   int					error;
+
+   error = run (EMEMOA_THREAD_PROTECTION);
+   if (error)
+     return error;
+
+   error = run (EMEMOA_THREAD_PROTECTION | EMEMOA_ADAPTIVE_LOCK);
+   if (error)
+     return 20 + error;
+
+   /* Without thread protection the lock is never used. */
+   pool = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, EMEMOA_ADAPTIVE_LOCK, NULL);
+   if (pool < 0)
+     return 40;
+   ememoa_mempool_fixed_push_object (pool, ememoa_mempool_fixed_pop_object (pool));
+   if (ememoa_mempool_fixed_lock_stat (pool, &stat) || stat.acquisitions != 0)
+     return 41;
+   ememoa_mempool_fixed_clean (pool);
+
+   unknown = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					       default_map_size_count,
+					       EMEMOA_THREAD_PROTECTION | EMEMOA_ADAPTIVE_LOCK,
+					       NULL);
+   if ((int) unknown < 0)
+     return 42;
+   /* Only objects too big for the fixed memory pools take this lock. */
+   ememoa_mempool_unknown_size_push_object (unknown, ememoa_mempool_unknown_size_pop_object (unknown, 100000));
+   if (ememoa_mempool_unknown_size_lock_stat (unknown, &stat) || stat.acquisitions < 2)
+     return 43;
+   ememoa_mempool_unknown_size_clean (unknown);
+
+   /* Compile time specialized memory pools share the adaptive lock. */
+   {
+      pthread_t		threads[THREADS];
+      void		*result;
+      unsigned int	i;
+
+      for (i = 0; i < THREADS; ++i)
+	if (pthread_create (threads + i, NULL, static_worker, NULL))
+	  return 47;
+      for (i = 0; i < THREADS; ++i)
+	{
+	   pthread_join (threads[i], &result);
+	   if (result != NULL)
+	     return 48;
+	}
+      if (shared_garbage_collect () != 1 || shared_clean ())
+	return 49;
+   }
+
+   arena = ememoa_mempool_arena_init (0, EMEMOA_THREAD_PROTECTION, NULL);
+   if (arena < 0)
+     return 44;
+   if (ememoa_mempool_arena_pop_object (arena, 10) == NULL)
+     return 45;
+   if (ememoa_mempool_arena_lock_stat (arena, &stat) || stat.acquisitions < 1 || stat.contended != 0)
+     return 46;
+   ememoa_mempool_arena_clean (arena);
+
+   return 0;
+}
+#else
+int main(void)
+{
+   /* Nothing to test without thread support. */
+   return 77;
+}
+#endif
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_profile.h"
+
+#define OBJECTS	10
+#define CHURN	60
+
+static unsigned int	mempool;
+
+static void*
+allocate_kept (void)
+{
+   return ememoa_mempool_unknown_size_pop_object (mempool, 100);
+}
+
+static void*
+allocate_freed (void)
+{
+   return ememoa_mempool_unknown_size_pop_object (mempool, 200);
+}
+
+/* Count the samples of a folded profile and sum their bytes. */
+static int
+read_profile (FILE *profile, unsigned long *bytes)
+{
+   char			line[4096];
+   char			*weight;
+   int			count = 0;
+
+   *bytes = 0;
+   rewind (profile);
+   while (fgets (line, sizeof (line), profile))
+     {
+	weight = strrchr (line, ' ');
+	if (weight == NULL)
+	  return -1;
+	*bytes += strtoul (weight + 1, NULL, 10);
+	count++;
+     }
+
+   return count;
+}
+
+int main(void)
+{
+   void			*kept[OBJECTS];
+   void			*freed[OBJECTS];
+   void			*churn[CHURN];
+   FILE			*profile;
+   unsigned long	bytes;
+   int			round;
+   int			i;
+
+   mempool = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					       default_map_size_count,
+					       0,
+					       NULL);
+   if ((int) mempool < 0)
+     return 1;
+
+#ifdef HAVE_EXECINFO_H
+   /* Sample every allocation. */
+   if (ememoa_mempool_profile_start (1, 64))
+     return 2;
+#else
+   if (ememoa_mempool_profile_start (1, 64) != -1)
+     return 2;
+   return 77;
+#endif
+
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	kept[i] = allocate_kept ();
+	freed[i] = allocate_freed ();
+	if (kept[i] == NULL || freed[i] == NULL)
+	  return 3;
+     }
+
+   for (i = 0; i < OBJECTS; ++i)
+     ememoa_mempool_unknown_size_push_object (mempool, freed[i]);
+
+   profile = tmpfile ();
+   if (profile == NULL)
+     return 77;
+
+   /* Only the objects still alive are in the profile, with their own size. */
+   if (ememoa_mempool_profile_dump (profile) != OBJECTS)
+     return 4;
+   if (read_profile (profile, &bytes) != OBJECTS || bytes != OBJECTS * 100)
+     return 5;
+
+   for (i = 0; i < OBJECTS; ++i)
+     ememoa_mempool_unknown_size_push_object (mempool, kept[i]);
+
+   if (ememoa_mempool_profile_dump (profile) != 0)
+     return 6;
+
+   /* Steady churn keeps every live sample reachable. */
+   for (round = 0; round < 50; ++round)
+     {
+	for (i = 0; i < CHURN; ++i)
+	  if ((churn[i] = allocate_kept ()) == NULL)
+	    return 8;
+	for (i = round % 3; i < CHURN; i += 3)
+	  ememoa_mempool_unknown_size_push_object (mempool, churn[i]);
+	if (ememoa_mempool_profile_dump (profile) != CHURN - (CHURN - round % 3 + 2) / 3)
+	  return 9;
+	for (i = 0; i < CHURN; ++i)
+	  if (i % 3 != round % 3)
+	    ememoa_mempool_unknown_size_push_object (mempool, churn[i]);
+	if (ememoa_mempool_profile_dump (profile) != 0)
+	  return 10;
+     }
+
+   /* Once stopped nothing is sampled anymore. */
+   ememoa_mempool_profile_stop ();
+   kept[0] = allocate_kept ();
+   if (ememoa_mempool_profile_dump (profile) != 0)
+     return 7;
+   ememoa_mempool_unknown_size_push_object (mempool, kept[0]);
+
+   fclose (profile);
+
+   return ememoa_mempool_unknown_size_clean (mempool);
+}
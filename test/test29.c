@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_report.h"
+#include "ememoa_memory_base.h"
+
+#define MEMSIZE	4 * 1024 * 1024
+
+static const struct ememoa_mempool_desc_s	node_desc = { "node \"24\"", NULL, NULL, NULL };
+
+static char	report[65536];
+
+static int
+read_report (void)
+{
+   FILE		*out;
+   size_t	length;
+
+   out = tmpfile ();
+   if (out == NULL)
+     return -1;
+
+   if (ememoa_report_footprint (out))
+     return -1;
+
+   rewind (out);
+   length = fread (report, 1, sizeof (report) - 1, out);
+   report[length] = '\0';
+   fclose (out);
+
+   return 0;
+}
+
+int main(void)
+{
+   const char	*entry;
+   void		*mem;
+   void		*objects[3];
+   void		*small;
+   void		*big;
+   void		*aligned;
+   unsigned int	mempool;
+   unsigned int	pages;
+   unsigned int	free_pages;
+   int		pool;
+   int		i;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   if (ememoa_memory_base_init_64m (mem, MEMSIZE))
+     return 1;
+
+   /* 20 bytes objects are rounded to 24. */
+   pool = ememoa_mempool_fixed_init (20, 5, 0, &node_desc);
+   if (pool < 0)
+     return 2;
+
+   for (i = 0; i < 3; ++i)
+     if ((objects[i] = ememoa_mempool_fixed_pop_object (pool)) == NULL)
+       return 3;
+   ememoa_mempool_fixed_push_object (pool, objects[2]);
+
+   mempool = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					       default_map_size_count,
+					       0,
+					       NULL);
+   if ((int) mempool < 0)
+     return 4;
+
+   small = ememoa_mempool_unknown_size_pop_object (mempool, 100);
+   big = ememoa_mempool_unknown_size_pop_object (mempool, 100000);
+   aligned = ememoa_mempool_unknown_size_pop_object_aligned (mempool, 50, 64);
+   if (small == NULL || big == NULL || aligned == NULL)
+     return 5;
+   small = ememoa_mempool_unknown_size_resize_object (mempool, small, 120);
+   if (small == NULL)
+     return 6;
+   ememoa_mempool_unknown_size_push_object (mempool, aligned);
+
+   if (read_report ())
+     return 7;
+
+   /* Two live objects, the third one wait in the cache. The pool fills its 1KB block
+      with 41 objects. */
+   entry = strstr (report, "\"name\": \"node \\\"24\\\"\"");
+   if (entry == NULL)
+     return 8;
+   if (strstr (entry, "\"object_size\": 24, \"pools\": 1, \"objects\": 2, \"requested\": 40, \"handed\": 48, ") == NULL)
+     return 9;
+   if (strstr (entry, "\"free_in_partial\": 936, \"wasted\": 0 }") == NULL)
+     return 10;
+
+   entry = strstr (report, "\"unknown_size\": [");
+   if (entry == NULL || strstr (entry, "\"requested\": 100120,") == NULL)
+     return 11;
+
+   entry = strstr (report, "\"heap_64m\": { \"page_size\": 4096, \"pages\": ");
+   if (entry == NULL
+       || sscanf (entry, "\"heap_64m\": { \"page_size\": 4096, \"pages\": %u, \"free_pages\": %u,", &pages, &free_pages) != 2
+       || free_pages == 0 || free_pages >= pages)
+     return 12;
+
+   ememoa_mempool_unknown_size_push_object (mempool, small);
+   ememoa_mempool_unknown_size_push_object (mempool, big);
+   ememoa_mempool_fixed_push_object (pool, objects[0]);
+   ememoa_mempool_fixed_push_object (pool, objects[1]);
+
+   if (read_report ())
+     return 13;
+
+   entry = strstr (report, "\"unknown_size\": [");
+   if (entry == NULL || strstr (entry, "\"requested\": 0,") == NULL)
+     return 14;
+
+   ememoa_mempool_unknown_size_clean (mempool);
+   ememoa_mempool_fixed_clean (pool);
+
+   return 0;
+}
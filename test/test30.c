@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "config.h"
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_fixed.h"
+
+#define MEMSIZE	1024 * 1024
+#define MESSAGE	"message from the child process"
+
+#ifdef HAVE_PTHREAD
+static char	private_buffer[MEMSIZE / 16];
+
+static int
+child (int fd, int out)
+{
+   void		*buffer;
+   char		*message;
+   unsigned int	offset;
+
+   /* A second mapping of the same memory, at a different address than the parent one. */
+   buffer = ememoa_memory_base_open_shared_64m (fd);
+   if (buffer == NULL)
+     return 1;
+
+   message = ememoa_memory_base_alloc (10000);
+   if (message == NULL)
+     return 2;
+   strcpy (message, MESSAGE);
+
+   offset = ememoa_memory_base_offset_64m (message);
+   if (ememoa_memory_base_pointer_64m (offset) != message)
+     return 3;
+
+   if (write (out, &offset, sizeof (offset)) != sizeof (offset))
+     return 4;
+
+   return 0;
+}
+
+int main(void)
+{
+   void		*buffer;
+   void		*other;
+   void		*first;
+   char		*message;
+   unsigned int	offset;
+   int		status;
+   int		pipes[2];
+   int		fd;
+   int		other_fd;
+   pid_t	pid;
+
+   buffer = ememoa_memory_base_create_shared_64m (MEMSIZE, &fd);
+   if (buffer == NULL)
+     return 77;
+
+   first = ememoa_memory_base_alloc (100);
+   if (first == NULL)
+     return 1;
+
+   if (pipe (pipes))
+     return 77;
+
+   pid = fork ();
+   if (pid < 0)
+     return 77;
+   if (pid == 0)
+     _exit (child (fd, pipes[1]));
+
+   if (read (pipes[0], &offset, sizeof (offset)) != sizeof (offset))
+     return 2;
+   if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+     return 3;
+
+   message = ememoa_memory_base_pointer_64m (offset);
+   if (message == NULL || strcmp (message, MESSAGE))
+     return 4;
+
+   /* The child allocation is known to this process allocator too. */
+   if ((void*) message == first)
+     return 5;
+   ememoa_memory_base_free (message);
+   ememoa_memory_base_free (first);
+
+   /* Fixed memory pools work on top of the shared buffer. */
+   if (ememoa_mempool_fixed_init (sizeof (int), 5, 0, NULL) < 0)
+     return 6;
+
+   /* A private buffer could not be attached. */
+   if (ememoa_memory_base_attach_shared_64m (private_buffer) == 0)
+     return 7;
+
+   /* A buffer of the wrong size is rejected and the allocator stays where it was. */
+   other = ememoa_memory_base_create_shared_64m (MEMSIZE, &other_fd);
+   if (other == NULL)
+     return 77;
+   if (ftruncate (other_fd, MEMSIZE * 2))
+     return 77;
+   if (ememoa_memory_base_open_shared_64m (other_fd) != NULL)
+     return 8;
+   first = ememoa_memory_base_alloc (100);
+   if (first == NULL || (char*) first < (char*) other || (char*) first >= (char*) other + MEMSIZE)
+     return 9;
+   ememoa_memory_base_free (first);
+
+   munmap (buffer, MEMSIZE);
+   close (fd);
+
+   return 0;
+}
+#else
+int main(void)
+{
+   /* The shared static buffer need a process shared lock. */
+   return 77;
+}
+#endif
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_memory_base.h"
+#include "ememoa_snapshot.h"
+
+#define MEMSIZE		4 * 1024 * 1024
+#define OBJECTS		100
+
+struct root_s
+{
+   int			fixed;
+   unsigned int		unknown;
+   unsigned int		*objects[OBJECTS];
+   char			*name;
+};
+
+static char	path[] = "/tmp/ememoa-test31-XXXXXX";
+
+/* First run: build some memory pools and objects, then exit. */
+static int
+first_run (void)
+{
+   struct root_s	*root;
+   unsigned int		i;
+
+   if (ememoa_attach (path, NULL, MEMSIZE) == NULL)
+     return 1;
+   if (ememoa_snapshot_root_get () != NULL)
+     return 2;
+
+   root = ememoa_memory_base_alloc (sizeof (struct root_s));
+   if (root == NULL)
+     return 3;
+
+   root->fixed = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, 0, NULL);
+   root->unknown = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+						     default_map_size_count,
+						     0,
+						     NULL);
+   if (root->fixed < 0 || (int) root->unknown < 0)
+     return 4;
+
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	root->objects[i] = ememoa_mempool_fixed_pop_object (root->fixed);
+	if (root->objects[i] == NULL)
+	  return 5;
+	*root->objects[i] = i * 7;
+     }
+
+   root->name = ememoa_mempool_unknown_size_pop_object (root->unknown, 64);
+   if (root->name == NULL)
+     return 6;
+   strcpy (root->name, "warm restart");
+
+   ememoa_snapshot_root_set (root);
+   if (ememoa_snapshot_sync ())
+     return 7;
+
+   return 0;
+}
+
+int main(void)
+{
+   struct root_s	*root;
+   unsigned int		*object;
+   unsigned int		i;
+   int			status;
+   int			fd;
+   pid_t		pid;
+
+   fd = mkstemp (path);
+   if (fd < 0)
+     return 77;
+   close (fd);
+
+   pid = fork ();
+   if (pid < 0)
+     return 77;
+   if (pid == 0)
+     _exit (first_run ());
+
+   if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+     {
+	unlink (path);
+	return 10 + (WIFEXITED (status) ? WEXITSTATUS (status) : 0);
+     }
+
+   /* Second run: everything is back without allocating anything. */
+   if (ememoa_attach (path, NULL, MEMSIZE) == NULL)
+     return 20;
+   unlink (path);
+
+   root = ememoa_snapshot_root_get ();
+   if (root == NULL)
+     return 21;
+
+   for (i = 0; i < OBJECTS; ++i)
+     if (*root->objects[i] != i * 7)
+       return 22;
+   if (strcmp (root->name, "warm restart"))
+     return 23;
+
+   /* The memory pools still know which objects are in use. */
+   object = ememoa_mempool_fixed_pop_object (root->fixed);
+   if (object == NULL)
+     return 24;
+   for (i = 0; i < OBJECTS; ++i)
+     if (object == root->objects[i])
+       return 25;
+
+   if (ememoa_mempool_fixed_push_object (root->fixed, root->objects[0]))
+     return 26;
+   if (ememoa_mempool_unknown_size_push_object (root->unknown, root->name))
+     return 27;
+
+   /* Only one static buffer per process. */
+   if (ememoa_attach (path, NULL, MEMSIZE) != NULL)
+     return 28;
+
+   return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_memory_base.h"
+
+#define RESERVED	1000
+
+static unsigned int	allocations = 0;
+
+static void*
+counting_alloc (size_t size)
+{
+   allocations++;
+   return malloc (size);
+}
+
+int main(void)
+{
+   void			*objects[RESERVED];
+   unsigned int		count;
+   unsigned int		i;
+   int			pool;
+
+   ememoa_memory_base_alloc = counting_alloc;
+
+   /* A preallocated memory pool doesn't allocate on its first pops. */
+   pool = ememoa_mempool_fixed_init (sizeof (double), 6, EMEMOA_PREALLOCATE, NULL);
+   if (pool < 0)
+     return 1;
+   count = allocations;
+   for (i = 0; i < 64; ++i)
+     if ((objects[i] = ememoa_mempool_fixed_pop_object (pool)) == NULL)
+       return 2;
+   if (allocations != count)
+     return 3;
+   ememoa_mempool_fixed_clean (pool);
+
+   pool = ememoa_mempool_fixed_init (sizeof (double), 5, 0, NULL);
+   if (pool < 0)
+     return 4;
+   if (ememoa_mempool_fixed_reserve (pool, RESERVED))
+     return 5;
+
+   count = allocations;
+   for (i = 0; i < RESERVED; ++i)
+     {
+	objects[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (objects[i] == NULL)
+	  return 6;
+	memset (objects[i], 0, sizeof (double));
+     }
+   if (allocations != count)
+     return 7;
+
+   /* Garbage collection keeps the reserved pools, even when they are all empty. */
+   for (i = 0; i < RESERVED; ++i)
+     ememoa_mempool_fixed_push_object (pool, objects[i]);
+   ememoa_mempool_fixed_garbage_collect (pool);
+
+   count = allocations;
+   for (i = 0; i < RESERVED; ++i)
+     if ((objects[i] = ememoa_mempool_fixed_pop_object (pool)) == NULL)
+       return 8;
+   if (allocations != count)
+     return 9;
+
+   /* Reserving what is already available allocates nothing. */
+   for (i = 0; i < RESERVED / 2; ++i)
+     ememoa_mempool_fixed_push_object (pool, objects[i]);
+   if (ememoa_mempool_fixed_reserve (pool, RESERVED / 2) || allocations != count)
+     return 10;
+
+   return ememoa_mempool_fixed_clean (pool);
+}
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_memory_base.h"
+
+#define OBJECTS		4096
+
+static unsigned int	allocations = 0;
+static size_t		last_size = 0;
+
+static void*
+counting_alloc (size_t size)
+{
+   allocations++;
+   last_size = size;
+   return malloc (size);
+}
+
+static int
+count_cb (void *ptr, void *data)
+{
+   (void) ptr;
+
+   (*(unsigned int*) data)++;
+   return 0;
+}
+
+int main(void)
+{
+   void			*objects[OBJECTS];
+   unsigned int		count;
+   unsigned int		i;
+   int			pool;
+
+   ememoa_memory_base_alloc = counting_alloc;
+
+   /* Fixed size pools need at least OBJECTS / 32 allocations. */
+   pool = ememoa_mempool_fixed_init (sizeof (double), 5, 0, NULL);
+   if (pool < 0)
+     return 1;
+   count = allocations;
+   for (i = 0; i < OBJECTS; ++i)
+     if ((objects[i] = ememoa_mempool_fixed_pop_object (pool)) == NULL)
+       return 2;
+   if (allocations - count < OBJECTS / 32)
+     return 3;
+   ememoa_mempool_fixed_clean (pool);
+
+   /* Growing pools need a lot less. */
+   pool = ememoa_mempool_fixed_init (sizeof (double), 5, EMEMOA_ADAPTIVE_POOLS, NULL);
+   if (pool < 0)
+     return 4;
+   count = allocations;
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	objects[i] = ememoa_mempool_fixed_pop_object (pool);
+	if (objects[i] == NULL)
+	  return 5;
+	memset (objects[i], 0, sizeof (double));
+     }
+   if (allocations - count > 16)
+     return 6;
+   /* But never more than 16 times the smallest pool. */
+   if (last_size < 512 * sizeof (double) || last_size > 1024 * sizeof (double))
+     return 7;
+
+   count = 0;
+   if (ememoa_mempool_fixed_walk_over (pool, count_cb, &count) || count != OBJECTS)
+     return 8;
+
+   /* Every object goes back to the pool it came from. */
+   for (i = 0; i < OBJECTS; i += 2)
+     if (ememoa_mempool_fixed_push_object (pool, objects[i]))
+       return 9;
+   for (i = 1; i < OBJECTS; i += 2)
+     if (ememoa_mempool_fixed_push_object (pool, objects[i]))
+       return 10;
+   ememoa_mempool_fixed_push_object (pool, objects[0]);
+   if (ememoa_mempool_fixed_get_last_error (pool) != EMEMOA_DOUBLE_PUSH)
+     return 11;
+
+   /* Once idle and collected, new pools start small again. */
+   if (ememoa_mempool_fixed_garbage_collect (pool))
+     return 12;
+   objects[0] = ememoa_mempool_fixed_pop_object (pool);
+   if (objects[0] == NULL || last_size > 64 * sizeof (double))
+     return 13;
+
+   return ememoa_mempool_fixed_clean (pool);
+}
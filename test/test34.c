@@ -0,0 +1,67 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_memory_base.h"
+
+#define MEMSIZE	4 * 1024 * 1024
+#define MAX	1024
+
+static int
+count_cb (void *ptr, void *data)
+{
+   (void) ptr;
+
+   (*(unsigned int*) data)++;
+   return 0;
+}
+
+int main(void)
+{
+   void		*objects[MAX];
+   void		*mem;
+   unsigned int	count;
+   unsigned int	walked;
+   unsigned int	i;
+   int		pool;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   if (ememoa_memory_base_init_64m (mem, MEMSIZE))
+     return 1;
+
+   /* 64 objects of 24 bytes only use 1.5KB of the page the pool gets. */
+   pool = ememoa_mempool_fixed_init (24, 6, 0, NULL);
+   if (pool < 0)
+     return 2;
+
+   /* Objects of the first pool follow each other until the page is full. */
+   objects[0] = ememoa_mempool_fixed_pop_object (pool);
+   for (count = 1; count < MAX; ++count)
+     {
+	objects[count] = ememoa_mempool_fixed_pop_object (pool);
+	if (objects[count] == NULL)
+	  return 3;
+	if (objects[count] != (uint8_t*) objects[count - 1] + 24)
+	  break;
+     }
+   if (count <= 64 || count * 24 > 4096
+       || ((uintptr_t) objects[0] & ~(uintptr_t) 4095) != (((uintptr_t) objects[count - 1] + 23) & ~(uintptr_t) 4095))
+     return 4;
+
+   /* The unused end of the last bitmap word is never seen as objects. */
+   walked = 0;
+   if (ememoa_mempool_fixed_walk_over (pool, count_cb, &walked) || walked != count + 1)
+     return 5;
+
+   for (i = 0; i <= count; ++i)
+     if (ememoa_mempool_fixed_push_object (pool, objects[i]))
+       return 6;
+   if (ememoa_mempool_fixed_push_object (pool, (uint8_t*) objects[count - 1] + 24) == 0)
+     return 7;
+
+   return ememoa_mempool_fixed_clean (pool);
+}
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_report.h"
+
+#define MEMSIZE	4 * 1024 * 1024
+#define BLOCKS	100
+
+static char	report[4096];
+
+static int
+free_pages (void)
+{
+   const char	*entry;
+   FILE		*out;
+   size_t	length;
+   unsigned int	pages;
+   unsigned int	free;
+
+   out = tmpfile ();
+   if (out == NULL || ememoa_report_footprint (out))
+     return -1;
+
+   rewind (out);
+   length = fread (report, 1, sizeof (report) - 1, out);
+   report[length] = '\0';
+   fclose (out);
+
+   entry = strstr (report, "\"heap_64m\": ");
+   if (entry == NULL
+       || sscanf (entry, "\"heap_64m\": { \"page_size\": 4096, \"pages\": %u, \"free_pages\": %u,", &pages, &free) != 2)
+     return -1;
+   return free;
+}
+
+int main(void)
+{
+   uint8_t	*blocks[BLOCKS];
+   uint8_t	*big;
+   void		*mem;
+   int		before;
+   int		i, j;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   if (ememoa_memory_base_init_64m (mem, MEMSIZE))
+     return 1;
+
+   before = free_pages ();
+   if (before <= 0)
+     return 2;
+
+   /* 100 blocks of 24 bytes fit in a single page. */
+   for (i = 0; i < BLOCKS; ++i)
+     {
+	blocks[i] = ememoa_memory_base_alloc (24);
+	if (blocks[i] == NULL || ((uintptr_t) blocks[i] & 15))
+	  return 3;
+	memset (blocks[i], i, 24);
+     }
+   if (free_pages () != before - 1)
+     return 4;
+
+   for (i = 0; i < BLOCKS; ++i)
+     for (j = 0; j < 24; ++j)
+       if (blocks[i][j] != i)
+	 return 5;
+
+   /* Growing a block out of its size class keeps its content. */
+   blocks[0] = ememoa_memory_base_realloc (blocks[0], 200);
+   if (blocks[0] == NULL || blocks[0][23] != 0)
+     return 6;
+   blocks[1] = ememoa_memory_base_realloc (blocks[1], 10000);
+   if (blocks[1] == NULL || ((uintptr_t) blocks[1] & 4095) || blocks[1][23] != 1)
+     return 7;
+
+   /* Bigger allocations still get whole pages. */
+   big = ememoa_memory_base_alloc (2000);
+   if (big == NULL || ((uintptr_t) big & 4095))
+     return 8;
+
+   for (i = 0; i < BLOCKS; ++i)
+     ememoa_memory_base_free (blocks[i]);
+   ememoa_memory_base_free (big);
+
+   /* Only one empty page is kept per size class. */
+   if (free_pages () < before - 2)
+     return 9;
+
+   return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_report.h"
+
+#define MEMSIZE	8 * 1024 * 1024
+#define MAX	4096
+
+static char	report[4096];
+
+static int
+heap_state (unsigned int *pages, unsigned int *free_pages, unsigned int *largest)
+{
+   const char	*entry;
+   FILE		*out;
+   size_t	length;
+
+   out = tmpfile ();
+   if (out == NULL || ememoa_report_footprint (out))
+     return -1;
+
+   rewind (out);
+   length = fread (report, 1, sizeof (report) - 1, out);
+   report[length] = '\0';
+   fclose (out);
+
+   entry = strstr (report, "\"heap_64m\": ");
+   if (entry == NULL
+       || sscanf (entry, "\"heap_64m\": { \"page_size\": 4096, \"pages\": %u, \"free_pages\": %u, \"largest_free_chunk\": %u",
+		  pages, free_pages, largest) != 3)
+     return -1;
+   return 0;
+}
+
+int main(void)
+{
+   uint8_t	*blocks[MAX];
+   unsigned int	sizes[MAX];
+   void		*mem;
+   unsigned int	pages, free_pages, largest;
+   unsigned int	before;
+   int		count;
+   int		i;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+   if (ememoa_memory_base_init_64m (mem, MEMSIZE))
+     return 1;
+
+   if (heap_state (&pages, &before, &largest))
+     return 2;
+
+   /* Fill the whole buffer with chunks of 1 to 7 pages, the last ones fit exactly. */
+   for (count = 0; count < MAX; ++count)
+     {
+	sizes[count] = ((count % 7) + 1) * 4096;
+	blocks[count] = ememoa_memory_base_alloc (sizes[count]);
+	if (blocks[count] == NULL)
+	  blocks[count] = ememoa_memory_base_alloc (sizes[count] = 4096);
+	if (blocks[count] == NULL)
+	  break;
+	blocks[count][0] = count & 0xFF;
+     }
+   if (count == MAX || heap_state (&pages, &free_pages, &largest) || free_pages != 0)
+     return 3;
+
+   /* Free one chunk out of two, then grow the others in place over the freed ones. */
+   for (i = 1; i < count; i += 2)
+     ememoa_memory_base_free (blocks[i]);
+   for (i = 0; i + 1 < count; i += 2)
+     {
+	uint8_t	*grown = ememoa_memory_base_realloc (blocks[i], sizes[i] + sizes[i + 1]);
+
+	if (grown != blocks[i] || grown[0] != (i & 0xFF))
+	  return 4;
+	blocks[i] = grown;
+     }
+
+   /* Giving everything back must merge the buffer into a single chunk again. */
+   for (i = 0; i < count; i += 2)
+     ememoa_memory_base_free (blocks[i]);
+   if (heap_state (&pages, &free_pages, &largest)
+       || free_pages != before
+       || largest != before * 4096)
+     return 5;
+
+   return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_report.h"
+
+#define MEMSIZE	8 * 1024 * 1024
+
+static char	report[4096];
+
+static int
+heap_state (unsigned int *page_size, unsigned int *pages)
+{
+   const char	*entry;
+   FILE		*out;
+   size_t	length;
+
+   out = tmpfile ();
+   if (out == NULL || ememoa_report_footprint (out))
+     return -1;
+
+   rewind (out);
+   length = fread (report, 1, sizeof (report) - 1, out);
+   report[length] = '\0';
+   fclose (out);
+
+   entry = strstr (report, "\"heap_64m\": ");
+   if (entry == NULL
+       || sscanf (entry, "\"heap_64m\": { \"page_size\": %u, \"pages\": %u",
+		  page_size, pages) != 2)
+     return -1;
+   return 0;
+}
+
+/* Allocate a big and a small block, both must be usable and well aligned. */
+static int
+check (void *mem, unsigned int size, unsigned int page)
+{
+   unsigned int	page_size, pages;
+   uint8_t	*big;
+   uint8_t	*small1;
+   uint8_t	*small2;
+
+   if (ememoa_memory_base_init_ext_64m (mem, size, page, 0))
+     return 1;
+   if (heap_state (&page_size, &pages) || page_size != page || pages < 2)
+     return 2;
+
+   big = ememoa_memory_base_alloc (page + 1);
+   if (big == NULL || ((uintptr_t) big & (page - 1)))
+     return 3;
+   memset (big, 0x5A, page + 1);
+
+   small1 = ememoa_memory_base_alloc (24);
+   small2 = ememoa_memory_base_alloc (24);
+   if (small1 == NULL || small2 == NULL || small1 == small2
+       || ((uintptr_t) small1 & 15) || ((uintptr_t) small2 & 15))
+     return 4;
+   memset (small1, 1, 24);
+   memset (small2, 2, 24);
+
+   /* A buffer does not have room for more pages than it holds. */
+   if (ememoa_memory_base_alloc ((size_t) (pages + 1) * page) != NULL)
+     return 5;
+
+   ememoa_memory_base_free (small1);
+   ememoa_memory_base_free (small2);
+   ememoa_memory_base_free (big);
+
+   return 0;
+}
+
+int main(void)
+{
+   static uint8_t	tiny[64 * 1024];
+   void			*mem;
+   int			error;
+
+   mem = mmap (NULL, MEMSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED)
+     return 77;
+
+   /* Only powers of two from 256 bytes to 2MB are page sizes. */
+   if (ememoa_memory_base_init_ext_64m (mem, MEMSIZE, 128, 0) != -1
+       || ememoa_memory_base_init_ext_64m (mem, MEMSIZE, 3000, 0) != -1
+       || ememoa_memory_base_init_ext_64m (mem, MEMSIZE, 4 * 1024 * 1024, 0) != -1)
+     return 1;
+
+   error = check (tiny, sizeof (tiny), 256);
+   if (error)
+     return 10 + error;
+
+   error = check (mem, MEMSIZE, 64 * 1024);
+   if (error)
+     return 20 + error;
+
+   error = check (mem, MEMSIZE, 2 * 1024 * 1024);
+   if (error)
+     return 30 + error;
+
+   /* The default page size is still 4KB. */
+   error = check (mem, MEMSIZE, 4096);
+   if (error)
+     return 40 + error;
+
+   return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ememoa_memory_base.h"
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_arena.h"
+
+#define HEAPSIZE	(1024 * 1024)
+#define OBJECTS		500
+
+static uint8_t	buffer_a[HEAPSIZE];
+static uint8_t	buffer_b[HEAPSIZE];
+
+static int
+inside (const uint8_t *buffer, const void *ptr)
+{
+   return (const uint8_t*) ptr >= buffer && (const uint8_t*) ptr < buffer + HEAPSIZE;
+}
+
+/* Count the pages still free in a heap, and give them back. */
+static int
+free_pages (ememoa_heap_t *heap)
+{
+   void		*pages[HEAPSIZE / 4096];
+   int		count;
+   int		i;
+
+   for (count = 0; (pages[count] = ememoa_heap_alloc (heap, 4096)) != NULL; ++count)
+     ;
+   for (i = 0; i < count; ++i)
+     ememoa_heap_free (heap, pages[i]);
+
+   return count;
+}
+
+int main(void)
+{
+   struct ememoa_memory_backend_s	backend_a;
+   struct ememoa_memory_backend_s	backend_b;
+   struct ememoa_mempool_desc_s		desc_a = { "a", NULL, NULL, &backend_a };
+   struct ememoa_mempool_desc_s		desc_b = { "b", NULL, NULL, &backend_b };
+   ememoa_heap_t			*heap_a;
+   ememoa_heap_t			*heap_b;
+   void					*fixed[OBJECTS];
+   void					*unknown[OBJECTS];
+   void					*big;
+   void					*plain;
+   unsigned int				pool_unknown;
+   int					pool_fixed;
+   int					pool_plain;
+   int					arena;
+   int					before_a;
+   int					before_b;
+   int					i;
+
+   if (ememoa_heap_init (buffer_a, HEAPSIZE, 3000) != NULL)
+     return 1;
+
+   heap_a = ememoa_heap_init (buffer_a, HEAPSIZE, 4096);
+   heap_b = ememoa_heap_init (buffer_b, HEAPSIZE, 4096);
+   if (heap_a == NULL || heap_b == NULL)
+     return 2;
+   ememoa_heap_backend (heap_a, &backend_a);
+   ememoa_heap_backend (heap_b, &backend_b);
+
+   before_a = free_pages (heap_a);
+   before_b = free_pages (heap_b);
+   if (before_a <= 0 || before_b <= 0)
+     return 3;
+
+   pool_fixed = ememoa_mempool_fixed_init (24, 6, 0, &desc_a);
+   pool_unknown = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+						    default_map_size_count,
+						    0,
+						    &desc_b);
+   pool_plain = ememoa_mempool_fixed_init (24, 6, 0, NULL);
+   if (pool_fixed < 0 || (int) pool_unknown < 0 || pool_plain < 0)
+     return 4;
+
+   /* Each memory pool takes its objects from its own heap only. */
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	fixed[i] = ememoa_mempool_fixed_pop_object (pool_fixed);
+	unknown[i] = ememoa_mempool_unknown_size_pop_object (pool_unknown, 8 + i);
+	if (!inside (buffer_a, fixed[i]) || !inside (buffer_b, unknown[i]))
+	  return 5;
+     }
+   big = ememoa_mempool_unknown_size_pop_object (pool_unknown, 100000);
+   plain = ememoa_mempool_fixed_pop_object (pool_plain);
+   if (!inside (buffer_b, big) || plain == NULL || inside (buffer_a, plain) || inside (buffer_b, plain))
+     return 6;
+
+   big = ememoa_mempool_unknown_size_resize_object (pool_unknown, big, 200000);
+   if (!inside (buffer_b, big))
+     return 7;
+
+   arena = ememoa_mempool_arena_init (4096, 0, &desc_a);
+   if (arena < 0 || !inside (buffer_a, ememoa_mempool_arena_pop_object (arena, 100)))
+     return 8;
+
+   /* Once the memory pools are gone every page is back in its heap. */
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	ememoa_mempool_fixed_push_object (pool_fixed, fixed[i]);
+	ememoa_mempool_unknown_size_push_object (pool_unknown, unknown[i]);
+     }
+   ememoa_mempool_unknown_size_push_object (pool_unknown, big);
+   ememoa_mempool_fixed_push_object (pool_plain, plain);
+
+   if (ememoa_mempool_fixed_clean (pool_fixed)
+       || ememoa_mempool_unknown_size_clean (pool_unknown)
+       || ememoa_mempool_fixed_clean (pool_plain)
+       || ememoa_mempool_arena_clean (arena))
+     return 9;
+
+   if (free_pages (heap_a) != before_a || free_pages (heap_b) != before_b)
+     return 10;
+
+   return 0;
+}
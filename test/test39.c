@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ememoa_mempool_unknown_size.h"
+
+#define MAX	(64 * 1024 * 1024)
+
+/* Mark the first and the last bytes of an object. */
+static void
+mark (uint8_t *ptr, unsigned int size, uint8_t value)
+{
+   memset (ptr, value, 64);
+   memset (ptr + size - 64, value + 1, 64);
+}
+
+static int
+check (const uint8_t *ptr, unsigned int size, uint8_t value)
+{
+   unsigned int	i;
+
+   for (i = 0; i < 64; ++i)
+     if (ptr[i] != value || ptr[size - 64 + i] != value + 1)
+       return -1;
+   return 0;
+}
+
+int main(void)
+{
+   unsigned int	mempool;
+   uint8_t	*ptr;
+   uint8_t	*other;
+   unsigned int	size;
+   uint8_t	step = 0;
+
+   mempool = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					       default_map_size_count,
+					       0,
+					       NULL);
+   if ((int) mempool < 0)
+     return 1;
+
+   /* Start below the mmap threshold, then keep doubling up to 64MB. */
+   size = 16 * 1024;
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, size);
+   if (ptr == NULL)
+     return 2;
+   memset (ptr, 0, size);
+   mark (ptr, size, step);
+
+   while (size < MAX)
+     {
+	ptr = ememoa_mempool_unknown_size_resize_object (mempool, ptr, size * 2);
+	if (ptr == NULL)
+	  return 3;
+	if (check (ptr, size, step))
+	  return 4;
+	size *= 2;
+	mark (ptr, size, ++step);
+     }
+
+   /* Shrinking and growing inside the same pages keep the object where it is. */
+   other = ememoa_mempool_unknown_size_resize_object (mempool, ptr, size - 100);
+   if (other != ptr || ptr[0] != step)
+     return 5;
+   other = ememoa_mempool_unknown_size_resize_object (mempool, ptr, size);
+   if (other != ptr || check (ptr, size, step))
+     return 6;
+
+   if (ememoa_mempool_unknown_size_push_object (mempool, ptr))
+     return 7;
+
+   /* Mapped objects left behind are given back by free_all_objects and clean. */
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 1024 * 1024);
+   if (ptr == NULL)
+     return 8;
+   memset (ptr, 1, 1024 * 1024);
+   if (ememoa_mempool_unknown_size_free_all_objects (mempool))
+     return 9;
+
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 4 * 1024 * 1024);
+   if (ptr == NULL)
+     return 10;
+   memset (ptr, 2, 4 * 1024 * 1024);
+
+   return ememoa_mempool_unknown_size_clean (mempool);
+}
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_report.h"
+
+#define ROUNDS	1000
+
+static char	report[65536];
+
+/* Give the live objects the footprint report counts in the unknown size memory pool. */
+static int
+live_objects (void)
+{
+   const char	*entry;
+   FILE		*out;
+   size_t	length;
+   unsigned int	objects;
+
+   out = tmpfile ();
+   if (out == NULL || ememoa_report_footprint (out))
+     return -1;
+
+   rewind (out);
+   length = fread (report, 1, sizeof (report) - 1, out);
+   report[length] = '\0';
+   fclose (out);
+
+   entry = strstr (report, "\"unknown_size\": ");
+   if (entry == NULL
+       || (entry = strstr (entry, "\"objects\": ")) == NULL
+       || sscanf (entry, "\"objects\": %u,", &objects) != 1)
+     return -1;
+   return objects;
+}
+
+int main(void)
+{
+   unsigned int	mempool;
+   void		*ptr;
+   void		*first;
+   void		*other;
+   unsigned int	size;
+   int		i;
+
+   mempool = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+					       default_map_size_count,
+					       0,
+					       NULL);
+   if ((int) mempool < 0)
+     return 1;
+
+   /* A block given back is reused by the next object of as many pages. */
+   for (size = 8 * 1024; size <= 64 * 1024; size += 4 * 1024)
+     {
+	first = ememoa_mempool_unknown_size_pop_object (mempool, size - 100);
+	if (first == NULL)
+	  return 2;
+	memset (first, 0x5a, size - 100);
+	ememoa_mempool_unknown_size_push_object (mempool, first);
+
+	for (i = 0; i < ROUNDS; ++i)
+	  {
+	     ptr = ememoa_mempool_unknown_size_pop_object (mempool, size - 100 - (i % 64));
+	     if (ptr != first)
+	       return 3;
+	     memset (ptr, i, size - 100 - (i % 64));
+	     ememoa_mempool_unknown_size_push_object (mempool, ptr);
+	  }
+     }
+
+   /* Two live objects of the same size never share a cached block. */
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 20000);
+   other = ememoa_mempool_unknown_size_pop_object (mempool, 20000);
+   if (ptr == NULL || other == NULL || ptr == other)
+     return 4;
+   memset (ptr, 1, 20000);
+   memset (other, 2, 20000);
+   ememoa_mempool_unknown_size_push_object (mempool, ptr);
+   ememoa_mempool_unknown_size_push_object (mempool, other);
+
+   /* Cached blocks are not live objects. */
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 20000);
+   if (live_objects () != 1)
+     return 8;
+   ememoa_mempool_unknown_size_push_object (mempool, ptr);
+   if (live_objects () != 0)
+     return 9;
+
+   /* A cached block still grows when resized. */
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 20000);
+   memset (ptr, 3, 20000);
+   ptr = ememoa_mempool_unknown_size_resize_object (mempool, ptr, 60000);
+   if (ptr == NULL || ((uint8_t*) ptr)[19999] != 3)
+     return 5;
+   memset (ptr, 4, 60000);
+   ememoa_mempool_unknown_size_push_object (mempool, ptr);
+
+   /* The garbage collector gives back the cached blocks. */
+   if (ememoa_mempool_unknown_size_garbage_collect (mempool) <= 0)
+     return 6;
+
+   ptr = ememoa_mempool_unknown_size_pop_object (mempool, 20000);
+   if (ptr == NULL)
+     return 7;
+   ememoa_mempool_unknown_size_push_object (mempool, ptr);
+
+   return ememoa_mempool_unknown_size_clean (mempool);
+}
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ememoa_mempool_fixed.h"
+#include "ememoa_mempool_unknown_size.h"
+#include "ememoa_mempool_report.h"
+#include "ememoa_memory_base.h"
+#include "ememoa_snapshot.h"
+
+#define MEMSIZE		4 * 1024 * 1024
+#define OBJECTS		10
+
+/* Every run is a new image of this program, with its code and static data at a new
+   address when it is position independent. */
+
+struct root_s
+{
+   int			fixed;
+   unsigned int		unknown;
+   unsigned int		*objects[OBJECTS];
+};
+
+static const struct ememoa_mempool_desc_s	desc = { "persistent", NULL, NULL, NULL };
+
+static void*
+outside_alloc (void *ctx, size_t size)
+{
+   (void) ctx;
+   return malloc (size);
+}
+
+static void
+outside_free (void *ctx, void *ptr)
+{
+   (void) ctx;
+   free (ptr);
+}
+
+static const struct ememoa_memory_backend_s	backend = { outside_alloc, outside_free, NULL, NULL, NULL, NULL };
+static const struct ememoa_mempool_desc_s	backend_desc = { NULL, NULL, NULL, &backend };
+
+static int
+run (const char *stage, const char *path)
+{
+   execl ("/proc/self/exe", "test41", stage, path, (char*) NULL);
+   return 77;
+}
+
+/* Memory pools with a description pointing into this program. */
+static int
+first_run (const char *path)
+{
+   struct root_s	*root;
+   unsigned int		i;
+
+   if (ememoa_attach (path, NULL, MEMSIZE) == NULL)
+     return 1;
+
+   root = ememoa_memory_base_alloc (sizeof (struct root_s));
+   if (root == NULL)
+     return 2;
+
+   root->fixed = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, 0, &desc);
+   root->unknown = ememoa_mempool_unknown_size_init (sizeof (default_map_size_count) / (sizeof (unsigned int) * 2),
+						     default_map_size_count,
+						     0,
+						     &desc);
+   if (root->fixed < 0 || (int) root->unknown < 0)
+     return 3;
+
+   for (i = 0; i < OBJECTS; ++i)
+     {
+	root->objects[i] = ememoa_mempool_fixed_pop_object (root->fixed);
+	if (root->objects[i] == NULL)
+	  return 4;
+	*root->objects[i] = i * 3;
+     }
+
+   ememoa_snapshot_root_set (root);
+   if (ememoa_snapshot_sync ())
+     return 5;
+
+   return run ("restart", path);
+}
+
+/* The descriptions are gone, everything else is back. */
+static int
+restart (const char *path)
+{
+   struct root_s	*root;
+   FILE			*out;
+   void			*ptr;
+   unsigned int		i;
+
+   if (ememoa_attach (path, NULL, MEMSIZE) == NULL)
+     return 10;
+   unlink (path);
+
+   root = ememoa_snapshot_root_get ();
+   if (root == NULL)
+     return 11;
+   for (i = 0; i < OBJECTS; ++i)
+     if (*root->objects[i] != i * 3)
+       return 12;
+
+   /* The report reads the description of every memory pool. */
+   out = tmpfile ();
+   if (out == NULL)
+     return 77;
+   if (ememoa_report_footprint (out))
+     return 13;
+   fclose (out);
+
+   ptr = ememoa_mempool_unknown_size_pop_object (root->unknown, 100);
+   if (ptr == NULL || ememoa_mempool_unknown_size_push_object (root->unknown, ptr))
+     return 14;
+   for (i = 0; i < OBJECTS; ++i)
+     if (ememoa_mempool_fixed_push_object (root->fixed, root->objects[i]))
+       return 15;
+
+   return 0;
+}
+
+/* A memory pool taking its memory outside of the file. */
+static int
+backend_run (const char *path)
+{
+   int		pool;
+
+   if (ememoa_attach (path, NULL, MEMSIZE) == NULL)
+     return 20;
+
+   pool = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, 0, &backend_desc);
+   if (pool < 0 || ememoa_mempool_fixed_pop_object (pool) == NULL)
+     return 21;
+   if (ememoa_snapshot_sync ())
+     return 22;
+
+   return run ("reject", path);
+}
+
+/* The file is refused and ememoa is left untouched. */
+static int
+reject (const char *path)
+{
+   void		*ptr;
+   int		pool;
+
+   ptr = ememoa_attach (path, NULL, MEMSIZE);
+   unlink (path);
+   if (ptr != NULL)
+     return 30;
+
+   pool = ememoa_mempool_fixed_init (sizeof (unsigned int), 5, 0, NULL);
+   if (pool < 0)
+     return 31;
+   ptr = ememoa_mempool_fixed_pop_object (pool);
+   if (ptr == NULL || ememoa_mempool_fixed_push_object (pool, ptr))
+     return 32;
+
+   return ememoa_mempool_fixed_clean (pool);
+}
+
+int main(int argc, char **argv)
+{
+   char		path[] = "/tmp/ememoa-test41-XXXXXX";
+   int		fd;
+
+   if (argc == 3 && !strcmp (argv[1], "restart"))
+     {
+	int	error = restart (argv[2]);
+
+	if (error)
+	  return error;
+
+	/* Start again from an empty process for the next file. */
+	fd = mkstemp (path);
+	if (fd < 0)
+	  return 77;
+	close (fd);
+	return run ("backend", path);
+     }
+   if (argc == 3 && !strcmp (argv[1], "backend"))
+     return backend_run (argv[2]);
+   if (argc == 3 && !strcmp (argv[1], "reject"))
+     return reject (argv[2]);
+
+   fd = mkstemp (path);
+   if (fd < 0)
+     return 77;
+   close (fd);
+
+   return first_run (path);
+}